@@ -8,5 +8,15 @@ extern uint32_t ul_crc32(uint32_t seed, const unsigned char *buf, size_t len);
 extern uint32_t ul_crc32_exclude_offset(uint32_t seed, const unsigned char *buf, size_t len,
 		                              size_t exclude_off, size_t exclude_len);
 
+#ifdef TEST_PROGRAM_CRC32
+struct ul_crc32_kernel {
+	const char *name;
+	uint32_t (*fn)(uint32_t crc, const unsigned char *buf, size_t len);
+};
+
+/* kernels usable on this CPU, the array is terminated by { NULL } */
+extern const struct ul_crc32_kernel *ul_crc32_get_kernels(void);
+#endif
+
 #endif
 
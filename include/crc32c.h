@@ -6,4 +6,11 @@
 
 extern uint32_t crc32c(uint32_t crc, const void *buf, size_t size);
 
+#ifdef TEST_PROGRAM_CRC32
+# include "crc32.h"	/* struct ul_crc32_kernel */
+
+/* kernels usable on this CPU, the array is terminated by { NULL } */
+extern const struct ul_crc32_kernel *crc32c_get_kernels(void);
+#endif
+
 #endif /* UL_NG_CRC32C_H */
@@ -81,6 +81,8 @@ struct ul_pty {
 
 	struct timeval	next_callback_time;
 
+	char		*iobuf;		/* see handle_io() */
+
 	unsigned int isterm:1,		/* is stdin terminal? */
 		     slave_echo:1;	/* keep ECHO on pty slave */
 };
@@ -37,6 +37,10 @@ UL_DEBUG_DEFINE_MASKNAMES(ulpty) = UL_DEBUG_EMPTY_MASKNAMES;
 #define ULPTY_DEBUG_DONE	(1 << 5)
 #define ULPTY_DEBUG_ALL		0xFFFF
 
+/* the kernel returns at most one tty buffer (4 KiB) per read() */
+#define ULPTY_TTYBUF_SIZE	4096
+#define ULPTY_IOBUF_SIZE	(64 * 1024)
+
 #define DBG(m, x)       __UL_DBG(ulpty, ULPTY_DEBUG_, m, x)
 #define ON_DBG(m, x)    __UL_DBG_CALL(ulpty, ULPTY_DEBUG_, m, x)
 
@@ -69,6 +73,8 @@ struct ul_pty *ul_new_pty(int is_stdin_tty)
 
 void ul_free_pty(struct ul_pty *pty)
 {
+	if (pty)
+		free(pty->iobuf);
 	free(pty);
 }
 
@@ -346,9 +352,30 @@ static int mainloop_callback(struct ul_pty *pty)
 	return rc;
 }
 
+/*
+ * Reads data already available on master to the rest of the buffer. The
+ * command output is usually produced faster than one tty buffer per poll()
+ * loop, so it's cheaper to write it to stdout and logs by one call.
+ */
+static size_t read_more_from_master(struct ul_pty *pty, char *buf,
+				    size_t bufsz, size_t bytes)
+{
+	struct pollfd fds = { .fd = pty->master, .events = POLLIN };
+
+	while (bytes + ULPTY_TTYBUF_SIZE <= bufsz
+	       && poll(&fds, 1, 0) == 1 && (fds.revents & POLLIN)) {
+		ssize_t n = read(pty->master, buf + bytes, bufsz - bytes);
+
+		if (n <= 0)
+			break;	/* EOF or error is reported by the next poll() */
+		bytes += n;
+	}
+	return bytes;
+}
+
 static int handle_io(struct ul_pty *pty, int fd, int *eof)
 {
-	char buf[BUFSIZ];
+	char *buf;
 	ssize_t bytes;
 	int rc = 0;
 	sigset_t set;
@@ -356,11 +383,18 @@ static int handle_io(struct ul_pty *pty, int fd, int *eof)
 	DBG(IO, ul_debugobj(pty, " handle I/O on fd=%d", fd));
 	*eof = 0;
 
+	if (!pty->iobuf) {
+		pty->iobuf = malloc(ULPTY_IOBUF_SIZE);
+		if (!pty->iobuf)
+			return -ENOMEM;
+	}
+	buf = pty->iobuf;
+
 	sigemptyset(&set);
 	sigaddset(&set, SIGTTIN);
 	sigprocmask(SIG_UNBLOCK, &set, NULL);
 	/* read from active FD */
-	bytes = read(fd, buf, sizeof(buf));
+	bytes = read(fd, buf, ULPTY_IOBUF_SIZE);
 	sigprocmask(SIG_BLOCK, &set, NULL);
 	if (bytes < 0) {
 		if (errno == EAGAIN || errno == EINTR)
@@ -380,12 +414,9 @@ static int handle_io(struct ul_pty *pty, int fd, int *eof)
 		if (write_to_child(pty, buf, bytes))
 			return -errno;
 
-		/* without sync write_output() will write both input &
-		 * shell output that looks like double echoing */
-		fdatasync(pty->master);
-
 	/* from command (master) to stdout */
 	} else if (fd == pty->master) {
+		bytes = read_more_from_master(pty, buf, ULPTY_IOBUF_SIZE, bytes);
 		DBG(IO, ul_debugobj(pty, " master --> stdout %zd bytes", bytes));
 		write_output(buf, bytes);
 	}
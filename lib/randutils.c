@@ -163,9 +163,14 @@ int ul_random_get_bytes(void *buf, size_t nbytes)
 		}
 	}
 	/*
-	 * We do this all the time, but this is the only source of
-	 * randomness if /dev/random/urandom is out to lunch.
+	 * This is the only source of randomness if getrandom() and
+	 * /dev/random/urandom are out to lunch. It's not used if the kernel
+	 * provided all the bytes; the pseudo-random data do not improve them
+	 * and it's expensive for large buffers (e.g. bulk UUIDs generation).
 	 */
+	if (n == 0)
+		return 0;
+
 	crank_random();
 	for (cp = buf, i = 0; i < nbytes; i++)
 		*cp++ ^= (rand() >> 7) & 0xFF;
@@ -0,0 +1,530 @@
+/*
+ * bincache.c - binary (mmap-able) version of the blkid cache file
+ *
+ * This file may be redistributed under the terms of the
+ * GNU Lesser General Public License.
+ *
+ * The binary cache is an alternative to the default text blkid.tab format.
+ * It's enabled by CACHE_FORMAT=binary in blkid.conf. The file is read without
+ * any parsing, and it contains a hash index of all NAME=value tags, so
+ * LABEL=/UUID= lookups (see blkid_evaluate_tag()) don't need to read the
+ * whole cache at all.
+ *
+ * File layout (all numbers in native byte order, offsets from begin of the
+ * file, all sections are 8-bytes aligned):
+ *
+ *	struct bincache_header
+ *	struct bincache_dev	devs[ndevs]
+ *	struct bincache_tag	tags[ntags]	(tags of the device are continuous)
+ *	uint32_t		hash[nbuckets]	(tag index + 1, or 0)
+ *	char			strings[strsz]	(zero terminated strings)
+ *
+ * The file is always written to a temporary file and then renamed, see
+ * blkid_flush_cache().
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+
+#include "blkidP.h"
+
+#define BINCACHE_MAGIC		"BLKIDBIN"
+#define BINCACHE_MAGIC_LEN	(sizeof(BINCACHE_MAGIC) - 1)
+#define BINCACHE_VERSION	1
+#define BINCACHE_BYTEORDER	0x01020304
+
+struct bincache_header {
+	char		magic[BINCACHE_MAGIC_LEN];
+	uint32_t	version;
+	uint32_t	byteorder;	/* BINCACHE_BYTEORDER */
+
+	uint32_t	ndevs;
+	uint32_t	ntags;
+	uint32_t	nbuckets;	/* power of 2 */
+	uint32_t	strsz;
+
+	uint64_t	devs_off;
+	uint64_t	tags_off;
+	uint64_t	hash_off;
+	uint64_t	str_off;
+	uint64_t	size;		/* size of the file */
+};
+
+struct bincache_dev {
+	uint64_t	devno;
+	int64_t		time;
+	int64_t		utime;
+	int32_t		pri;
+	uint32_t	name;		/* offset in strings */
+	uint32_t	tags;		/* index of the first tag */
+	uint32_t	ntags;
+};
+
+struct bincache_tag {
+	uint32_t	name;		/* offset in strings */
+	uint32_t	value;		/* offset in strings */
+	uint32_t	dev;		/* device index */
+	uint32_t	next;		/* next tag in the same bucket (index + 1) */
+};
+
+struct bincache {
+	void				*map;
+	size_t				mapsz;
+
+	const struct bincache_header	*hdr;
+	const struct bincache_dev	*devs;
+	const struct bincache_tag	*tags;
+	const uint32_t			*hash;
+	const char			*str;
+};
+
+#define ALIGN8(x)	(((x) + 7) & ~((uint64_t) 7))
+
+/* FNV-1a hash of NAME=value */
+static uint32_t hash_tag(const char *name, const char *value)
+{
+	uint32_t h = 2166136261U;
+	const unsigned char *p;
+
+	for (p = (const unsigned char *) name; *p; p++)
+		h = (h ^ *p) * 16777619U;
+	h = (h ^ '=') * 16777619U;
+	for (p = (const unsigned char *) value; *p; p++)
+		h = (h ^ *p) * 16777619U;
+	return h;
+}
+
+int blkid_bincache_is_binary(int fd)
+{
+	char buf[BINCACHE_MAGIC_LEN];
+
+	return pread(fd, buf, sizeof(buf), 0) == (ssize_t) sizeof(buf)
+		&& memcmp(buf, BINCACHE_MAGIC, sizeof(buf)) == 0;
+}
+
+static inline int is_valid_section(const struct bincache_header *hdr,
+				   uint64_t off, uint64_t nitems, size_t itemsz)
+{
+	return off >= sizeof(*hdr)
+		&& off % 8 == 0
+		&& nitems <= hdr->size / itemsz
+		&& off <= hdr->size - nitems * itemsz;
+}
+
+static void unmap_bincache(struct bincache *bc)
+{
+	if (bc->map)
+		munmap(bc->map, bc->mapsz);
+	memset(bc, 0, sizeof(*bc));
+}
+
+/*
+ * Maps the file and verifies the header. Returns 0 on success.
+ */
+static int map_bincache(struct bincache *bc, int fd, size_t size)
+{
+	const struct bincache_header *hdr;
+
+	memset(bc, 0, sizeof(*bc));
+
+	if (size < sizeof(*hdr))
+		return -BLKID_ERR_CACHE;
+
+	bc->map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (bc->map == MAP_FAILED) {
+		bc->map = NULL;
+		return -errno;
+	}
+	bc->mapsz = size;
+	bc->hdr = hdr = (const struct bincache_header *) bc->map;
+
+	if (memcmp(hdr->magic, BINCACHE_MAGIC, BINCACHE_MAGIC_LEN) != 0
+	    || hdr->version != BINCACHE_VERSION
+	    || hdr->byteorder != BINCACHE_BYTEORDER
+	    || hdr->size != size
+	    || hdr->nbuckets == 0
+	    || (hdr->nbuckets & (hdr->nbuckets - 1))
+	    || !is_valid_section(hdr, hdr->devs_off, hdr->ndevs, sizeof(struct bincache_dev))
+	    || !is_valid_section(hdr, hdr->tags_off, hdr->ntags, sizeof(struct bincache_tag))
+	    || !is_valid_section(hdr, hdr->hash_off, hdr->nbuckets, sizeof(uint32_t))
+	    || !is_valid_section(hdr, hdr->str_off, hdr->strsz, 1)
+	    || hdr->strsz == 0)
+		goto err;
+
+	bc->devs = (const struct bincache_dev *) ((char *) bc->map + hdr->devs_off);
+	bc->tags = (const struct bincache_tag *) ((char *) bc->map + hdr->tags_off);
+	bc->hash = (const uint32_t *) ((char *) bc->map + hdr->hash_off);
+	bc->str = (const char *) bc->map + hdr->str_off;
+
+	/* all strings are terminated if the pool is terminated */
+	if (bc->str[hdr->strsz - 1] != '\0')
+		goto err;
+
+	return 0;
+err:
+	DBG(CACHE, ul_debug("binary cache: invalid header"));
+	unmap_bincache(bc);
+	return -BLKID_ERR_CACHE;
+}
+
+static inline const char *get_string(const struct bincache *bc, uint32_t off)
+{
+	return off < bc->hdr->strsz ? bc->str + off : NULL;
+}
+
+/*
+ * Reads binary cache from @fd (already verified by blkid_bincache_is_binary())
+ * to @cache. Returns 0 on success.
+ */
+int blkid_bincache_read(blkid_cache cache, int fd, struct stat *st)
+{
+	struct bincache bc;
+	uint32_t i, j;
+	int rc;
+
+	rc = map_bincache(&bc, fd, st->st_size);
+	if (rc)
+		return rc;
+
+	DBG(READ, ul_debug("binary cache: %u devices, %u tags",
+				bc.hdr->ndevs, bc.hdr->ntags));
+
+	for (i = 0; i < bc.hdr->ndevs; i++) {
+		const struct bincache_dev *bd = &bc.devs[i];
+		const char *name = get_string(&bc, bd->name);
+		blkid_dev dev;
+
+		if (!name || !*name || bd->tags > bc.hdr->ntags
+		    || bd->ntags > bc.hdr->ntags - bd->tags) {
+			DBG(READ, ul_debug("binary cache: bad device entry %u", i));
+			continue;
+		}
+
+		dev = blkid_get_dev(cache, name, BLKID_DEV_CREATE);
+		if (!dev) {
+			rc = -BLKID_ERR_MEM;
+			break;
+		}
+		dev->bid_devno = bd->devno;
+		dev->bid_time = bd->time;
+		dev->bid_utime = bd->utime;
+		dev->bid_pri = bd->pri;
+
+		for (j = 0; j < bd->ntags; j++) {
+			const struct bincache_tag *bt = &bc.tags[bd->tags + j];
+			const char *tname = get_string(&bc, bt->name);
+			const char *tval = get_string(&bc, bt->value);
+
+			if (tname && tval)
+				blkid_set_tag(dev, tname, tval, strlen(tval));
+		}
+
+		if (dev->bid_type == NULL) {
+			DBG(READ, ul_debug("blkid: device %s has no TYPE", dev->bid_name));
+			blkid_free_dev(dev);
+		}
+	}
+
+	unmap_bincache(&bc);
+	return rc;
+}
+
+/*
+ * Returns the name of the device with the highest priority from binary cache
+ * @filename which has @name=@value tag, or NULL. The result is not verified.
+ */
+char *blkid_bincache_lookup(const char *filename, const char *name, const char *value)
+{
+	struct bincache bc;
+	struct stat st;
+	const char *devname = NULL;
+	char *res = NULL;
+	uint32_t idx, n = 0;
+	int fd, pri = -1;
+
+	fd = open(filename, O_RDONLY|O_CLOEXEC);
+	if (fd < 0)
+		return NULL;
+	if (fstat(fd, &st) != 0 || !blkid_bincache_is_binary(fd)
+	    || map_bincache(&bc, fd, st.st_size) != 0) {
+		close(fd);
+		return NULL;
+	}
+	close(fd);
+
+	idx = bc.hash[hash_tag(name, value) & (bc.hdr->nbuckets - 1)];
+
+	/* the chain length is limited by number of tags (broken file) */
+	while (idx && idx <= bc.hdr->ntags && n++ < bc.hdr->ntags) {
+		const struct bincache_tag *bt = &bc.tags[idx - 1];
+		const char *tname = get_string(&bc, bt->name);
+		const char *tval = get_string(&bc, bt->value);
+
+		idx = bt->next;
+
+		if (!tname || !tval || bt->dev >= bc.hdr->ndevs
+		    || strcmp(tname, name) != 0 || strcmp(tval, value) != 0)
+			continue;
+
+		/* the chain is in reverse order, prefer the first device
+		 * in the cache like blkid_find_dev_with_tag() */
+		if (bc.devs[bt->dev].pri >= pri) {
+			const char *x = get_string(&bc, bc.devs[bt->dev].name);
+
+			if (x && access(x, F_OK) == 0) {
+				devname = x;
+				pri = bc.devs[bt->dev].pri;
+			}
+		}
+	}
+
+	if (devname)
+		res = strdup(devname);
+
+	DBG(CACHE, ul_debug("binary cache: %s=%s is %s", name, value, res));
+	unmap_bincache(&bc);
+	return res;
+}
+
+/*
+ * Strings pool for writer
+ */
+struct strpool {
+	char	*data;
+	size_t	len;
+	size_t	alloc;
+};
+
+static int strpool_add(struct strpool *sp, const char *str, uint32_t *off)
+{
+	size_t sz = strlen(str) + 1;
+
+	if (sp->len + sz > UINT32_MAX)
+		return -BLKID_ERR_MEM;
+	if (sp->len + sz > sp->alloc) {
+		size_t n = max(sp->alloc * 2, sp->len + sz + 4096);
+		char *tmp = realloc(sp->data, n);
+
+		if (!tmp)
+			return -BLKID_ERR_MEM;
+		sp->data = tmp;
+		sp->alloc = n;
+	}
+	memcpy(sp->data + sp->len, str, sz);
+	*off = sp->len;
+	sp->len += sz;
+	return 0;
+}
+
+static inline int is_saved_dev(blkid_dev dev)
+{
+	/* the same rules as for the text cache file */
+	return dev->bid_type && !(dev->bid_flags & BLKID_BID_FL_REMOVABLE)
+		&& dev->bid_name[0] == '/';
+}
+
+static int write_section(FILE *f, const void *data, size_t sz, uint64_t *pos)
+{
+	static const char zeros[8];
+	size_t pad = ALIGN8(*pos + sz) - (*pos + sz);
+
+	if ((sz && fwrite(data, 1, sz, f) != sz)
+	    || (pad && fwrite(zeros, 1, pad, f) != pad))
+		return errno ? -errno : -EIO;
+	*pos += sz + pad;
+	return 0;
+}
+
+/*
+ * Writes all devices from @cache to @f in the binary format.
+ */
+int blkid_bincache_write(blkid_cache cache, FILE *f)
+{
+	struct bincache_header hdr;
+	struct bincache_dev *devs = NULL;
+	struct bincache_tag *tags = NULL;
+	uint32_t *hash = NULL;
+	struct strpool sp = { .len = 0 };
+	struct list_head *p, *t;
+	uint32_t ndevs = 0, ntags = 0, nbuckets = 16, off;
+	uint64_t pos = 0;
+	int rc = -BLKID_ERR_MEM;
+
+	/* count */
+	list_for_each(p, &cache->bic_devs) {
+		blkid_dev dev = list_entry(p, struct blkid_struct_dev, bid_devs);
+
+		if (!is_saved_dev(dev))
+			continue;
+		ndevs++;
+		list_for_each(t, &dev->bid_tags)
+			ntags++;
+	}
+	while (nbuckets < ntags * 2 && nbuckets < (1U << 30))
+		nbuckets <<= 1;
+
+	devs = calloc(max(ndevs, 1U), sizeof(*devs));
+	tags = calloc(max(ntags, 1U), sizeof(*tags));
+	hash = calloc(nbuckets, sizeof(*hash));
+	if (!devs || !tags || !hash)
+		goto done;
+
+	/* offset 0 in the pool is an empty string */
+	if (strpool_add(&sp, "", &off) != 0)
+		goto done;
+
+	ndevs = ntags = 0;
+	list_for_each(p, &cache->bic_devs) {
+		blkid_dev dev = list_entry(p, struct blkid_struct_dev, bid_devs);
+		struct bincache_dev *bd = &devs[ndevs];
+
+		if (!is_saved_dev(dev))
+			continue;
+
+		DBG(SAVE, ul_debug("device %s, type %s (binary)", dev->bid_name,
+				dev->bid_type));
+
+		bd->devno = dev->bid_devno;
+		bd->time = dev->bid_time;
+		bd->utime = dev->bid_utime;
+		bd->pri = dev->bid_pri;
+		bd->tags = ntags;
+		if (strpool_add(&sp, dev->bid_name, &bd->name) != 0)
+			goto done;
+
+		list_for_each(t, &dev->bid_tags) {
+			blkid_tag tag = list_entry(t, struct blkid_struct_tag, bit_tags);
+			struct bincache_tag *bt = &tags[ntags];
+			uint32_t h = hash_tag(tag->bit_name, tag->bit_val) & (nbuckets - 1);
+
+			if (strpool_add(&sp, tag->bit_name, &bt->name) != 0 ||
+			    strpool_add(&sp, tag->bit_val, &bt->value) != 0)
+				goto done;
+			bt->dev = ndevs;
+			bt->next = hash[h];
+			hash[h] = ++ntags;
+			bd->ntags++;
+		}
+		ndevs++;
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, BINCACHE_MAGIC, BINCACHE_MAGIC_LEN);
+	hdr.version = BINCACHE_VERSION;
+	hdr.byteorder = BINCACHE_BYTEORDER;
+	hdr.ndevs = ndevs;
+	hdr.ntags = ntags;
+	hdr.nbuckets = nbuckets;
+	hdr.strsz = sp.len;
+
+	hdr.devs_off = ALIGN8(sizeof(hdr));
+	hdr.tags_off = hdr.devs_off + ALIGN8(ndevs * sizeof(*devs));
+	hdr.hash_off = hdr.tags_off + ALIGN8(ntags * sizeof(*tags));
+	hdr.str_off = hdr.hash_off + ALIGN8(nbuckets * sizeof(*hash));
+	hdr.size = hdr.str_off + ALIGN8(sp.len);
+
+	if ((rc = write_section(f, &hdr, sizeof(hdr), &pos)) ||
+	    (rc = write_section(f, devs, ndevs * sizeof(*devs), &pos)) ||
+	    (rc = write_section(f, tags, ntags * sizeof(*tags), &pos)) ||
+	    (rc = write_section(f, hash, nbuckets * sizeof(*hash), &pos)) ||
+	    (rc = write_section(f, sp.data, sp.len, &pos)))
+		goto done;
+
+	rc = 0;
+done:
+	free(devs);
+	free(tags);
+	free(hash);
+	free(sp.data);
+	return rc;
+}
+
+#ifdef TEST_PROGRAM
+static void dump_cache(blkid_cache cache)
+{
+	blkid_dev_iterate iter;
+	blkid_dev dev;
+
+	iter = blkid_dev_iterate_begin(cache);
+	while (blkid_dev_next(iter, &dev) == 0) {
+		blkid_tag_iterate titer;
+		const char *type, *value;
+
+		printf("%s (pri=%d)", blkid_dev_devname(dev), dev->bid_pri);
+		titer = blkid_tag_iterate_begin(dev);
+		while (blkid_tag_next(titer, &type, &value) == 0)
+			printf(" %s=\"%s\"", type, value);
+		blkid_tag_iterate_end(titer);
+		fputc('\n', stdout);
+	}
+	blkid_dev_iterate_end(iter);
+}
+
+int main(int argc, char **argv)
+{
+	blkid_cache cache = NULL;
+	int i, fd, rc;
+
+	if (argc < 3) {
+		fprintf(stderr, "Usage: %s <text-cache> <binary-cache> [NAME=value ...]\n"
+			"Convert the cache to the binary format, read it back "
+			"and look up the tags in the index\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (blkid_get_cache(&cache, argv[1]) != 0)
+		return EXIT_FAILURE;
+	printf("text cache (binary=%d):\n",
+			!!(cache->bic_flags & BLKID_BIC_FL_BINARY));
+	dump_cache(cache);
+
+	free(cache->bic_filename);
+	cache->bic_filename = strdup(argv[2]);
+	cache->bic_flags |= BLKID_BIC_FL_BINARY | BLKID_BIC_FL_CHANGED;
+	rc = blkid_flush_cache(cache);
+	blkid_put_cache(cache);
+	if (rc < 0) {
+		fprintf(stderr, "%s: failed to write (rc=%d)\n", argv[2], rc);
+		return EXIT_FAILURE;
+	}
+
+	fd = open(argv[2], O_RDONLY|O_CLOEXEC);
+	if (fd < 0)
+		return EXIT_FAILURE;
+	printf("written binary: %d\n", blkid_bincache_is_binary(fd));
+	close(fd);
+
+	cache = NULL;
+	if (blkid_get_cache(&cache, argv[2]) != 0)
+		return EXIT_FAILURE;
+	printf("binary cache (binary=%d):\n",
+			!!(cache->bic_flags & BLKID_BIC_FL_BINARY));
+	dump_cache(cache);
+	blkid_put_cache(cache);
+
+	for (i = 3; i < argc; i++) {
+		char *name = strdup(argv[i]), *value, *res;
+
+		if (!name)
+			return EXIT_FAILURE;
+		value = strchr(name, '=');
+		if (!value) {
+			free(name);
+			continue;
+		}
+		*value++ = '\0';
+		res = blkid_bincache_lookup(argv[2], name, value);
+		printf("%s=%s: %s\n", name, value, res ? res : "<none>");
+		free(res);
+		free(name);
+	}
+
+	return EXIT_SUCCESS;
+}
+#endif /* TEST_PROGRAM */
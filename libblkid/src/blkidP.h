@@ -262,6 +262,7 @@ struct blkid_config {
 	int nevals;			/* number of elems in eval array */
 	int uevent;			/* SEND_UEVENT=<yes|not> option */
 	char *cachefile;		/* CACHE_FILE=<path> option */
+	int binary_cache;		/* CACHE_FORMAT=<text|binary> option */
 };
 
 extern struct blkid_config *blkid_read_config(const char *filename)
@@ -297,10 +298,42 @@ struct blkid_struct_cache
 	unsigned int		bic_flags;	/* Status flags of the cache */
 	char			*bic_filename;	/* filename of cache */
 	blkid_probe		probe;		/* low-level probing stuff */
+
+	unsigned int		bic_njobs;	/* number of probing threads */
+	struct blkid_preprobe	*bic_preprobed;	/* results probed in advance */
+	size_t			bic_npreprobed;	/* number of the results */
 };
 
 #define BLKID_BIC_FL_PROBED	0x0002	/* We probed /proc/partition devices */
 #define BLKID_BIC_FL_CHANGED	0x0004	/* Cache has changed from disk */
+#define BLKID_BIC_FL_BINARY	0x0008	/* Write cache in binary format */
+
+/*
+ * Device probing result gathered in advance by a probing thread, see
+ * blkid_cache_set_jobs(). The result is used by blkid_verify() instead of
+ * probing the device again.
+ */
+struct blkid_preprobe_tag {
+	char		*name;
+	char		*data;
+	size_t		len;
+};
+
+struct blkid_preprobe {
+	dev_t		devno;
+	int		rc;		/* blkid_do_safeprobe() return code */
+
+	struct blkid_preprobe_tag *tags;
+	size_t		ntags;
+};
+
+/* verify.c */
+extern int blkid_dev_is_fresh(blkid_dev dev, const struct stat *st, time_t now)
+			__attribute__((nonnull));
+extern int blkid_preprobe_device(blkid_probe pr, const char *devname,
+				 struct blkid_preprobe *res)
+			__attribute__((nonnull));
+extern void blkid_free_preprobed(blkid_cache cache);
 
 /* config file */
 #define BLKID_CONFIG_FILE	"/etc/blkid.conf"
@@ -396,6 +429,19 @@ extern int blkid_set_tag(blkid_dev dev, const char *name,
 			 const char *value, const int vlength)
 			__attribute__((nonnull(1,2)));
 
+/*
+ * Binary cache file: bincache.c
+ */
+extern int blkid_bincache_is_binary(int fd);
+extern int blkid_bincache_read(blkid_cache cache, int fd, struct stat *st)
+			__attribute__((nonnull));
+extern int blkid_bincache_write(blkid_cache cache, FILE *f)
+			__attribute__((nonnull));
+extern char *blkid_bincache_lookup(const char *filename, const char *name,
+				   const char *value)
+			__attribute__((nonnull))
+			__attribute__((warn_unused_result));
+
 /*
  * Functions to create and find a specific tag type: dev.c
  */
@@ -420,6 +466,15 @@ extern unsigned char *blkid_probe_get_sector(blkid_probe pr, unsigned int sector
 			__attribute__((nonnull))
 			__attribute__((warn_unused_result));
 
+/* max. gap between two prefetched areas to read them by one read() */
+#define BLKID_PREFETCH_GAP	(32 * 1024)
+/* max. size of one prefetched extent */
+#define BLKID_PREFETCH_MAXSZ	(1024 * 1024)
+
+extern int blkid_probe_prefetch_buffers(blkid_probe pr, uint64_t *offs,
+				size_t noffs, uint64_t len)
+			__attribute__((nonnull));
+
 extern int blkid_probe_get_dimension(blkid_probe pr,
 	                uint64_t *off, uint64_t *size)
 			__attribute__((nonnull));
@@ -93,6 +93,7 @@ char *blkid_get_cache_filename(struct blkid_config *conf)
 int blkid_get_cache(blkid_cache *ret_cache, const char *filename)
 {
 	blkid_cache cache;
+	struct blkid_config *conf;
 
 	if (!ret_cache)
 		return -BLKID_ERR_PARAM;
@@ -108,12 +109,25 @@ int blkid_get_cache(blkid_cache *ret_cache, const char *filename)
 
 	if (filename && !*filename)
 		filename = NULL;
+
+	/* The config file is parsed for the default cache only. An explicitly
+	 * specified cache file keeps the format it has been read in. */
+	conf = filename ? NULL : blkid_read_config(NULL);
 	if (filename)
 		cache->bic_filename = strdup(filename);
 	else
-		cache->bic_filename = blkid_get_cache_filename(NULL);
+		cache->bic_filename = conf ? blkid_get_cache_filename(conf) :
+					     blkid_get_cache_filename(NULL);
 
 	blkid_read_cache(cache);
+
+	if (conf) {
+		if (conf->binary_cache)
+			cache->bic_flags |= BLKID_BIC_FL_BINARY;
+		else
+			cache->bic_flags &= ~BLKID_BIC_FL_BINARY;
+		blkid_free_config(conf);
+	}
 	*ret_cache = cache;
 	return 0;
 }
@@ -161,11 +175,39 @@ void blkid_put_cache(blkid_cache cache)
 	}
 
 	blkid_free_probe(cache->probe);
+	blkid_free_preprobed(cache);
 
 	free(cache->bic_filename);
 	free(cache);
 }
 
+/**
+ * blkid_cache_set_jobs:
+ * @cache: cache handler
+ * @njobs: number of probing threads
+ *
+ * Sets the number of threads used to probe devices by blkid_probe_all(),
+ * blkid_probe_all_new() and blkid_probe_all_removable(). Every thread uses its
+ * own low-level prober, the results are added to the cache in the same order
+ * as by the serial scan, so the cache content does not depend on @njobs.
+ *
+ * The default is 1 (no threads). It's usable on systems with many slow
+ * devices (multipath, network storage, etc.).
+ *
+ * Returns: 0 on success or number less than zero in case of error.
+ *
+ * Since: 2.38
+ */
+int blkid_cache_set_jobs(blkid_cache cache, unsigned int njobs)
+{
+	if (!cache)
+		return -BLKID_ERR_PARAM;
+
+	DBG(CACHE, ul_debugobj(cache, "set number of probing jobs to %u", njobs));
+	cache->bic_njobs = njobs;
+	return 0;
+}
+
 /**
  * blkid_gc_cache:
  * @cache: cache handler
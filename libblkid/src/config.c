@@ -100,6 +100,17 @@ static int parse_next(FILE *fd, struct blkid_config *conf)
 			conf->cachefile = strdup(s);
 		else
 			conf->cachefile = NULL;
+	} else if (!strncmp(s, "CACHE_FORMAT=", 13)) {
+		s += 13;
+		if (*s && !strcasecmp(s, "binary"))
+			conf->binary_cache = TRUE;
+		else if (*s && !strcasecmp(s, "text"))
+			conf->binary_cache = FALSE;
+		else {
+			DBG(CONFIG, ul_debug(
+				"config file: unknown cache format '%s'.", s));
+			return -1;
+		}
 	} else if (!strncmp(s, "EVALUATE=", 9)) {
 		s += 9;
 		if (*s && parse_evaluate(conf, s) == -1)
@@ -194,6 +205,7 @@ int main(int argc, char *argv[])
 
 	printf("SEND UEVENT: %s\n", conf->uevent ? "TRUE" : "FALSE");
 	printf("CACHE_FILE:  %s\n", conf->cachefile);
+	printf("CACHE_FORMAT: %s\n", conf->binary_cache ? "binary" : "text");
 
 	blkid_free_config(conf);
 	return EXIT_SUCCESS;
@@ -33,6 +33,7 @@
 #include <errno.h>
 #endif
 #include <time.h>
+#include <pthread.h>
 
 #include "blkidP.h"
 
@@ -415,6 +416,204 @@ ubi_probe_all(blkid_cache cache, int only_if_new)
 	}
 }
 
+/*
+ * Devices found by sysfs_probe_all(). The list is used by probing threads to
+ * probe the devices in advance and then to add the devices to the cache in
+ * the original order.
+ */
+struct sysfs_dev {
+	char	*name;		/* kernel name (e.g. sda1) */
+	dev_t	devno;
+	int	remove;		/* remove partitioned whole-disk from cache */
+};
+
+struct sysfs_devlist {
+	struct sysfs_dev	*devs;
+	size_t			ndevs;
+	size_t			nalloc;
+};
+
+static int add_sysfs_dev(struct sysfs_devlist *ls, const char *name,
+			 dev_t devno, int remove)
+{
+	struct sysfs_dev *d;
+
+	if (ls->ndevs == ls->nalloc) {
+		size_t n = ls->nalloc ? ls->nalloc * 2 : 64;
+		struct sysfs_dev *tmp = realloc(ls->devs, n * sizeof(*tmp));
+
+		if (!tmp)
+			return -ENOMEM;
+		ls->devs = tmp;
+		ls->nalloc = n;
+	}
+
+	d = &ls->devs[ls->ndevs];
+	d->name = strdup(name);
+	if (!d->name)
+		return -ENOMEM;
+	d->devno = devno;
+	d->remove = remove;
+	ls->ndevs++;
+	return 0;
+}
+
+static void free_sysfs_devlist(struct sysfs_devlist *ls)
+{
+	size_t i;
+
+	for (i = 0; i < ls->ndevs; i++)
+		free(ls->devs[i].name);
+	free(ls->devs);
+}
+
+struct preprobe_pool {
+	blkid_cache		cache;
+	struct sysfs_devlist	*list;
+	struct blkid_preprobe	*res;	/* results, the same order as list */
+	int			*done;	/* successfully probed */
+	int			only_if_new;
+
+	size_t			next;	/* the next device to probe */
+	pthread_mutex_t		lock;
+};
+
+/*
+ * Returns 1 if there is no reason to probe @devno in advance, the device is
+ * already in the cache and probe_one() ignores it (@only_if_new), or the
+ * cached data are fresh and blkid_verify() does not probe the device.
+ */
+static int skip_preprobe(blkid_cache cache, dev_t devno, int only_if_new,
+			 time_t now)
+{
+	struct list_head *p;
+
+	list_for_each(p, &cache->bic_devs) {
+		blkid_dev tmp = list_entry(p, struct blkid_struct_dev, bid_devs);
+		struct stat st;
+
+		if (tmp->bid_devno != devno)
+			continue;
+		if (only_if_new)
+			return 1;
+		return stat(tmp->bid_name, &st) == 0
+			&& blkid_dev_is_fresh(tmp, &st, now);
+	}
+	return 0;
+}
+
+/*
+ * Probing thread. The cache is read-only while the threads are running, the
+ * results are stored to the pool and used by blkid_verify() later.
+ */
+static void *preprobe_thread(void *data)
+{
+	struct preprobe_pool *pool = (struct preprobe_pool *) data;
+	blkid_probe pr = blkid_new_probe();
+	time_t now = time(NULL);
+
+	if (!pr)
+		return NULL;
+
+	for (;;) {
+		struct sysfs_dev *d;
+		const char **dir;
+		size_t i;
+
+		pthread_mutex_lock(&pool->lock);
+		i = pool->next++;
+		pthread_mutex_unlock(&pool->lock);
+
+		if (i >= pool->list->ndevs)
+			break;
+		d = &pool->list->devs[i];
+		if (d->remove)
+			continue;
+		if (skip_preprobe(pool->cache, d->devno, pool->only_if_new, now))
+			continue;
+
+		/* the same directories as probe_one(), if the device is not
+		 * found, then blkid_verify() probes it in usual way */
+		for (dir = dirlist; *dir; dir++) {
+			char device[256];
+
+			snprintf(device, sizeof(device), "%s/%s", *dir, d->name);
+			pool->res[i].devno = d->devno;
+			if (blkid_preprobe_device(pr, device, &pool->res[i]) == 0) {
+				pool->done[i] = 1;
+				break;
+			}
+		}
+	}
+
+	blkid_free_probe(pr);
+	return NULL;
+}
+
+static int cmp_preprobed(const void *a, const void *b)
+{
+	const struct blkid_preprobe *x = a, *y = b;
+
+	return x->devno < y->devno ? -1 : x->devno > y->devno ? 1 : 0;
+}
+
+/*
+ * Probe all devices from @ls by cache->bic_njobs threads and store the
+ * results to the cache.
+ */
+static int sysfs_preprobe_all(blkid_cache cache, struct sysfs_devlist *ls,
+			      int only_if_new)
+{
+	struct preprobe_pool pool = {
+		.cache = cache,
+		.list = ls,
+		.only_if_new = only_if_new
+	};
+	pthread_t *threads;
+	size_t i, nthreads = 0, nres = 0;
+
+	if (cache->bic_njobs <= 1 || ls->ndevs < 2)
+		return 0;
+
+	threads = calloc(cache->bic_njobs, sizeof(pthread_t));
+	pool.res = calloc(ls->ndevs, sizeof(struct blkid_preprobe));
+	pool.done = calloc(ls->ndevs, sizeof(int));
+	if (!threads || !pool.res || !pool.done)
+		goto done;
+
+	pthread_mutex_init(&pool.lock, NULL);
+
+	for (i = 0; i < cache->bic_njobs && i < ls->ndevs; i++) {
+		if (pthread_create(&threads[nthreads], NULL, preprobe_thread, &pool) != 0)
+			break;
+		nthreads++;
+	}
+
+	DBG(PROBE, ul_debug("probing %zu devices by %zu threads", ls->ndevs, nthreads));
+
+	for (i = 0; i < nthreads; i++)
+		pthread_join(threads[i], NULL);
+
+	pthread_mutex_destroy(&pool.lock);
+
+	/* keep successful results only, sorted by devno for blkid_verify() */
+	for (i = 0; i < ls->ndevs; i++) {
+		if (pool.done[i])
+			pool.res[nres++] = pool.res[i];
+	}
+	qsort(pool.res, nres, sizeof(struct blkid_preprobe), cmp_preprobed);
+
+	blkid_free_preprobed(cache);
+	cache->bic_preprobed = pool.res;
+	cache->bic_npreprobed = nres;
+	pool.res = NULL;
+done:
+	free(threads);
+	free(pool.res);
+	free(pool.done);
+	return 0;
+}
+
 /*
  * This function uses /sys to read all block devices in way compatible with
  * /proc/partitions (like the original libblkid implementation)
@@ -424,6 +623,8 @@ sysfs_probe_all(blkid_cache cache, int only_if_new, int only_removable)
 {
 	DIR *sysfs;
 	struct dirent *dev;
+	struct sysfs_devlist ls = { .ndevs = 0 };
+	size_t i;
 
 	sysfs = opendir(_PATH_SYS_BLOCK);
 	if (!sysfs)
@@ -496,29 +697,17 @@ sysfs_probe_all(blkid_cache cache, int only_if_new, int only_removable)
 			DBG(DEVNAME, ul_debug(" Probe partition dev %s, devno 0x%04X",
                                    part->d_name, (unsigned int) partno));
 			nparts++;
-			probe_one(cache, part->d_name, partno, 0, only_if_new, 0);
+			add_sysfs_dev(&ls, part->d_name, partno, 0);
 		}
 
 		if (!nparts) {
 			/* add non-partitioned whole disk to cache */
 			DBG(DEVNAME, ul_debug(" Probe whole dev %s, devno 0x%04X",
 				   dev->d_name, (unsigned int) devno));
-			probe_one(cache, dev->d_name, devno, 0, only_if_new, 0);
-		} else {
+			add_sysfs_dev(&ls, dev->d_name, devno, 0);
+		} else
 			/* remove partitioned whole-disk from cache */
-			struct list_head *p, *pnext;
-
-			list_for_each_safe(p, pnext, &cache->bic_devs) {
-				blkid_dev tmp = list_entry(p, struct blkid_struct_dev,
-							bid_devs);
-				if (tmp->bid_devno == devno) {
-					DBG(DEVNAME, ul_debug(" freeing %s", tmp->bid_name));
-					blkid_free_dev(tmp);
-					cache->bic_flags |= BLKID_BIC_FL_CHANGED;
-					break;
-				}
-			}
-		}
+			add_sysfs_dev(&ls, dev->d_name, devno, 1);
 	next:
 		if (dir)
 			closedir(dir);
@@ -527,6 +716,32 @@ sysfs_probe_all(blkid_cache cache, int only_if_new, int only_removable)
 	}
 
 	closedir(sysfs);
+
+	sysfs_preprobe_all(cache, &ls, only_if_new);
+
+	for (i = 0; i < ls.ndevs; i++) {
+		struct sysfs_dev *d = &ls.devs[i];
+		struct list_head *p, *pnext;
+
+		if (!d->remove) {
+			probe_one(cache, d->name, d->devno, 0, only_if_new, 0);
+			continue;
+		}
+
+		list_for_each_safe(p, pnext, &cache->bic_devs) {
+			blkid_dev tmp = list_entry(p, struct blkid_struct_dev,
+						bid_devs);
+			if (tmp->bid_devno == d->devno) {
+				DBG(DEVNAME, ul_debug(" freeing %s", tmp->bid_name));
+				blkid_free_dev(tmp);
+				cache->bic_flags |= BLKID_BIC_FL_CHANGED;
+				break;
+			}
+		}
+	}
+
+	blkid_free_preprobed(cache);
+	free_sysfs_devlist(&ls);
 	return 0;
 }
 
@@ -49,7 +49,6 @@
  * API.
  */
 
-#ifdef CONFIG_BLKID_VERIFY_UDEV
 /* returns zero when the device has NAME=value (LABEL/UUID) */
 static int verify_tag(const char *devname, const char *name, const char *value)
 {
@@ -59,7 +58,7 @@ static int verify_tag(const char *devname, const char *name, const char *value)
 	const char *data;
 	int errsv = 0;
 
-	if (strcmp(token, "ID") == 0)
+	if (strcmp(name, "ID") == 0)
 		return 0; /* non-content tag */
 
 	pr = blkid_new_probe();
@@ -96,7 +95,6 @@ done:
 	/* for non-root users we use unverified udev links */
 	return errsv == EACCES ? 0 : rc;
 }
-#endif /* CONFIG_BLKID_VERIFY_UDEV*/
 
 /**
  * blkid_send_uevent:
@@ -200,8 +198,30 @@ static char *evaluate_by_scan(const char *token, const char *value,
 
 	if (!c) {
 		char *cachefile = blkid_get_cache_filename(conf);
+
+		/* binary cache: use the index and verify the device,
+		 * the cache is not read at all */
+		if (cachefile && conf && conf->binary_cache &&
+		    (strcmp(token, "LABEL") == 0 || strcmp(token, "UUID") == 0)) {
+			res = blkid_bincache_lookup(cachefile, token, value);
+			if (res && verify_tag(res, token, value) != 0) {
+				free(res);
+				res = NULL;
+			}
+			if (res) {
+				free(cachefile);
+				return res;
+			}
+		}
 		blkid_get_cache(&c, cachefile);
 		free(cachefile);
+
+		if (c && conf) {
+			if (conf->binary_cache)
+				c->bic_flags |= BLKID_BIC_FL_BINARY;
+			else
+				c->bic_flags &= ~BLKID_BIC_FL_BINARY;
+		}
 	}
 	if (!c)
 		return NULL;
@@ -695,6 +695,76 @@ unsigned char *blkid_probe_get_buffer(blkid_probe pr, uint64_t off, uint64_t len
 	return real_off ? bf->data + (real_off - bf->off) : bf->data;
 }
 
+static int cmp_offsets(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+
+	return x < y ? -1 : x > y ? 1 : 0;
+}
+
+/*
+ * Read areas (@offs[] within probing area, all @len bytes) to the list of the
+ * cached buffers before probing functions ask for them.
+ *
+ * The areas are sorted and merged to larger extents when the gap between
+ * them is small (BLKID_PREFETCH_GAP); every extent is read by one read()
+ * call. It's cheaper to read a few unnecessary kilobytes than to call
+ * lseek()+read() for every small superblock window.
+ *
+ * The @offs array is sorted in place. Areas out of the probing area are
+ * ignored. I/O errors are ignored too -- the areas will be read later by
+ * blkid_probe_get_buffer() with the usual error handling.
+ */
+int blkid_probe_prefetch_buffers(blkid_probe pr, uint64_t *offs, size_t noffs,
+				 uint64_t len)
+{
+	size_t i = 0, nexts = 0;
+
+	if (!noffs || !len || pr->size == 0 || S_ISCHR(pr->mode))
+		return 0;
+
+	/* cloned probers use parent's buffers */
+	if (pr->parent)
+		return 0;
+
+	qsort(offs, noffs, sizeof(uint64_t), cmp_offsets);
+
+	while (i < noffs) {
+		uint64_t start = offs[i], end = offs[i] + len;
+		struct blkid_bufinfo *bf;
+
+		if (end > pr->size)
+			break;		/* sorted, the rest is out of area too */
+
+		for (i++; i < noffs; i++) {
+			uint64_t next_end = offs[i] + len;
+
+			if (offs[i] > end + BLKID_PREFETCH_GAP
+			    || next_end - start > BLKID_PREFETCH_MAXSZ
+			    || next_end > pr->size)
+				break;
+			if (next_end > end)
+				end = next_end;
+		}
+
+		if (get_cached_buffer(pr, start, end - start))
+			continue;
+
+		DBG(BUFFER, ul_debug("\tprefetch: off=%"PRIu64" len=%"PRIu64,
+					start, end - start));
+
+		bf = read_buffer(pr, pr->off + start, end - start);
+		if (!bf)
+			continue;
+		list_add_tail(&bf->bufs, &pr->buffers);
+		nexts++;
+	}
+
+	DBG(LOWPROBE, ul_debug("prefetched %zu areas by %zu read() calls",
+				noffs, nexts));
+	return 0;
+}
+
 /**
  * blkid_probe_reset_buffers:
  * @pr: prober
@@ -394,6 +394,15 @@ void blkid_read_cache(blkid_cache cache)
 	DBG(CACHE, ul_debug("reading cache file %s",
 				cache->bic_filename));
 
+	if (blkid_bincache_is_binary(fd)) {
+		cache->bic_flags |= BLKID_BIC_FL_BINARY;
+		if (blkid_bincache_read(cache, fd, &st) != 0)
+			DBG(READ, ul_debug("blkid: bad binary cache %s",
+					cache->bic_filename));
+		close(fd);
+		goto done;
+	}
+
 	file = fdopen(fd, "r" UL_CLOEXECSTR);
 	if (!file)
 		goto errout;
@@ -419,7 +428,7 @@ void blkid_read_cache(blkid_cache cache)
 		}
 	}
 	fclose(file);
-
+done:
 	/*
 	 * Initially we do not need to write out the cache file.
 	 */
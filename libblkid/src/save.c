@@ -157,12 +157,16 @@ int blkid_flush_cache(blkid_cache cache)
 		goto errout;
 	}
 
-	list_for_each(p, &cache->bic_devs) {
-		blkid_dev dev = list_entry(p, struct blkid_struct_dev, bid_devs);
-		if (!dev->bid_type || (dev->bid_flags & BLKID_BID_FL_REMOVABLE))
-			continue;
-		if ((ret = save_dev(dev, file)) < 0)
-			break;
+	if (cache->bic_flags & BLKID_BIC_FL_BINARY)
+		ret = blkid_bincache_write(cache, file);
+	else {
+		list_for_each(p, &cache->bic_devs) {
+			blkid_dev dev = list_entry(p, struct blkid_struct_dev, bid_devs);
+			if (!dev->bid_type || (dev->bid_flags & BLKID_BID_FL_REMOVABLE))
+				continue;
+			if ((ret = save_dev(dev, file)) < 0)
+				break;
+		}
 	}
 
 	if (ret >= 0) {
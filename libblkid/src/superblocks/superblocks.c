@@ -83,6 +83,11 @@ static int superblocks_safeprobe(blkid_probe pr, struct blkid_chain *chn);
 
 static int blkid_probe_set_usage(blkid_probe pr, int usage);
 
+static void superblocks_free_data(blkid_probe pr, void *data);
+
+/* max. number of magic strings in the index */
+#define SUPERBLOCKS_NMAGICS	256
+
 
 /*
  * Superblocks chains probing functions
@@ -185,6 +190,29 @@ const struct blkid_chaindrv superblocks_drv = {
 	.has_fltr     = TRUE,
 	.probe        = superblocks_probe,
 	.safeprobe    = superblocks_safeprobe,
+	.free_data    = superblocks_free_data
+};
+
+/*
+ * Magic strings index -- all magic strings with fixed location sorted by
+ * offset of the 1KiB area where blkid_probe_get_idmag() looks for them.
+ */
+struct sb_magic {
+	uint64_t		 off;	/* offset of the area */
+	const struct blkid_idmag *mag;
+	size_t			 idx;	/* idinfos[] index */
+};
+
+struct sb_index {
+	struct sb_magic	mags[SUPERBLOCKS_NMAGICS];
+	size_t		nmags;
+
+	/* probers without magic strings or with hint/zone based offsets */
+	unsigned long	always[blkid_bmp_nwords(ARRAY_SIZE(idinfos))];
+
+	/* probers where a magic string has been found by the last scan */
+	unsigned long	found[blkid_bmp_nwords(ARRAY_SIZE(idinfos))];
+	unsigned int	scanned : 1;	/* found[] is valid */
 };
 
 /**
@@ -339,10 +367,175 @@ int blkid_superblocks_get_name(size_t idx, const char **name, int *usage)
 /*
  * The blkid_do_probe() backend.
  */
+/*
+ * Returns 0 if it does not make sense to probe for @id on the device.
+ */
+static int idinfo_is_usable(blkid_probe pr, const struct blkid_idinfo *id)
+{
+	/* the device is too small */
+	if (id->minsz && (unsigned)id->minsz > pr->size)
+		return 0;
+
+	/* don't probe for RAIDs, swap or journal on CD/DVDs */
+	if ((id->usage & (BLKID_USAGE_RAID | BLKID_USAGE_OTHER)) &&
+	    blkid_probe_is_cdrom(pr))
+		return 0;
+
+	/* don't probe for RAIDs on floppies */
+	if ((id->usage & BLKID_USAGE_RAID) && blkid_probe_is_tiny(pr))
+		return 0;
+
+	return 1;
+}
+
+static int cmp_sb_magics(const void *a, const void *b)
+{
+	const struct sb_magic *x = a, *y = b;
+
+	if (x->off != y->off)
+		return x->off < y->off ? -1 : 1;
+	return x->idx < y->idx ? -1 : x->idx > y->idx ? 1 : 0;
+}
+
+static struct sb_index *superblocks_get_index(struct blkid_chain *chn)
+{
+	struct sb_index *ix = (struct sb_index *) chn->data;
+	size_t i;
+
+	if (ix)
+		return ix;
+
+	ix = calloc(1, sizeof(*ix));
+	if (!ix)
+		return NULL;
+
+	for (i = 0; i < ARRAY_SIZE(idinfos); i++) {
+		const struct blkid_idinfo *id = idinfos[i];
+		const struct blkid_idmag *mag = &id->magics[0];
+
+		if (!mag->magic) {
+			blkid_bmp_set_item(ix->always, i);
+			continue;
+		}
+		for ( ; mag->magic; mag++) {
+			if (mag->hoff || mag->is_zoned
+			    || ix->nmags == ARRAY_SIZE(ix->mags)
+			    || (mag->sboff & 0x3ff) + mag->len > 1024) {
+				blkid_bmp_set_item(ix->always, i);
+				continue;
+			}
+			ix->mags[ix->nmags].off = ((uint64_t) mag->kboff + (mag->sboff >> 10)) << 10;
+			ix->mags[ix->nmags].mag = mag;
+			ix->mags[ix->nmags].idx = i;
+			ix->nmags++;
+		}
+	}
+
+	qsort(ix->mags, ix->nmags, sizeof(struct sb_magic), cmp_sb_magics);
+
+	DBG(LOWPROBE, ul_debug("magic strings index: %zu magics", ix->nmags));
+	chn->data = (void *) ix;
+	return ix;
+}
+
+static void superblocks_free_data(blkid_probe pr __attribute__((__unused__)),
+				  void *data)
+{
+	free(data);
+}
+
+static inline int is_wanted_idinfo(blkid_probe pr, struct blkid_chain *chn, size_t idx)
+{
+	if (chn->fltr && blkid_bmp_get_item(chn->fltr, idx))
+		return 0;
+	return idinfo_is_usable(pr, idinfos[idx]);
+}
+
+/*
+ * Read locations of the magic strings for all enabled probers from the
+ * device by a few larger reads. The probing loop then gets the data from
+ * memory. The magic strings with offset defined by hint or zone are not in
+ * the index, they are read on demand.
+ */
+static void superblocks_prefetch(blkid_probe pr, struct blkid_chain *chn,
+				 struct sb_index *ix)
+{
+	uint64_t offs[SUPERBLOCKS_NMAGICS];
+	size_t i, n = 0;
+
+	for (i = 0; i < ix->nmags; i++) {
+		if (!is_wanted_idinfo(pr, chn, ix->mags[i].idx))
+			continue;
+		if (n && offs[n - 1] == ix->mags[i].off)
+			continue;
+		offs[n++] = ix->mags[i].off;
+	}
+
+	blkid_probe_prefetch_buffers(pr, offs, n, 1024);
+}
+
+/*
+ * Read every area from the index only once and compare all magic strings
+ * expected in the area. Returns bitmap with probers which make sense to
+ * call (a magic string found, or the magic is not in the index), or NULL
+ * on error; in this case all probers have to be called.
+ */
+static unsigned long *superblocks_scan_magics(blkid_probe pr, struct blkid_chain *chn)
+{
+	struct sb_index *ix = superblocks_get_index(chn);
+	size_t i = 0;
+
+	if (!ix)
+		return NULL;
+
+	/* The probing loop continues after the last result (blkid_do_probe()
+	 * or blkid_probe_step_back()), the previous scan is still valid. The
+	 * device is modified only by wiping at this point, and zeroed areas
+	 * cannot contain a new magic string. Any change of the device or the
+	 * filter resets the chain position, so the scan is done again. */
+	if (chn->idx >= 0 && ix->scanned) {
+		DBG(LOWPROBE, ul_debug("magic strings index: reuse last scan"));
+		return ix->found;
+	}
+
+	superblocks_prefetch(pr, chn, ix);
+
+	memcpy(ix->found, ix->always, sizeof(ix->found));
+
+	while (i < ix->nmags) {
+		uint64_t off = ix->mags[i].off;
+		unsigned char *buf = NULL;
+		int wanted = 0, ioerr = 0;
+		size_t end;
+
+		/* read the area only if any enabled prober needs it */
+		for (end = i; end < ix->nmags && ix->mags[end].off == off; end++)
+			wanted |= is_wanted_idinfo(pr, chn, ix->mags[end].idx);
+
+		if (wanted) {
+			buf = blkid_probe_get_buffer(pr, off, 1024);
+			ioerr = !buf && errno;
+		}
+
+		for ( ; i < end; i++) {
+			const struct blkid_idmag *mag = ix->mags[i].mag;
+
+			/* I/O error is reported later by blkid_probe_get_idmag() */
+			if (ioerr || (buf && !memcmp(mag->magic,
+					buf + (mag->sboff & 0x3ff), mag->len)))
+				blkid_bmp_set_item(ix->found, ix->mags[i].idx);
+		}
+	}
+
+	ix->scanned = 1;
+	return ix->found;
+}
+
 static int superblocks_probe(blkid_probe pr, struct blkid_chain *chn)
 {
 	size_t i;
 	int rc = BLKID_PROBE_NONE;
+	unsigned long *found;
 
 	if (chn->idx < -1)
 		return -EINVAL;
@@ -365,6 +558,8 @@ static int superblocks_probe(blkid_probe pr, struct blkid_chain *chn)
 	DBG(LOWPROBE, ul_debug("--> starting probing loop [SUBLKS idx=%d]",
 		chn->idx));
 
+	found = superblocks_scan_magics(pr, chn);
+
 	i = chn->idx < 0 ? 0 : chn->idx + 1U;
 
 	for ( ; i < ARRAY_SIZE(idinfos); i++) {
@@ -381,20 +576,13 @@ static int superblocks_probe(blkid_probe pr, struct blkid_chain *chn)
 			continue;
 		}
 
-		if (id->minsz && (unsigned)id->minsz > pr->size) {
-			rc = BLKID_PROBE_NONE;
-			continue;	/* the device is too small */
-		}
-
-		/* don't probe for RAIDs, swap or journal on CD/DVDs */
-		if ((id->usage & (BLKID_USAGE_RAID | BLKID_USAGE_OTHER)) &&
-		    blkid_probe_is_cdrom(pr)) {
+		if (!idinfo_is_usable(pr, id)) {
 			rc = BLKID_PROBE_NONE;
 			continue;
 		}
 
-		/* don't probe for RAIDs on floppies */
-		if ((id->usage & BLKID_USAGE_RAID) && blkid_probe_is_tiny(pr)) {
+		/* no magic string found by superblocks_scan_magics() */
+		if (found && !blkid_bmp_get_item(found, i)) {
 			rc = BLKID_PROBE_NONE;
 			continue;
 		}
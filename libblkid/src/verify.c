@@ -23,6 +23,27 @@
 #include "blkidP.h"
 #include "sysfs.h"
 
+/*
+ * Returns name of the cache tag for probing result @name, or NULL if the
+ * result is not stored in the cache.
+ */
+static const char *value_to_tagname(const char *name)
+{
+	if (strncmp(name, "PART_ENTRY_", 11) == 0) {
+		if (strcmp(name, "PART_ENTRY_UUID") == 0)
+			return "PARTUUID";
+		if (strcmp(name, "PART_ENTRY_NAME") == 0)
+			return "PARTLABEL";
+		return NULL;
+	}
+
+	/* superblock UUID, LABEL, ...
+	 * but not {SYSTEM,APPLICATION,..._ID} */
+	if (strstr(name, "_ID"))
+		return NULL;
+	return name;
+}
+
 static void blkid_probe_to_tags(blkid_probe pr, blkid_dev dev)
 {
 	const char *data;
@@ -35,18 +56,171 @@ static void blkid_probe_to_tags(blkid_probe pr, blkid_dev dev)
 	for (n = 0; n < nvals; n++) {
 		if (blkid_probe_get_value(pr, n, &name, &data, &len) != 0)
 			continue;
-		if (strncmp(name, "PART_ENTRY_", 11) == 0) {
-			if (strcmp(name, "PART_ENTRY_UUID") == 0)
-				blkid_set_tag(dev, "PARTUUID", data, len);
-			else if (strcmp(name, "PART_ENTRY_NAME") == 0)
-				blkid_set_tag(dev, "PARTLABEL", data, len);
-
-		} else if (!strstr(name, "_ID")) {
-			/* superblock UUID, LABEL, ...
-			 * but not {SYSTEM,APPLICATION,..._ID} */
+		name = value_to_tagname(name);
+		if (name)
 			blkid_set_tag(dev, name, data, len);
+	}
+}
+
+static void blkid_preprobe_to_tags(struct blkid_preprobe *res, blkid_dev dev)
+{
+	size_t i;
+
+	for (i = 0; i < res->ntags; i++)
+		blkid_set_tag(dev, res->tags[i].name,
+				res->tags[i].data, res->tags[i].len);
+}
+
+static void setup_probe(blkid_probe pr)
+{
+	/* enable superblocks probing */
+	blkid_probe_enable_superblocks(pr, TRUE);
+	blkid_probe_set_superblocks_flags(pr,
+		BLKID_SUBLKS_LABEL | BLKID_SUBLKS_UUID |
+		BLKID_SUBLKS_TYPE | BLKID_SUBLKS_SECTYPE);
+
+	/* enable partitions probing */
+	blkid_probe_enable_partitions(pr, TRUE);
+	blkid_probe_set_partitions_flags(pr, BLKID_PARTS_ENTRY_DETAILS);
+}
+
+static void free_preprobe_tags(struct blkid_preprobe *res)
+{
+	size_t i;
+
+	for (i = 0; i < res->ntags; i++) {
+		free(res->tags[i].name);
+		free(res->tags[i].data);
+	}
+	free(res->tags);
+	res->tags = NULL;
+	res->ntags = 0;
+}
+
+/*
+ * Returns 1 if the cached data of @dev do not need to be revalidated, it means
+ * the device node (@st) has not been modified since the last check and the
+ * last check is not older than BLKID_PROBE_MIN seconds.
+ */
+int blkid_dev_is_fresh(blkid_dev dev, const struct stat *st, time_t now)
+{
+	time_t diff = (uintmax_t)now - dev->bid_time;
+
+	return now >= dev->bid_time &&
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+	    (st->st_mtime < dev->bid_time ||
+	        (st->st_mtime == dev->bid_time &&
+		 st->st_mtim.tv_nsec / 1000 <= dev->bid_utime)) &&
+#else
+	    st->st_mtime <= dev->bid_time &&
+#endif
+	    diff >= 0 && diff < BLKID_PROBE_MIN;
+}
+
+/*
+ * Probe @devname by @pr and store the result to @res; the @res->devno has to
+ * be set by caller, the device is ignored if its devno does not match.
+ *
+ * This function does not use any cache and it's designed to be called from
+ * more threads in the same time (every thread has to use its own prober).
+ *
+ * Returns 0 on success (the device has been probed, does not matter if
+ * anything has been found), negative number in case of error.
+ */
+int blkid_preprobe_device(blkid_probe pr, const char *devname,
+			  struct blkid_preprobe *res)
+{
+	struct stat st;
+	int fd, rc = 0;
+
+	fd = open(devname, O_RDONLY|O_CLOEXEC|O_NONBLOCK);
+	if (fd < 0)
+		return -errno;
+
+	if (fstat(fd, &st) != 0 || st.st_rdev != res->devno
+	    || blkid_probe_set_device(pr, fd, 0, 0) != 0) {
+		close(fd);
+		return -EINVAL;
+	}
+
+	setup_probe(pr);
+
+	res->rc = blkid_do_safeprobe(pr);
+	if (res->rc == -1)
+		rc = -EIO;
+
+	else if (res->rc == 0) {
+		int n, nvals = blkid_probe_numof_values(pr);
+
+		res->tags = calloc(nvals, sizeof(struct blkid_preprobe_tag));
+		if (nvals && !res->tags)
+			rc = -ENOMEM;
+
+		for (n = 0; rc == 0 && n < nvals; n++) {
+			struct blkid_preprobe_tag *tag = &res->tags[res->ntags];
+			const char *name, *data;
+			size_t len;
+
+			if (blkid_probe_get_value(pr, n, &name, &data, &len) != 0)
+				continue;
+			name = value_to_tagname(name);
+			if (!name)
+				continue;
+
+			tag->name = strdup(name);
+			tag->data = malloc(len);
+			tag->len = len;
+			res->ntags++;
+
+			if (!tag->name || !tag->data)
+				rc = -ENOMEM;
+			else
+				memcpy(tag->data, data, len);
 		}
+		if (rc)
+			free_preprobe_tags(res);
+	}
+
+	DBG(PROBE, ul_debug("preprobe %s: devno 0x%04llx [rc=%d, tags=%zu]",
+			devname, (long long) res->devno, res->rc, res->ntags));
+
+	/* reset prober */
+	blkid_probe_reset_superblocks_filter(pr);
+	blkid_probe_set_device(pr, -1, 0, 0);
+	close(fd);
+
+	return rc;
+}
+
+static struct blkid_preprobe *get_preprobed(blkid_cache cache, dev_t devno)
+{
+	size_t lo = 0, hi = cache->bic_npreprobed;
+
+	/* sorted by devno, see sysfs_preprobe_all() */
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		struct blkid_preprobe *res = &cache->bic_preprobed[mid];
+
+		if (res->devno == devno)
+			return res;
+		if (res->devno < devno)
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
+	return NULL;
+}
+
+void blkid_free_preprobed(blkid_cache cache)
+{
+	size_t i;
+
+	for (i = 0; i < cache->bic_npreprobed; i++)
+		free_preprobe_tags(&cache->bic_preprobed[i]);
+
+	free(cache->bic_preprobed);
+	cache->bic_preprobed = NULL;
+	cache->bic_npreprobed = 0;
 }
 
 /*
@@ -64,7 +238,8 @@ blkid_dev blkid_verify(blkid_cache cache, blkid_dev dev)
 	const char *type, *value;
 	struct stat st;
 	time_t diff, now;
-	int fd;
+	struct blkid_preprobe *pre;
+	int fd = -1, rc;
 
 	if (!dev || !cache)
 		return NULL;
@@ -87,15 +262,7 @@ blkid_dev blkid_verify(blkid_cache cache, blkid_dev dev)
 		return NULL;
 	}
 
-	if (now >= dev->bid_time &&
-#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
-	    (st.st_mtime < dev->bid_time ||
-	        (st.st_mtime == dev->bid_time &&
-		 st.st_mtim.tv_nsec / 1000 <= dev->bid_utime)) &&
-#else
-	    st.st_mtime <= dev->bid_time &&
-#endif
-	    diff >= 0 && diff < BLKID_PROBE_MIN) {
+	if (blkid_dev_is_fresh(dev, &st, now)) {
 		dev->bid_flags |= BLKID_BID_FL_VERIFIED;
 		return dev;
 	}
@@ -118,6 +285,11 @@ blkid_dev blkid_verify(blkid_cache cache, blkid_dev dev)
 		blkid_free_dev(dev);
 		return NULL;
 	}
+	/* already probed by a probing thread */
+	pre = get_preprobed(cache, st.st_rdev);
+	if (pre)
+		goto probed;
+
 	if (!cache->probe) {
 		cache->probe = blkid_new_probe();
 		if (!cache->probe) {
@@ -140,25 +312,21 @@ blkid_dev blkid_verify(blkid_cache cache, blkid_dev dev)
 		blkid_free_dev(dev);
 		return NULL;
 	}
-
+probed:
 	/* remove old cache info */
 	iter = blkid_tag_iterate_begin(dev);
 	while (blkid_tag_next(iter, &type, &value) == 0)
 		blkid_set_tag(dev, type, NULL, 0);
 	blkid_tag_iterate_end(iter);
 
-	/* enable superblocks probing */
-	blkid_probe_enable_superblocks(cache->probe, TRUE);
-	blkid_probe_set_superblocks_flags(cache->probe,
-		BLKID_SUBLKS_LABEL | BLKID_SUBLKS_UUID |
-		BLKID_SUBLKS_TYPE | BLKID_SUBLKS_SECTYPE);
-
-	/* enable partitions probing */
-	blkid_probe_enable_partitions(cache->probe, TRUE);
-	blkid_probe_set_partitions_flags(cache->probe, BLKID_PARTS_ENTRY_DETAILS);
-
 	/* probe */
-	if (blkid_do_safeprobe(cache->probe)) {
+	if (pre)
+		rc = pre->rc;
+	else {
+		setup_probe(cache->probe);
+		rc = blkid_do_safeprobe(cache->probe);
+	}
+	if (rc) {
 		/* found nothing or error */
 		blkid_free_dev(dev);
 		dev = NULL;
@@ -178,16 +346,21 @@ blkid_dev blkid_verify(blkid_cache cache, blkid_dev dev)
 		dev->bid_flags |= BLKID_BID_FL_VERIFIED;
 		cache->bic_flags |= BLKID_BIC_FL_CHANGED;
 
-		blkid_probe_to_tags(cache->probe, dev);
+		if (pre)
+			blkid_preprobe_to_tags(pre, dev);
+		else
+			blkid_probe_to_tags(cache->probe, dev);
 
 		DBG(PROBE, ul_debug("%s: devno 0x%04llx, type %s",
 			   dev->bid_name, (long long)st.st_rdev, dev->bid_type));
 	}
 
-	/* reset prober */
-	blkid_probe_reset_superblocks_filter(cache->probe);
-	blkid_probe_set_device(cache->probe, -1, 0, 0);
-	close(fd);
+	if (fd >= 0) {
+		/* reset prober */
+		blkid_probe_reset_superblocks_filter(cache->probe);
+		blkid_probe_set_device(cache->probe, -1, 0, 0);
+		close(fd);
+	}
 
 	return dev;
 }
@@ -37,8 +37,18 @@
 
 /*
  * Canonicalized (resolved) paths & tags cache
+ *
+ * The entries are allocated in chunks (the chunks are never reallocated, so
+ * pointers to the entries are stable) and linked to hash tables:
+ *
+ *	keyhash - paths (normalized by mnt_hash_path()) and "TAG_NAME\0TAG_VALUE" keys
+ *	devhash - tags by device name
+ *
+ * The hash chains keep entries in the order they have been added, so lookups
+ * return the same entry as the original linear search.
  */
 #define MNT_CACHE_CHUNKSZ	128
+#define MNT_CACHE_HASHSZ	(2 * MNT_CACHE_CHUNKSZ)	/* initial hash size */
 
 #define MNT_CACHE_ISTAG		(1 << 1) /* entry is TAG */
 #define MNT_CACHE_ISPATH	(1 << 2) /* entry is path */
@@ -49,12 +59,20 @@ struct mnt_cache_entry {
 	char			*key;	/* search key (e.g. uncanonicalized path) */
 	char			*value;	/* value (e.g. canonicalized path) */
 	int			flag;
+
+	struct mnt_cache_entry	*knext;	/* next in keyhash chain */
+	struct mnt_cache_entry	*dnext;	/* next in devhash chain (tags only) */
 };
 
 struct libmnt_cache {
-	struct mnt_cache_entry	*ents;
+	struct mnt_cache_entry	**chunks;
+	size_t			nchunks;
 	size_t			nents;
-	size_t			nallocs;
+
+	struct mnt_cache_entry	**keyhash;
+	struct mnt_cache_entry	**devhash;
+	size_t			hashsz;
+
 	int			refcount;
 
 	/* blkid_evaluate_tag() works in two ways:
@@ -71,6 +89,12 @@ struct libmnt_cache {
 	struct libmnt_table	*mtab;
 };
 
+static inline struct mnt_cache_entry *cache_get_entry(
+			struct libmnt_cache *cache, size_t i)
+{
+	return &cache->chunks[i / MNT_CACHE_CHUNKSZ][i % MNT_CACHE_CHUNKSZ];
+}
+
 /**
  * mnt_new_cache:
  *
@@ -103,12 +127,16 @@ void mnt_free_cache(struct libmnt_cache *cache)
 	DBG(CACHE, ul_debugobj(cache, "free [refcount=%d]", cache->refcount));
 
 	for (i = 0; i < cache->nents; i++) {
-		struct mnt_cache_entry *e = &cache->ents[i];
+		struct mnt_cache_entry *e = cache_get_entry(cache, i);
 		if (e->value != e->key)
 			free(e->value);
 		free(e->key);
 	}
-	free(cache->ents);
+	for (i = 0; i < cache->nchunks; i++)
+		free(cache->chunks[i]);
+	free(cache->chunks);
+	free(cache->keyhash);
+	free(cache->devhash);
 	if (cache->bc)
 		blkid_put_cache(cache->bc);
 	free(cache);
@@ -170,6 +198,107 @@ int mnt_cache_set_targets(struct libmnt_cache *cache,
 	return 0;
 }
 
+/* FNV-1a */
+#define HASH_INIT	2166136261U
+#define hash_char(h, c)	(((h) ^ (unsigned char) (c)) * 16777619U)
+
+static uint32_t hash_str(uint32_t h, const char *str)
+{
+	for (; *str; str++)
+		h = hash_char(h, *str);
+	return h;
+}
+
+/*
+ * Hash the path in the same way as streq_paths() compares, it means
+ * duplicate slashes are hashed as one slash and a tailing slash is ignored.
+ */
+uint32_t mnt_hash_path(const char *path)
+{
+	uint32_t h = HASH_INIT;
+
+	for (; *path; path++) {
+		if (*path == '/') {
+			while (*(path + 1) == '/')
+				path++;
+			if (!*(path + 1))
+				break;
+		}
+		h = hash_char(h, *path);
+	}
+	return h;
+}
+
+uint32_t mnt_hash_str(const char *str)
+{
+	return hash_str(HASH_INIT, str);
+}
+
+static uint32_t hash_tag(const char *token, const char *value)
+{
+	uint32_t h = hash_str(HASH_INIT, token);
+
+	h = hash_char(h, '\0');
+	return hash_str(h, value);
+}
+
+static uint32_t hash_entry_key(struct mnt_cache_entry *e)
+{
+	if (e->flag & MNT_CACHE_ISTAG)
+		return hash_tag(e->key, e->key + strlen(e->key) + 1);
+	return mnt_hash_path(e->key);
+}
+
+/* add @e to the end of the hash chains */
+static void cache_link_entry(struct libmnt_cache *cache,
+			struct mnt_cache_entry *e)
+{
+	struct mnt_cache_entry **pe;
+
+	pe = &cache->keyhash[hash_entry_key(e) % cache->hashsz];
+	while (*pe)
+		pe = &(*pe)->knext;
+	*pe = e;
+	e->knext = NULL;
+
+	if (!(e->flag & MNT_CACHE_ISTAG))
+		return;
+
+	pe = &cache->devhash[hash_str(HASH_INIT, e->value) % cache->hashsz];
+	while (*pe)
+		pe = &(*pe)->dnext;
+	*pe = e;
+	e->dnext = NULL;
+}
+
+/* (re)allocate hash tables to keep the chains short */
+static int cache_resize_hash(struct libmnt_cache *cache)
+{
+	struct mnt_cache_entry **kh, **dh;
+	size_t i, sz;
+
+	sz = cache->hashsz ? cache->hashsz * 2 : MNT_CACHE_HASHSZ;
+
+	kh = calloc(sz, sizeof(struct mnt_cache_entry *));
+	dh = calloc(sz, sizeof(struct mnt_cache_entry *));
+	if (!kh || !dh) {
+		free(kh);
+		free(dh);
+		return -ENOMEM;
+	}
+
+	free(cache->keyhash);
+	free(cache->devhash);
+	cache->keyhash = kh;
+	cache->devhash = dh;
+	cache->hashsz = sz;
+
+	DBG(CACHE, ul_debugobj(cache, "hash resized to %zu", sz));
+
+	for (i = 0; i < cache->nents; i++)
+		cache_link_entry(cache, cache_get_entry(cache, i));
+	return 0;
+}
 
 /* note that the @key could be the same pointer as @value */
 static int cache_add_entry(struct libmnt_cache *cache, char *key,
@@ -181,22 +310,31 @@ static int cache_add_entry(struct libmnt_cache *cache, char *key,
 	assert(value);
 	assert(key);
 
-	if (cache->nents == cache->nallocs) {
-		size_t sz = cache->nallocs + MNT_CACHE_CHUNKSZ;
+	if (cache->nents == cache->nchunks * MNT_CACHE_CHUNKSZ) {
+		struct mnt_cache_entry **chunks;
+
+		chunks = realloc(cache->chunks,
+			(cache->nchunks + 1) * sizeof(struct mnt_cache_entry *));
+		if (!chunks)
+			return -ENOMEM;
+		cache->chunks = chunks;
 
-		e = realloc(cache->ents, sz * sizeof(struct mnt_cache_entry));
+		e = malloc(MNT_CACHE_CHUNKSZ * sizeof(struct mnt_cache_entry));
 		if (!e)
 			return -ENOMEM;
-		cache->ents = e;
-		cache->nallocs = sz;
+		cache->chunks[cache->nchunks++] = e;
 	}
+	if (cache->nents >= cache->hashsz && cache_resize_hash(cache))
+		return -ENOMEM;
 
-	e = &cache->ents[cache->nents];
+	e = cache_get_entry(cache, cache->nents);
 	e->key = key;
 	e->value = value;
 	e->flag = flag;
 	cache->nents++;
 
+	cache_link_entry(cache, e);
+
 	DBG(CACHE, ul_debugobj(cache, "add entry [%2zd] (%s): %s: %s",
 			cache->nents,
 			(flag & MNT_CACHE_ISPATH) ? "path" : "tag",
@@ -245,13 +383,12 @@ static int cache_add_tag(struct libmnt_cache *cache, const char *tagname,
  */
 static const char *cache_find_path(struct libmnt_cache *cache, const char *path)
 {
-	size_t i;
+	struct mnt_cache_entry *e;
 
-	if (!cache || !path)
+	if (!cache || !path || !cache->nents)
 		return NULL;
 
-	for (i = 0; i < cache->nents; i++) {
-		struct mnt_cache_entry *e = &cache->ents[i];
+	for (e = cache->keyhash[mnt_hash_path(path) % cache->hashsz]; e; e = e->knext) {
 		if (!(e->flag & MNT_CACHE_ISPATH))
 			continue;
 		if (streq_paths(path, e->key))
@@ -266,16 +403,15 @@ static const char *cache_find_path(struct libmnt_cache *cache, const char *path)
 static const char *cache_find_tag(struct libmnt_cache *cache,
 			const char *token, const char *value)
 {
-	size_t i;
+	struct mnt_cache_entry *e;
 	size_t tksz;
 
-	if (!cache || !token || !value)
+	if (!cache || !token || !value || !cache->nents)
 		return NULL;
 
 	tksz = strlen(token);
 
-	for (i = 0; i < cache->nents; i++) {
-		struct mnt_cache_entry *e = &cache->ents[i];
+	for (e = cache->keyhash[hash_tag(token, value) % cache->hashsz]; e; e = e->knext) {
 		if (!(e->flag & MNT_CACHE_ISTAG))
 			continue;
 		if (strcmp(token, e->key) == 0 &&
@@ -288,16 +424,16 @@ static const char *cache_find_tag(struct libmnt_cache *cache,
 static char *cache_find_tag_value(struct libmnt_cache *cache,
 			const char *devname, const char *token)
 {
-	size_t i;
+	struct mnt_cache_entry *e;
 
 	assert(cache);
 	assert(devname);
 	assert(token);
 
-	for (i = 0; i < cache->nents; i++) {
-		struct mnt_cache_entry *e = &cache->ents[i];
-		if (!(e->flag & MNT_CACHE_ISTAG))
-			continue;
+	if (!cache->nents)
+		return NULL;
+
+	for (e = cache->devhash[hash_str(HASH_INIT, devname) % cache->hashsz]; e; e = e->dnext) {
 		if (strcmp(e->value, devname) == 0 &&	/* dev name */
 		    strcmp(token, e->key) == 0)	/* tag name */
 			return e->key + strlen(token) + 1;	/* tag value */
@@ -330,13 +466,17 @@ int mnt_cache_read_tags(struct libmnt_cache *cache, const char *devname)
 	DBG(CACHE, ul_debugobj(cache, "tags for %s requested", devname));
 
 	/* check if device is already cached */
-	for (i = 0; i < cache->nents; i++) {
-		struct mnt_cache_entry *e = &cache->ents[i];
-		if (!(e->flag & MNT_CACHE_TAGREAD))
-			continue;
-		if (strcmp(e->value, devname) == 0)
-			/* tags have already been read */
-			return 0;
+	if (cache->nents) {
+		struct mnt_cache_entry *e;
+
+		for (e = cache->devhash[hash_str(HASH_INIT, devname) % cache->hashsz];
+		     e; e = e->dnext) {
+			if (!(e->flag & MNT_CACHE_TAGREAD))
+				continue;
+			if (strcmp(e->value, devname) == 0)
+				/* tags have already been read */
+				return 0;
+		}
 	}
 
 	pr =  blkid_new_probe_from_filename(devname);
@@ -773,6 +913,41 @@ static int test_resolve_spec(struct libmnt_test *ts, int argc, char *argv[])
 	return 0;
 }
 
+static int test_find_path(struct libmnt_test *ts, int argc, char *argv[])
+{
+	char line[BUFSIZ];
+	struct libmnt_cache *cache;
+
+	cache = mnt_new_cache();
+	if (!cache)
+		return -ENOMEM;
+
+	while(fgets(line, sizeof(line), stdin)) {
+		size_t sz = strlen(line);
+		const char *cn;
+
+		if (sz > 0 && line[sz - 1] == '\n')
+			line[sz - 1] = '\0';
+
+		/* "+<path>" resolves the path and adds it to the cache */
+		if (*line == '+') {
+			if (!mnt_resolve_path(line + 1, cache))
+				fprintf(stderr, "%s: resolve failed\n", line + 1);
+			continue;
+		}
+
+		cn = cache_find_path(cache, line);
+		if (cn)
+			printf("%s: %s\n", line, cn);
+		else
+			printf("%s: not cached\n", line);
+	}
+
+	printf("entries: %zu\n", cache->nents);
+	mnt_unref_cache(cache);
+	return 0;
+}
+
 static int test_read_tags(struct libmnt_test *ts, int argc, char *argv[])
 {
 	char line[BUFSIZ];
@@ -813,7 +988,7 @@ static int test_read_tags(struct libmnt_test *ts, int argc, char *argv[])
 	}
 
 	for (i = 0; i < cache->nents; i++) {
-		struct mnt_cache_entry *e = &cache->ents[i];
+		struct mnt_cache_entry *e = cache_get_entry(cache, i);
 		if (!(e->flag & MNT_CACHE_ISTAG))
 			continue;
 
@@ -831,6 +1006,7 @@ int main(int argc, char *argv[])
 	struct libmnt_test ts[] = {
 		{ "--resolve-path", test_resolve_path, "  resolve paths from stdin" },
 		{ "--resolve-spec", test_resolve_spec, "  evaluate specs from stdin" },
+		{ "--find-path", test_find_path,       "  look up paths from stdin (\"+<path>\" to add)" },
 		{ "--read-tags", test_read_tags,       "  read devname or TAG from stdin (\"quit\" to exit)" },
 		{ NULL }
 	};
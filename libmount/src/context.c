@@ -921,6 +921,11 @@ int mnt_context_set_fs(struct libmnt_context *cxt, struct libmnt_fs *fs)
 		return -EINVAL;
 
 	DBG(CXT, ul_debugobj(cxt, "setting new FS"));
+
+	/* the context modifies the strings directly */
+	if (fs && mnt_fs_detach_arena(fs))
+		return -ENOMEM;
+
 	mnt_ref_fs(fs);			/* new */
 	mnt_unref_fs(cxt->fs);		/* old */
 	cxt->fs = fs;
@@ -2949,6 +2954,9 @@ int mnt_context_is_fs_mounted(struct libmnt_context *cxt,
 	if (rc)
 		return rc;
 
+	/* "mount -a" calls this for all fstab entries */
+	mnt_table_enable_index(mtab, 1);
+
 	*mounted = __mnt_table_is_fs_mounted(mtab, fs,
 				mnt_context_get_target_prefix(cxt));
 
@@ -60,7 +60,23 @@ void mnt_free_fs(struct libmnt_fs *fs)
 	DBG(FS, ul_debugobj(fs, "free [refcount=%d]", fs->refcount));
 
 	mnt_reset_fs(fs);
-	free(fs);
+	if (fs->slab)
+		mnt_unref_arena(fs->slab);
+	else
+		free(fs);
+}
+
+/* returns 1 if @str is stored in the parser arena */
+static inline int is_arena_str(struct libmnt_fs *fs, const char *str)
+{
+	return fs->arena && str >= fs->arena->buf
+			 && str < fs->arena->buf + fs->arena->bufsz;
+}
+
+static inline void free_fs_str(struct libmnt_fs *fs, char *str)
+{
+	if (str && !is_arena_str(fs, str))
+		free(str);
 }
 
 /**
@@ -71,33 +87,148 @@ void mnt_free_fs(struct libmnt_fs *fs)
  */
 void mnt_reset_fs(struct libmnt_fs *fs)
 {
+	struct libmnt_arena *slab;
 	int ref;
 
 	if (!fs)
 		return;
 
 	ref = fs->refcount;
+	slab = fs->slab;
 
 	list_del(&fs->ents);
-	free(fs->source);
-	free(fs->bindsrc);
-	free(fs->tagname);
-	free(fs->tagval);
-	free(fs->root);
-	free(fs->swaptype);
-	free(fs->target);
-	free(fs->fstype);
-	free(fs->optstr);
-	free(fs->vfs_optstr);
-	free(fs->fs_optstr);
-	free(fs->user_optstr);
-	free(fs->attrs);
-	free(fs->opt_fields);
-	free(fs->comment);
+	free_fs_str(fs, fs->source);
+	free_fs_str(fs, fs->bindsrc);
+	free_fs_str(fs, fs->tagname);
+	free_fs_str(fs, fs->tagval);
+	free_fs_str(fs, fs->root);
+	free_fs_str(fs, fs->swaptype);
+	free_fs_str(fs, fs->target);
+	free_fs_str(fs, fs->fstype);
+	free_fs_str(fs, fs->optstr);
+	free_fs_str(fs, fs->vfs_optstr);
+	free_fs_str(fs, fs->fs_optstr);
+	free_fs_str(fs, fs->user_optstr);
+	free_fs_str(fs, fs->attrs);
+	free_fs_str(fs, fs->opt_fields);
+	free_fs_str(fs, fs->comment);
+	mnt_unref_arena(fs->arena);
 
 	memset(fs, 0, sizeof(*fs));
 	INIT_LIST_HEAD(&fs->ents);
 	fs->refcount = ref;
+	fs->slab = slab;
+}
+
+/*
+ * Allocates a new arena for the mountinfo parser. The @buf is owned by the
+ * arena on success. The initial refcount is 1.
+ */
+struct libmnt_arena *mnt_new_arena(char *buf, size_t bufsz, size_t nfss)
+{
+	struct libmnt_arena *ar = calloc(1, sizeof(*ar));
+
+	if (!ar)
+		return NULL;
+	if (nfss) {
+		ar->fss = calloc(nfss, sizeof(struct libmnt_fs));
+		if (!ar->fss) {
+			free(ar);
+			return NULL;
+		}
+	}
+	ar->refcount = 1;
+	ar->buf = buf;
+	ar->bufsz = bufsz;
+	ar->nfss = nfss;
+
+	DBG(FS, ul_debugobj(ar, "new arena [bufsz=%zu, slab=%zu]", bufsz, nfss));
+	return ar;
+}
+
+void mnt_ref_arena(struct libmnt_arena *ar)
+{
+	if (ar)
+		ar->refcount++;
+}
+
+void mnt_unref_arena(struct libmnt_arena *ar)
+{
+	if (!ar)
+		return;
+	ar->refcount--;
+	if (ar->refcount <= 0) {
+		DBG(FS, ul_debugobj(ar, "free arena"));
+		free(ar->buf);
+		free(ar->fss);
+		free(ar);
+	}
+}
+
+/*
+ * Returns a new entry from the arena slab or NULL if the slab is full. The
+ * entry strings may point to the arena buffer.
+ */
+struct libmnt_fs *mnt_arena_new_fs(struct libmnt_arena *ar)
+{
+	struct libmnt_fs *fs;
+
+	if (!ar || ar->nused >= ar->nfss)
+		return NULL;
+
+	fs = &ar->fss[ar->nused++];
+	fs->refcount = 1;
+	INIT_LIST_HEAD(&fs->ents);
+
+	fs->slab = ar;
+	fs->arena = ar;
+	ar->refcount += 2;
+	return fs;
+}
+
+/*
+ * Creates private copies of the strings stored in the arena. This has to be
+ * called before any string in @fs is modified.
+ */
+int mnt_fs_detach_arena(struct libmnt_fs *fs)
+{
+	static const size_t offsets[] = {
+		offsetof(struct libmnt_fs, source),
+		offsetof(struct libmnt_fs, bindsrc),
+		offsetof(struct libmnt_fs, tagname),
+		offsetof(struct libmnt_fs, tagval),
+		offsetof(struct libmnt_fs, root),
+		offsetof(struct libmnt_fs, swaptype),
+		offsetof(struct libmnt_fs, target),
+		offsetof(struct libmnt_fs, fstype),
+		offsetof(struct libmnt_fs, optstr),
+		offsetof(struct libmnt_fs, vfs_optstr),
+		offsetof(struct libmnt_fs, fs_optstr),
+		offsetof(struct libmnt_fs, user_optstr),
+		offsetof(struct libmnt_fs, attrs),
+		offsetof(struct libmnt_fs, opt_fields),
+		offsetof(struct libmnt_fs, comment)
+	};
+	size_t i;
+
+	if (!fs || !fs->arena)
+		return 0;
+
+	for (i = 0; i < ARRAY_SIZE(offsets); i++) {
+		char **p = (char **) ((char *) fs + offsets[i]);
+		char *x;
+
+		if (!*p || !is_arena_str(fs, *p))
+			continue;
+		x = strdup(*p);
+		if (!x)
+			return -ENOMEM;
+		*p = x;
+	}
+
+	mnt_unref_arena(fs->arena);
+	fs->arena = NULL;
+	return 0;
 }
 
 /**
@@ -371,6 +502,9 @@ int __mnt_fs_set_source_ptr(struct libmnt_fs *fs, char *source)
 
 	assert(fs);
 
+	if (fs->tab)
+		mnt_table_reset_index(fs->tab);
+
 	if (source && blkid_parse_tag_string(source, &t, &v) == 0 &&
 	    !mnt_valid_tagname(t)) {
 		/* parsable but unknown tag -- ignore */
@@ -380,10 +514,10 @@ int __mnt_fs_set_source_ptr(struct libmnt_fs *fs, char *source)
 	}
 
 	if (fs->source != source)
-		free(fs->source);
+		free_fs_str(fs, fs->source);
 
-	free(fs->tagname);
-	free(fs->tagval);
+	free_fs_str(fs, fs->tagname);
+	free_fs_str(fs, fs->tagval);
 
 	fs->source = source;
 	fs->tagname = t;
@@ -549,6 +683,10 @@ const char *mnt_fs_get_target(struct libmnt_fs *fs)
  */
 int mnt_fs_set_target(struct libmnt_fs *fs, const char *tgt)
 {
+	if (fs && fs->tab)
+		mnt_table_reset_index(fs->tab);
+	if (fs && mnt_fs_detach_arena(fs))
+		return -ENOMEM;
 	return strdup_to_struct_member(fs, target, tgt);
 }
 
@@ -668,7 +806,7 @@ int __mnt_fs_set_fstype_ptr(struct libmnt_fs *fs, char *fstype)
 	assert(fs);
 
 	if (fstype != fs->fstype)
-		free(fs->fstype);
+		free_fs_str(fs, fs->fstype);
 
 	fs->fstype = fstype;
 	fs->flags &= ~MNT_FS_PSEUDO;
@@ -726,9 +864,8 @@ int mnt_fs_set_fstype(struct libmnt_fs *fs, const char *fstype)
  */
 static char *merge_optstr(const char *vfs, const char *fs)
 {
-	char *res, *p;
+	char *res;
 	size_t sz;
-	int ro = 0, rw = 0;
 
 	if (!vfs && !fs)
 		return NULL;
@@ -742,9 +879,31 @@ static char *merge_optstr(const char *vfs, const char *fs)
 	res = malloc(sz);
 	if (!res)
 		return NULL;
+
+	mnt_merge_optstr_to_buffer(vfs, fs, res, sz);
+	return res;
+}
+
+/*
+ * The same as merge_optstr(), but the result is written to @buf. The @bufsz
+ * has to be at least strlen(vfs) + strlen(fs) + 5.
+ */
+int mnt_merge_optstr_to_buffer(const char *vfs, const char *fs,
+			       char *buf, size_t bufsz)
+{
+	char *res = buf, *p;
+	int ro = 0, rw = 0;
+
+	if (!vfs || !fs || bufsz < strlen(vfs) + strlen(fs) + 5)
+		return -EINVAL;
+	if (!strcmp(vfs, fs)) {
+		memcpy(buf, vfs, strlen(vfs) + 1);
+		return 0;
+	}
+
 	p = res + 3;			/* make a room for rw/ro flag */
 
-	snprintf(p, sz - 3, "%s,%s", vfs, fs);
+	snprintf(p, bufsz - 3, "%s,%s", vfs, fs);
 
 	/* remove 'rw' flags */
 	rw += !mnt_optstr_remove_option(&p, "rw");	/* from vfs */
@@ -761,7 +920,7 @@ static char *merge_optstr(const char *vfs, const char *fs)
 		memcpy(res, ro ? "ro" : "rw", 3);
 	else
 		memcpy(res, ro ? "ro," : "rw,", 3);
-	return res;
+	return 0;
 }
 
 /**
@@ -834,6 +993,8 @@ int mnt_fs_set_options(struct libmnt_fs *fs, const char *optstr)
 
 	if (!fs)
 		return -EINVAL;
+	if (mnt_fs_detach_arena(fs))
+		return -ENOMEM;
 	if (optstr) {
 		int rc = mnt_split_optstr(optstr, &u, &v, &f, 0, 0);
 		if (rc)
@@ -881,6 +1042,8 @@ int mnt_fs_append_options(struct libmnt_fs *fs, const char *optstr)
 		return -EINVAL;
 	if (!optstr)
 		return 0;
+	if (mnt_fs_detach_arena(fs))
+		return -ENOMEM;
 
 	rc = mnt_split_optstr(optstr, &u, &v, &f, 0, 0);
 	if (rc)
@@ -923,6 +1086,8 @@ int mnt_fs_prepend_options(struct libmnt_fs *fs, const char *optstr)
 		return -EINVAL;
 	if (!optstr)
 		return 0;
+	if (mnt_fs_detach_arena(fs))
+		return -ENOMEM;
 
 	rc = mnt_split_optstr(optstr, &u, &v, &f, 0, 0);
 	if (rc)
@@ -1037,6 +1202,8 @@ const char *mnt_fs_get_attributes(struct libmnt_fs *fs)
  */
 int mnt_fs_set_attributes(struct libmnt_fs *fs, const char *optstr)
 {
+	if (fs && mnt_fs_detach_arena(fs))
+		return -ENOMEM;
 	return strdup_to_struct_member(fs, attrs, optstr);
 }
 
@@ -1055,6 +1222,8 @@ int mnt_fs_append_attributes(struct libmnt_fs *fs, const char *optstr)
 		return -EINVAL;
 	if (!optstr)
 		return 0;
+	if (mnt_fs_detach_arena(fs))
+		return -ENOMEM;
 	return mnt_optstr_append_option(&fs->attrs, optstr, NULL);
 }
 
@@ -1073,6 +1242,8 @@ int mnt_fs_prepend_attributes(struct libmnt_fs *fs, const char *optstr)
 		return -EINVAL;
 	if (!optstr)
 		return 0;
+	if (mnt_fs_detach_arena(fs))
+		return -ENOMEM;
 	return mnt_optstr_prepend_option(&fs->attrs, optstr, NULL);
 }
 
@@ -1149,6 +1320,8 @@ const char *mnt_fs_get_root(struct libmnt_fs *fs)
  */
 int mnt_fs_set_root(struct libmnt_fs *fs, const char *path)
 {
+	if (fs && mnt_fs_detach_arena(fs))
+		return -ENOMEM;
 	return strdup_to_struct_member(fs, root, path);
 }
 
@@ -1233,6 +1406,8 @@ const char *mnt_fs_get_bindsrc(struct libmnt_fs *fs)
  */
 int mnt_fs_set_bindsrc(struct libmnt_fs *fs, const char *src)
 {
+	if (fs && mnt_fs_detach_arena(fs))
+		return -ENOMEM;
 	return strdup_to_struct_member(fs, bindsrc, src);
 }
 
@@ -1352,6 +1527,8 @@ const char *mnt_fs_get_comment(struct libmnt_fs *fs)
  */
 int mnt_fs_set_comment(struct libmnt_fs *fs, const char *comm)
 {
+	if (fs && mnt_fs_detach_arena(fs))
+		return -ENOMEM;
 	return strdup_to_struct_member(fs, comment, comm);
 }
 
@@ -1368,6 +1545,8 @@ int mnt_fs_append_comment(struct libmnt_fs *fs, const char *comm)
 {
 	if (!fs)
 		return -EINVAL;
+	if (mnt_fs_detach_arena(fs))
+		return -ENOMEM;
 
 	return strappend(&fs->comment, comm);
 }
@@ -64,6 +64,32 @@ struct libmnt_monitor {
 	int			fd;		/* public monitor file descriptor */
 
 	struct list_head	ents;
+
+	struct monitor_kdiff	*kdiff;		/* mnt_monitor_diff_kernel() */
+};
+
+/*
+ * The last mountinfo content for mnt_monitor_diff_kernel(). The lines are
+ * hashed by mount ID, a new line is parsed only if it differs from the
+ * previous line with the same ID.
+ */
+struct kdiff_entry {
+	int			id;		/* mount ID, or -1 for unused slot */
+	char			*line;		/* mountinfo line */
+	struct libmnt_fs	*fs;		/* parsed line */
+	unsigned int		seen : 1;
+};
+
+struct monitor_kdiff {
+	struct kdiff_entry	*ents;		/* hash by mount ID */
+	size_t			sz;		/* size of the hash (power of 2) */
+	size_t			nents;		/* number of used entries */
+
+	struct libmnt_table	*tb;		/* the last table */
+	pid_t			tid;
+
+	char			*buf;		/* getline() buffer */
+	size_t			bufsz;
 };
 
 struct monitor_opers {
@@ -109,6 +135,31 @@ void mnt_ref_monitor(struct libmnt_monitor *mn)
 		mn->refcount++;
 }
 
+static void free_kdiff_entries(struct kdiff_entry *ents, size_t sz)
+{
+	size_t i;
+
+	if (!ents)
+		return;
+	for (i = 0; i < sz; i++) {
+		if (ents[i].id < 0)
+			continue;
+		free(ents[i].line);
+		mnt_unref_fs(ents[i].fs);
+	}
+	free(ents);
+}
+
+static void free_monitor_kdiff(struct monitor_kdiff *kd)
+{
+	if (!kd)
+		return;
+	free_kdiff_entries(kd->ents, kd->sz);
+	mnt_unref_table(kd->tb);
+	free(kd->buf);
+	free(kd);
+}
+
 static void free_monitor_entry(struct monitor_entry *me)
 {
 	if (!me)
@@ -142,6 +193,7 @@ void mnt_unref_monitor(struct libmnt_monitor *mn)
 			free_monitor_entry(me);
 		}
 
+		free_monitor_kdiff(mn->kdiff);
 		free(mn);
 	}
 }
@@ -827,6 +879,311 @@ int mnt_monitor_event_cleanup(struct libmnt_monitor *mn)
 	return rc < 0 ? rc : 0;
 }
 
+static struct kdiff_entry *kdiff_get_slot(struct kdiff_entry *ents, size_t sz, int id)
+{
+	size_t i = ((unsigned int) id * 2654435761U) & (sz - 1);
+
+	while (ents[i].id >= 0 && ents[i].id != id)
+		i = (i + 1) & (sz - 1);
+	return &ents[i];
+}
+
+static struct kdiff_entry *kdiff_new_hash(size_t n, size_t *sz)
+{
+	struct kdiff_entry *ents;
+	size_t i;
+
+	for (*sz = 64; *sz < n * 2; *sz <<= 1);
+
+	ents = malloc(*sz * sizeof(struct kdiff_entry));
+	if (!ents)
+		return NULL;
+	for (i = 0; i < *sz; i++) {
+		ents[i].id = -1;
+		ents[i].line = NULL;
+		ents[i].fs = NULL;
+		ents[i].seen = 0;
+	}
+	return ents;
+}
+
+/* add @fs to @tb, @fs could be still in the previous table */
+static int kdiff_add_fs(struct libmnt_table *tb, struct libmnt_fs *fs)
+{
+	struct libmnt_table *old = NULL;
+	int rc;
+
+	mnt_fs_get_table(fs, &old);
+	if (old) {
+		mnt_ref_fs(fs);
+		mnt_table_remove_fs(old, fs);
+		rc = mnt_table_add_fs(tb, fs);
+		mnt_unref_fs(fs);
+	} else
+		rc = mnt_table_add_fs(tb, fs);
+	return rc;
+}
+
+static int kdiff_compare(struct libmnt_tabdiff *df,
+			 struct libmnt_fs *o, struct libmnt_fs *n)
+{
+	const char *v1, *v2, *f1, *f2;
+
+	/* see mnt_diff_tables() for the rules */
+	if (!mnt_fs_streq_target(o, mnt_fs_get_target(n))) {
+		const char *s1 = mnt_fs_get_source(o),
+			   *s2 = mnt_fs_get_source(n);
+
+		if ((!s1 && !s2) || (s1 && s2 && strcmp(s1, s2) == 0))
+			return mnt_tabdiff_add_entry(df, o, n, MNT_TABDIFF_MOVE);
+
+		if (mnt_tabdiff_add_entry(df, NULL, n, MNT_TABDIFF_MOUNT))
+			return -ENOMEM;
+		return mnt_tabdiff_add_entry(df, o, NULL, MNT_TABDIFF_UMOUNT);
+	}
+
+	v1 = mnt_fs_get_vfs_options(o);
+	v2 = mnt_fs_get_vfs_options(n);
+	f1 = mnt_fs_get_fs_options(o);
+	f2 = mnt_fs_get_fs_options(n);
+
+	if ((v1 && v2 && strcmp(v1, v2) != 0) || (f1 && f2 && strcmp(f1, f2) != 0))
+		return mnt_tabdiff_add_entry(df, o, n, MNT_TABDIFF_REMOUNT);
+	return 0;
+}
+
+static int kdiff_file(struct libmnt_monitor *mn, struct libmnt_tabdiff *df,
+		      struct libmnt_table **tb, const char *filename)
+{
+	struct monitor_kdiff *kd;
+	struct kdiff_entry *ents = NULL;
+	struct libmnt_table *new_tb = NULL;
+	struct libmnt_fs *fs = NULL;
+	size_t sz = 0, n = 0, i;
+	ssize_t len;
+	FILE *f;
+	int rc = 0;
+
+	if (!mn || !df)
+		return -EINVAL;
+
+	if (!mn->kdiff) {
+		mn->kdiff = calloc(1, sizeof(struct monitor_kdiff));
+		if (!mn->kdiff)
+			return -ENOMEM;
+		mn->kdiff->tid = -1;
+	}
+	kd = mn->kdiff;
+
+	mnt_tabdiff_reset(df);
+
+	f = fopen(filename, "r" UL_CLOEXECSTR);
+	if (!f)
+		return -errno;
+
+	new_tb = mnt_new_table();
+	if (!new_tb) {
+		rc = -ENOMEM;
+		goto done;
+	}
+	new_tb->fmt = MNT_FMT_MOUNTINFO;
+
+	ents = kdiff_new_hash(kd->nents, &sz);
+	if (!ents) {
+		rc = -ENOMEM;
+		goto done;
+	}
+
+	while ((len = getline(&kd->buf, &kd->bufsz, f)) > 0) {
+		struct kdiff_entry *o = NULL, *e;
+		char *end = NULL;
+		int id;
+
+		if (kd->buf[len - 1] == '\n')
+			kd->buf[--len] = '\0';
+
+		errno = 0;
+		id = (int) strtol(kd->buf, &end, 10);
+		if (errno || end == kd->buf || id < 0)
+			continue;
+
+		/* resize the new hash */
+		if (n + 1 > sz / 2) {
+			struct kdiff_entry *x;
+			size_t xsz;
+
+			x = kdiff_new_hash(n + 1, &xsz);
+			if (!x) {
+				rc = -ENOMEM;
+				goto done;
+			}
+			for (i = 0; i < sz; i++) {
+				if (ents[i].id >= 0)
+					*kdiff_get_slot(x, xsz, ents[i].id) = ents[i];
+			}
+			free(ents);
+			ents = x;
+			sz = xsz;
+		}
+
+		e = kdiff_get_slot(ents, sz, id);
+		if (e->id >= 0)
+			continue;	/* duplicate ID, ignore */
+
+		if (kd->ents) {
+			o = kdiff_get_slot(kd->ents, kd->sz, id);
+			if (o->id < 0)
+				o = NULL;
+		}
+
+		if (o && strcmp(o->line, kd->buf) == 0) {
+			/* not modified, steal the old entry */
+			*e = *o;
+			o->line = NULL;
+			o->fs = NULL;
+			o->seen = 1;
+			e->seen = 0;
+
+		} else {
+			fs = mnt_new_fs();
+			e->line = strdup(kd->buf);
+			if (!fs || !e->line) {
+				free(e->line);
+				e->line = NULL;
+				mnt_unref_fs(fs);
+				rc = -ENOMEM;
+				goto done;
+			}
+			rc = mnt_table_parse_mountinfo_line(new_tb, fs, kd->buf,
+						&kd->tid, filename);
+			if (rc) {
+				/* ignore broken line */
+				DBG(MONITOR, ul_debugobj(mn, "mountinfo parse error [rc=%d]", rc));
+				free(e->line);
+				e->line = NULL;
+				mnt_unref_fs(fs);
+				fs = NULL;
+				rc = 0;
+				continue;
+			}
+			e->fs = fs;
+			fs = NULL;
+
+			/* mark the slot as used, so the line and fs are
+			 * released by free_kdiff_entries() on error */
+			e->id = id;
+
+			if (o) {
+				o->seen = 1;
+				rc = kdiff_compare(df, o->fs, e->fs);
+			} else
+				rc = mnt_tabdiff_add_entry(df, NULL, e->fs, MNT_TABDIFF_MOUNT);
+			if (rc)
+				goto done;
+		}
+		e->id = id;
+		n++;
+
+		rc = kdiff_add_fs(new_tb, e->fs);
+		if (rc)
+			goto done;
+	}
+
+	/* umounted, the unmodified entries are already removed from the
+	 * previous table, so only the modified and umounted are there */
+	if (kd->tb && kd->ents) {
+		struct libmnt_iter itr;
+
+		mnt_reset_iter(&itr, MNT_ITER_FORWARD);
+		while (mnt_table_next_fs(kd->tb, &itr, &fs) == 0) {
+			struct kdiff_entry *o = kdiff_get_slot(kd->ents, kd->sz,
+							       mnt_fs_get_id(fs));
+
+			if (o->id < 0 || o->seen || o->fs != fs)
+				continue;
+			rc = mnt_tabdiff_add_entry(df, o->fs, NULL, MNT_TABDIFF_UMOUNT);
+			if (rc)
+				goto done;
+		}
+		fs = NULL;
+	}
+
+	free_kdiff_entries(kd->ents, kd->sz);
+	kd->ents = ents;
+	kd->sz = sz;
+	kd->nents = n;
+	ents = NULL;
+
+	mnt_unref_table(kd->tb);
+	kd->tb = new_tb;
+	new_tb = NULL;
+
+	if (tb)
+		*tb = kd->tb;
+	rc = mnt_tabdiff_get_nchanges(df);
+
+	DBG(MONITOR, ul_debugobj(mn, "kernel diff: %zu entries, %d changes", n, rc));
+done:
+	if (rc < 0) {
+		/* some old entries are already stolen, start from scratch */
+		DBG(MONITOR, ul_debugobj(mn, "kernel diff failed [rc=%d]", rc));
+		free_kdiff_entries(ents, sz);
+		free_monitor_kdiff(kd);
+		mn->kdiff = NULL;
+		mnt_tabdiff_reset(df);
+	}
+	mnt_unref_table(new_tb);
+	fclose(f);
+	return rc;
+}
+
+/**
+ * mnt_monitor_diff_kernel:
+ * @mn: monitor
+ * @df: diff handler
+ * @tb: returns the current mount table (optional)
+ *
+ * Reads /proc/self/mountinfo and compares it with the content read by the
+ * previous call, the result is stored in @df and accessible by
+ * mnt_tabdiff_next_change(). All the entries are reported as
+ * MNT_TABDIFF_MOUNT by the first call.
+ *
+ * The function is intended for kernel events (see
+ * mnt_monitor_enable_kernel()). Only lines modified since the previous call
+ * are parsed, so the cost of the call mostly depends on the number of
+ * changes. The entries are matched by mount ID (not by source and target
+ * as in mnt_diff_tables()):
+ *
+ * - a new ID is MNT_TABDIFF_MOUNT and a missing ID is MNT_TABDIFF_UMOUNT;
+ *   umount and mount on the same target is always reported as UMOUNT and
+ *   MOUNT, because the kernel uses a new ID for the new mount
+ *
+ * - a modified line with the same ID and a different target is
+ *   MNT_TABDIFF_MOVE if the source is the same, otherwise MNT_TABDIFF_UMOUNT
+ *   and MNT_TABDIFF_MOUNT
+ *
+ * - a modified line with the same ID and target is MNT_TABDIFF_REMOUNT if
+ *   the VFS or FS options are different, otherwise it's not reported
+ *
+ * The changes are reported in the order of the new mountinfo lines, and the
+ * umounted entries are reported at the end in the order of the previous
+ * mountinfo. The changes and their order may be different from the result
+ * of mnt_diff_tables() for the same tables.
+ *
+ * The returned table is owned by the monitor and it is valid until the next
+ * mnt_monitor_diff_kernel() call; use mnt_ref_table() to keep it longer.
+ *
+ * Returns: number of changes, negative number in case of error.
+ *
+ * Since: 2.38
+ */
+int mnt_monitor_diff_kernel(struct libmnt_monitor *mn,
+			    struct libmnt_tabdiff *df,
+			    struct libmnt_table **tb)
+{
+	return kdiff_file(mn, df, tb, _PATH_PROC_MOUNTINFO);
+}
+
 #ifdef TEST_PROGRAM
 
 static struct libmnt_monitor *create_test_monitor(int argc, char *argv[])
@@ -965,9 +1322,68 @@ static int test_wait(struct libmnt_test *ts, int argc, char *argv[])
 	return 0;
 }
 
+/* prints changes in the same format as test_mount_tab_diff --diff */
+static int test_kdiff(struct libmnt_test *ts, int argc, char *argv[])
+{
+	struct libmnt_monitor *mn;
+	struct libmnt_tabdiff *diff;
+	struct libmnt_iter *itr;
+	struct libmnt_fs *old, *new;
+	int rc = -1, change;
+
+	if (argc != 3)
+		return -1;
+
+	mn = mnt_new_monitor();
+	diff = mnt_new_tabdiff();
+	itr = mnt_new_iter(MNT_ITER_FORWARD);
+	if (!mn || !diff || !itr) {
+		warnx("failed to allocate resources");
+		goto done;
+	}
+
+	rc = kdiff_file(mn, diff, NULL, argv[1]);
+	if (rc >= 0)
+		rc = kdiff_file(mn, diff, NULL, argv[2]);
+	if (rc < 0)
+		goto done;
+
+	while (mnt_tabdiff_next_change(diff, itr, &old, &new, &change) == 0) {
+
+		printf("%s on %s: ", mnt_fs_get_source(new ? new : old),
+				     mnt_fs_get_target(new ? new : old));
+
+		switch (change) {
+		case MNT_TABDIFF_MOVE:
+			printf("MOVED to %s\n", mnt_fs_get_target(new));
+			break;
+		case MNT_TABDIFF_UMOUNT:
+			printf("UMOUNTED\n");
+			break;
+		case MNT_TABDIFF_REMOUNT:
+			printf("REMOUNTED from '%s' to '%s'\n",
+					mnt_fs_get_options(old),
+					mnt_fs_get_options(new));
+			break;
+		case MNT_TABDIFF_MOUNT:
+			printf("MOUNTED\n");
+			break;
+		default:
+			printf("unknown change!\n");
+		}
+	}
+	rc = 0;
+done:
+	mnt_unref_monitor(mn);
+	mnt_free_tabdiff(diff);
+	mnt_free_iter(itr);
+	return rc;
+}
+
 int main(int argc, char *argv[])
 {
 	struct libmnt_test tss[] = {
+		{ "--kdiff", test_kdiff, "<old> <new>  prints changes by mount IDs" },
 		{ "--epoll", test_epoll, "<userspace kernel ...>  monitor in epoll" },
 		{ "--epoll-clean", test_epoll_cleanup, "<userspace kernel ...>  monitor in epoll and clean events" },
 		{ "--wait",  test_wait,  "<userspace kernel ...>  monitor wait function" },
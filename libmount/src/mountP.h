@@ -126,6 +126,10 @@ extern int mnt_lstat_mountpoint(const char *target, struct stat *st);
 extern int mnt_tmptgt_unshare(int *old_ns_fd);
 extern int mnt_tmptgt_cleanup(int old_ns_fd);
 
+/* cache.c */
+extern uint32_t mnt_hash_path(const char *path);
+extern uint32_t mnt_hash_str(const char *str);
+
 /* tab.c */
 extern int is_mountinfo(struct libmnt_table *tb);
 extern int mnt_table_set_parser_fltrcb(	struct libmnt_table *tb,
@@ -218,6 +222,26 @@ struct libmnt_fs {
 	char		*comment;	/* fstab comment */
 
 	void		*userdata;	/* library independent data */
+
+	struct libmnt_arena *arena;	/* owner of the strings or NULL */
+	struct libmnt_arena *slab;	/* owner of this struct or NULL */
+};
+
+/*
+ * Shared memory for the mountinfo parser. The strings are unmangled in the
+ * @buf and the entries are allocated from the @fss slab. The arena is
+ * referenced by all the entries, strings are detached (strdup-ed) by
+ * mnt_fs_detach_arena() before the entry is modified.
+ */
+struct libmnt_arena {
+	int		refcount;
+
+	char		*buf;		/* file content and merged options */
+	size_t		bufsz;
+
+	struct libmnt_fs *fss;		/* slab */
+	size_t		nfss;		/* number of entries in the slab */
+	size_t		nused;		/* number of used entries */
 };
 
 /*
@@ -251,6 +275,41 @@ struct libmnt_table {
 
 	struct list_head	ents;	/* list of entries (libmnt_fs) */
 	void		*userdata;
+
+	int		indexed;	/* enable/disable lookup index */
+	struct libmnt_tabidx *idx;	/* lookup index, see tab_index.c */
+};
+
+/*
+ * Lookup index keys (tab_index.c)
+ */
+enum {
+	MNT_TABIDX_TARGET = 0,	/* target path */
+	MNT_TABIDX_CTARGET,	/* canonicalized target of non-kernel entries */
+	MNT_TABIDX_SRCPATH,	/* source path */
+	MNT_TABIDX_CSRCPATH,	/* canonicalized source path */
+	MNT_TABIDX_DEVNO,	/* device number */
+	MNT_TABIDX_ID,		/* mount ID */
+	MNT_TABIDX_LOOPDEV,	/* all /dev/loop sources */
+
+	MNT_TABIDX_NR
+};
+
+struct libmnt_tabidx_key {
+	int		type;		/* MNT_TABIDX_* */
+	uint32_t	hash;
+};
+
+struct libmnt_tabidx_iter {
+	struct libmnt_iter	itr;	/* used if index is not available */
+
+	struct libmnt_fs	**ents;	/* NULL if index is not used */
+	const size_t		*pos;	/* positions in @ents */
+	size_t			npos;
+	size_t			i;
+	int			direction;
+
+	size_t			*buf;	/* merged positions for more keys */
 };
 
 extern struct libmnt_table *__mnt_new_table_from_file(const char *filename, int fmt, int empty_for_enoent);
@@ -387,6 +446,19 @@ struct libmnt_context
 /* Flags usable with MS_BIND|MS_REMOUNT */
 #define MNT_BIND_SETTABLE	(MS_NOSUID|MS_NODEV|MS_NOEXEC|MS_NOATIME|MS_NODIRATIME|MS_RELATIME|MS_RDONLY)
 
+/* tab_index.c */
+extern struct libmnt_tabidx_key mnt_tabidx_key_str(int type, const char *str);
+extern struct libmnt_tabidx_key mnt_tabidx_key_num(int type, uint64_t num);
+extern void mnt_table_init_candidates(struct libmnt_table *tb,
+				struct libmnt_tabidx_iter *it, int direction,
+				const struct libmnt_tabidx_key *keys, size_t nkeys);
+extern int mnt_table_next_candidate(struct libmnt_table *tb,
+				struct libmnt_tabidx_iter *it,
+				struct libmnt_fs **fs);
+extern void mnt_table_deinit_candidates(struct libmnt_tabidx_iter *it);
+extern int mnt_table_index_get_ntags(struct libmnt_table *tb);
+extern void mnt_table_reset_index(struct libmnt_table *tb);
+
 /* lock.c */
 extern int mnt_lock_use_simplelock(struct libmnt_lock *ml, int enable);
 
@@ -412,6 +484,14 @@ extern int __mnt_fs_set_source_ptr(struct libmnt_fs *fs, char *source)
 			__attribute__((nonnull(1)));
 extern int __mnt_fs_set_fstype_ptr(struct libmnt_fs *fs, char *fstype)
 			__attribute__((nonnull(1)));
+extern int mnt_merge_optstr_to_buffer(const char *vfs, const char *fs,
+			char *buf, size_t bufsz);
+extern int mnt_fs_detach_arena(struct libmnt_fs *fs);
+
+extern struct libmnt_arena *mnt_new_arena(char *buf, size_t bufsz, size_t nfss);
+extern void mnt_ref_arena(struct libmnt_arena *ar);
+extern void mnt_unref_arena(struct libmnt_arena *ar);
+extern struct libmnt_fs *mnt_arena_new_fs(struct libmnt_arena *ar);
 
 /* context.c */
 extern struct libmnt_context *mnt_copy_context(struct libmnt_context *o);
@@ -470,6 +550,17 @@ extern int mnt_context_is_veritydev(struct libmnt_context *cxt)
 extern int mnt_context_setup_veritydev(struct libmnt_context *cxt);
 extern int mnt_context_deferred_delete_veritydev(struct libmnt_context *cxt);
 
+/* tab_parse.c */
+extern int mnt_table_parse_mountinfo_line(struct libmnt_table *tb,
+				struct libmnt_fs *fs, const char *line,
+				pid_t *tid, const char *filename);
+
+/* tab_diff.c */
+extern int mnt_tabdiff_reset(struct libmnt_tabdiff *df);
+extern int mnt_tabdiff_add_entry(struct libmnt_tabdiff *df, struct libmnt_fs *old,
+				 struct libmnt_fs *new, int oper);
+extern int mnt_tabdiff_get_nchanges(struct libmnt_tabdiff *df);
+
 /* tab_update.c */
 extern int mnt_update_set_filename(struct libmnt_update *upd,
 				   const char *filename, int userspace_only);
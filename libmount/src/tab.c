@@ -169,6 +169,7 @@ void mnt_free_table(struct libmnt_table *tb)
 	mnt_reset_table(tb);
 	DBG(TAB, ul_debugobj(tb, "free [refcount=%d]", tb->refcount));
 
+	mnt_table_reset_index(tb);
 	mnt_unref_cache(tb->cache);
 	free(tb->comm_intro);
 	free(tb->comm_tail);
@@ -381,6 +382,7 @@ int mnt_table_set_cache(struct libmnt_table *tb, struct libmnt_cache *mpc)
 	mnt_ref_cache(mpc);			/* new */
 	mnt_unref_cache(tb->cache);		/* old */
 	tb->cache = mpc;
+	mnt_table_reset_index(tb);
 	return 0;
 }
 
@@ -452,6 +454,7 @@ int mnt_table_add_fs(struct libmnt_table *tb, struct libmnt_fs *fs)
 	list_add_tail(&fs->ents, &tb->ents);
 	fs->tab = tb;
 	tb->nents++;
+	mnt_table_reset_index(tb);
 
 	DBG(TAB, ul_debugobj(tb, "add entry: %s %s",
 			mnt_fs_get_source(fs), mnt_fs_get_target(fs)));
@@ -471,6 +474,7 @@ static int __table_insert_fs(
 
 	fs->tab = tb;
 	tb->nents++;
+	mnt_table_reset_index(tb);
 
 	DBG(TAB, ul_debugobj(tb, "insert entry: %s %s",
 			mnt_fs_get_source(fs), mnt_fs_get_target(fs)));
@@ -542,6 +546,7 @@ int mnt_table_move_fs(struct libmnt_table *src, struct libmnt_table *dst,
 	/* remove from source */
 	list_del_init(&fs->ents);
 	src->nents--;
+	mnt_table_reset_index(src);
 
 	/* insert to the destination */
 	return __table_insert_fs(dst, before, pos, fs);
@@ -569,17 +574,21 @@ int mnt_table_remove_fs(struct libmnt_table *tb, struct libmnt_fs *fs)
 
 	mnt_unref_fs(fs);
 	tb->nents--;
+	mnt_table_reset_index(tb);
 	return 0;
 }
 
 static inline struct libmnt_fs *get_parent_fs(struct libmnt_table *tb, struct libmnt_fs *fs)
 {
-	struct libmnt_iter itr;
+	struct libmnt_tabidx_iter it;
+	struct libmnt_tabidx_key key;
 	struct libmnt_fs *x;
 	int parent_id = mnt_fs_get_parent_id(fs);
 
-	mnt_reset_iter(&itr, MNT_ITER_FORWARD);
-	while (mnt_table_next_fs(tb, &itr, &x) == 0) {
+	key = mnt_tabidx_key_num(MNT_TABIDX_ID, parent_id);
+
+	mnt_table_init_candidates(tb, &it, MNT_ITER_FORWARD, &key, 1);
+	while (mnt_table_next_candidate(tb, &it, &x) == 0) {
 		if (mnt_fs_get_id(x) == parent_id)
 			return x;
 	}
@@ -1050,7 +1059,8 @@ struct libmnt_fs *mnt_table_find_mountpoint(struct libmnt_table *tb,
  */
 struct libmnt_fs *mnt_table_find_target(struct libmnt_table *tb, const char *path, int direction)
 {
-	struct libmnt_iter itr;
+	struct libmnt_tabidx_iter it;
+	struct libmnt_tabidx_key key;
 	struct libmnt_fs *fs = NULL;
 	char *cn;
 
@@ -1062,8 +1072,9 @@ struct libmnt_fs *mnt_table_find_target(struct libmnt_table *tb, const char *pat
 	DBG(TAB, ul_debugobj(tb, "lookup TARGET: '%s'", path));
 
 	/* native @target */
-	mnt_reset_iter(&itr, direction);
-	while(mnt_table_next_fs(tb, &itr, &fs) == 0) {
+	key = mnt_tabidx_key_str(MNT_TABIDX_TARGET, path);
+	mnt_table_init_candidates(tb, &it, direction, &key, 1);
+	while(mnt_table_next_candidate(tb, &it, &fs) == 0) {
 		if (mnt_fs_streq_target(fs, path))
 			return fs;
 	}
@@ -1071,8 +1082,9 @@ struct libmnt_fs *mnt_table_find_target(struct libmnt_table *tb, const char *pat
 	/* try absolute path */
 	if (is_relative_path(path) && (cn = absolute_path(path))) {
 		DBG(TAB, ul_debugobj(tb, "lookup absolute TARGET: '%s'", cn));
-		mnt_reset_iter(&itr, direction);
-		while (mnt_table_next_fs(tb, &itr, &fs) == 0) {
+		key = mnt_tabidx_key_str(MNT_TABIDX_TARGET, cn);
+		mnt_table_init_candidates(tb, &it, direction, &key, 1);
+		while (mnt_table_next_candidate(tb, &it, &fs) == 0) {
 			if (mnt_fs_streq_target(fs, cn)) {
 				free(cn);
 				return fs;
@@ -1087,8 +1099,9 @@ struct libmnt_fs *mnt_table_find_target(struct libmnt_table *tb, const char *pat
 	DBG(TAB, ul_debugobj(tb, "lookup canonical TARGET: '%s'", cn));
 
 	/* canonicalized paths in struct libmnt_table */
-	mnt_reset_iter(&itr, direction);
-	while(mnt_table_next_fs(tb, &itr, &fs) == 0) {
+	key = mnt_tabidx_key_str(MNT_TABIDX_TARGET, cn);
+	mnt_table_init_candidates(tb, &it, direction, &key, 1);
+	while(mnt_table_next_candidate(tb, &it, &fs) == 0) {
 		if (mnt_fs_streq_target(fs, cn))
 			return fs;
 	}
@@ -1097,8 +1110,9 @@ struct libmnt_fs *mnt_table_find_target(struct libmnt_table *tb, const char *pat
 	 * -- note that mountpoint in /proc/self/mountinfo is already
 	 *    canonicalized by the kernel
 	 */
-	mnt_reset_iter(&itr, direction);
-	while(mnt_table_next_fs(tb, &itr, &fs) == 0) {
+	key = mnt_tabidx_key_str(MNT_TABIDX_CTARGET, cn);
+	mnt_table_init_candidates(tb, &it, direction, &key, 1);
+	while(mnt_table_next_candidate(tb, &it, &fs) == 0) {
 		char *p;
 
 		if (!fs->target
@@ -1137,9 +1151,11 @@ struct libmnt_fs *mnt_table_find_target(struct libmnt_table *tb, const char *pat
  */
 struct libmnt_fs *mnt_table_find_srcpath(struct libmnt_table *tb, const char *path, int direction)
 {
+	struct libmnt_tabidx_iter it;
+	struct libmnt_tabidx_key key;
 	struct libmnt_iter itr;
 	struct libmnt_fs *fs = NULL;
-	int ntags = 0, nents;
+	int ntags = 0, nents, idx_ntags;
 	char *cn;
 	const char *p;
 
@@ -1151,9 +1167,13 @@ struct libmnt_fs *mnt_table_find_srcpath(struct libmnt_table *tb, const char *pa
 	DBG(TAB, ul_debugobj(tb, "lookup SRCPATH: '%s'", path));
 
 	/* native paths */
-	mnt_reset_iter(&itr, direction);
+	key = mnt_tabidx_key_str(MNT_TABIDX_SRCPATH, path);
+	mnt_table_init_candidates(tb, &it, direction, &key, 1);
 
-	while(mnt_table_next_fs(tb, &itr, &fs) == 0) {
+	/* the index counts tags in all entries, don't count them here */
+	idx_ntags = mnt_table_index_get_ntags(tb);
+
+	while(mnt_table_next_candidate(tb, &it, &fs) == 0) {
 
 		if (mnt_fs_streq_srcpath(fs, path)) {
 #ifdef HAVE_BTRFS_SUPPORT
@@ -1179,9 +1199,11 @@ struct libmnt_fs *mnt_table_find_srcpath(struct libmnt_table *tb, const char *pa
 #endif /* HAVE_BTRFS_SUPPORT */
 			return fs;
 		}
-		if (mnt_fs_get_tag(fs, NULL, NULL) == 0)
+		if (idx_ntags < 0 && mnt_fs_get_tag(fs, NULL, NULL) == 0)
 			ntags++;
 	}
+	if (idx_ntags >= 0)
+		ntags = idx_ntags;
 
 	if (!path || !tb->cache || !(cn = mnt_resolve_path(path, tb->cache)))
 		return NULL;
@@ -1192,8 +1214,9 @@ struct libmnt_fs *mnt_table_find_srcpath(struct libmnt_table *tb, const char *pa
 
 	/* canonicalized paths in struct libmnt_table */
 	if (ntags < nents) {
-		mnt_reset_iter(&itr, direction);
-		while(mnt_table_next_fs(tb, &itr, &fs) == 0) {
+		key = mnt_tabidx_key_str(MNT_TABIDX_SRCPATH, cn);
+		mnt_table_init_candidates(tb, &it, direction, &key, 1);
+		while(mnt_table_next_candidate(tb, &it, &fs) == 0) {
 			if (mnt_fs_streq_srcpath(fs, cn))
 				return fs;
 		}
@@ -1235,8 +1258,9 @@ struct libmnt_fs *mnt_table_find_srcpath(struct libmnt_table *tb, const char *pa
 
 	/* non-canonicalized paths in struct libmnt_table */
 	if (ntags <= nents) {
-		mnt_reset_iter(&itr, direction);
-		while(mnt_table_next_fs(tb, &itr, &fs) == 0) {
+		key = mnt_tabidx_key_str(MNT_TABIDX_CSRCPATH, cn);
+		mnt_table_init_candidates(tb, &it, direction, &key, 1);
+		while(mnt_table_next_candidate(tb, &it, &fs) == 0) {
 			if (mnt_fs_is_netfs(fs) || mnt_fs_is_pseudofs(fs))
 				continue;
 			p = mnt_fs_get_srcpath(fs);
@@ -1430,7 +1454,8 @@ struct libmnt_fs *mnt_table_find_devno(struct libmnt_table *tb,
 				       dev_t devno, int direction)
 {
 	struct libmnt_fs *fs = NULL;
-	struct libmnt_iter itr;
+	struct libmnt_tabidx_iter it;
+	struct libmnt_tabidx_key key;
 
 	if (!tb)
 		return NULL;
@@ -1439,9 +1464,10 @@ struct libmnt_fs *mnt_table_find_devno(struct libmnt_table *tb,
 
 	DBG(TAB, ul_debugobj(tb, "lookup DEVNO: %d", (int) devno));
 
-	mnt_reset_iter(&itr, direction);
+	key = mnt_tabidx_key_num(MNT_TABIDX_DEVNO, devno);
+	mnt_table_init_candidates(tb, &it, direction, &key, 1);
 
-	while(mnt_table_next_fs(tb, &itr, &fs) == 0) {
+	while(mnt_table_next_candidate(tb, &it, &fs) == 0) {
 		if (mnt_fs_get_devno(fs) == devno)
 			return fs;
 	}
@@ -1712,7 +1738,9 @@ err:
 int __mnt_table_is_fs_mounted(struct libmnt_table *tb, struct libmnt_fs *fstab_fs,
 			      const char *tgt_prefix)
 {
-	struct libmnt_iter itr;
+	struct libmnt_tabidx_iter it = { .buf = NULL };
+	struct libmnt_tabidx_key keys[3];
+	size_t nkeys = 0;
 	struct libmnt_fs *fs;
 
 	char *root = NULL;
@@ -1774,11 +1802,17 @@ int __mnt_table_is_fs_mounted(struct libmnt_table *tb, struct libmnt_fs *fstab_f
 		DBG(FS, ul_debugobj(fstab_fs, "- ignore (no source/target)"));
 		goto done;
 	}
-	mnt_reset_iter(&itr, MNT_ITER_FORWARD);
+	/* entries with the same source, device number or a loop device */
+	keys[nkeys++] = mnt_tabidx_key_str(MNT_TABIDX_SRCPATH, src);
+	if (devno)
+		keys[nkeys++] = mnt_tabidx_key_num(MNT_TABIDX_DEVNO, devno);
+	keys[nkeys++] = mnt_tabidx_key_num(MNT_TABIDX_LOOPDEV, 0);
+
+	mnt_table_init_candidates(tb, &it, MNT_ITER_FORWARD, keys, nkeys);
 
 	DBG(FS, ul_debugobj(fstab_fs, "mnt_table_is_fs_mounted: src=%s, tgt=%s, root=%s", src, tgt, root));
 
-	while (mnt_table_next_fs(tb, &itr, &fs) == 0) {
+	while (mnt_table_next_candidate(tb, &it, &fs) == 0) {
 
 		int eq = mnt_fs_streq_srcpath(fs, src);
 
@@ -1865,6 +1899,7 @@ int __mnt_table_is_fs_mounted(struct libmnt_table *tb, struct libmnt_fs *fstab_f
 	if (fs)
 		rc = 1;		/* success */
 done:
+	mnt_table_deinit_candidates(&it);
 	free(root);
 	free(tgt_buf);
 
@@ -2094,6 +2129,189 @@ static int test_find_fw(struct libmnt_test *ts, int argc, char *argv[])
 	return test_find(ts, argc, argv, MNT_ITER_FORWARD);
 }
 
+/*
+ * The entry outlives the table, then it's copied and modified. The strings of
+ * the parsed entries are stored in the parser buffer.
+ */
+static int test_keep_fs(struct libmnt_test *ts, int argc, char *argv[])
+{
+	struct libmnt_table *tb;
+	struct libmnt_fs *fs, *cp = NULL;
+	int rc = -1;
+
+	if (argc != 3) {
+		fprintf(stderr, "try --help\n");
+		return -EINVAL;
+	}
+
+	tb = create_table(argv[1], FALSE);
+	if (!tb)
+		return -1;
+
+	fs = mnt_table_find_target(tb, argv[2], MNT_ITER_BACKWARD);
+	if (!fs) {
+		fprintf(stderr, "%s: not found '%s'\n", argv[1], argv[2]);
+		mnt_unref_table(tb);
+		return -1;
+	}
+	mnt_ref_fs(fs);
+	mnt_unref_table(tb);
+
+	printf("--- entry:\n");
+	mnt_fs_print_debug(fs, stdout);
+
+	cp = mnt_copy_fs(NULL, fs);
+	if (!cp)
+		goto done;
+
+	if (mnt_fs_set_target(fs, "/mnt/new") ||
+	    mnt_fs_set_source(fs, "/dev/new") ||
+	    mnt_fs_append_options(fs, "ro,foo=bar"))
+		goto done;
+
+	printf("--- modified:\n");
+	mnt_fs_print_debug(fs, stdout);
+	printf("--- copy:\n");
+	mnt_fs_print_debug(cp, stdout);
+	rc = 0;
+done:
+	mnt_unref_fs(cp);
+	mnt_unref_fs(fs);
+	return rc;
+}
+
+/* returns position of @fs in @tb or 0 */
+static int fs_position(struct libmnt_table *tb, struct libmnt_fs *fs)
+{
+	return fs ? mnt_table_find_fs(tb, fs) : 0;
+}
+
+static int check_index_lookup(const char *what, const char *str,
+			      struct libmnt_table *tb, struct libmnt_fs *a,
+			      struct libmnt_table *ix, struct libmnt_fs *b)
+{
+	int x = fs_position(tb, a), y = fs_position(ix, b);
+
+	if (x == y)
+		return 0;
+	printf("%s %s: mismatch %d (linear) %d (index)\n", what, str, x, y);
+	return 1;
+}
+
+/*
+ * Compare lookups in the table with and without the index. The optional
+ * fstab is used for mnt_table_is_fs_mounted().
+ */
+static int test_check_index(struct libmnt_test *ts, int argc, char *argv[])
+{
+	struct libmnt_table *tb = NULL, *ix = NULL, *fstab = NULL;
+	struct libmnt_iter *itr = NULL, *itr2 = NULL;
+	struct libmnt_fs *fs, *fs2, *a, *b;
+	struct libmnt_cache *mpc;
+	const int dirs[] = { MNT_ITER_FORWARD, MNT_ITER_BACKWARD };
+	size_t i, nlookups = 0, nerrs = 0;
+	int rc = -1;
+
+	if (argc < 2) {
+		fprintf(stderr, "try --help\n");
+		return -EINVAL;
+	}
+
+	tb = create_table(argv[1], FALSE);
+	ix = create_table(argv[1], FALSE);
+	if (!tb || !ix)
+		goto done;
+	if (argc > 2 && !(fstab = create_table(argv[2], FALSE)))
+		goto done;
+
+	/* both tables use own cache for canonicalized paths */
+	mpc = mnt_new_cache();
+	if (!mpc)
+		goto done;
+	mnt_table_set_cache(tb, mpc);
+	mnt_unref_cache(mpc);
+
+	mpc = mnt_new_cache();
+	if (!mpc)
+		goto done;
+	mnt_table_set_cache(ix, mpc);
+	mnt_unref_cache(mpc);
+
+	mnt_table_enable_index(ix, TRUE);
+
+	itr = mnt_new_iter(MNT_ITER_FORWARD);
+	itr2 = mnt_new_iter(MNT_ITER_FORWARD);
+	if (!itr || !itr2)
+		goto done;
+
+	while (mnt_table_next_fs(tb, itr, &fs) == 0 &&
+	       mnt_table_next_fs(ix, itr2, &fs2) == 0) {
+		const char *tgt = mnt_fs_get_target(fs);
+		const char *src = mnt_fs_get_srcpath(fs);
+		dev_t devno = mnt_fs_get_devno(fs);
+
+		for (i = 0; i < ARRAY_SIZE(dirs); i++) {
+			if (tgt) {
+				a = mnt_table_find_target(tb, tgt, dirs[i]);
+				b = mnt_table_find_target(ix, tgt, dirs[i]);
+				nerrs += check_index_lookup("target", tgt, tb, a, ix, b);
+				nlookups++;
+			}
+			if (src) {
+				a = mnt_table_find_srcpath(tb, src, dirs[i]);
+				b = mnt_table_find_srcpath(ix, src, dirs[i]);
+				nerrs += check_index_lookup("srcpath", src, tb, a, ix, b);
+				nlookups++;
+			}
+			if (devno) {
+				a = mnt_table_find_devno(tb, devno, dirs[i]);
+				b = mnt_table_find_devno(ix, devno, dirs[i]);
+				nerrs += check_index_lookup("devno", tgt, tb, a, ix, b);
+				nlookups++;
+			}
+		}
+		if (is_mountinfo(tb)) {
+			a = get_parent_fs(tb, fs);
+			b = get_parent_fs(ix, fs2);
+			nerrs += check_index_lookup("parent", tgt, tb, a, ix, b);
+			nlookups++;
+		}
+	}
+
+	if (is_mountinfo(tb)) {
+		a = b = NULL;
+		mnt_table_get_root_fs(tb, &a);
+		mnt_table_get_root_fs(ix, &b);
+		nerrs += check_index_lookup("root", "", tb, a, ix, b);
+		nlookups++;
+	}
+
+	if (fstab) {
+		mnt_reset_iter(itr, MNT_ITER_FORWARD);
+		while (mnt_table_next_fs(fstab, itr, &fs) == 0) {
+			int x = mnt_table_is_fs_mounted(tb, fs);
+			int y = mnt_table_is_fs_mounted(ix, fs);
+
+			if (x != y) {
+				printf("mounted %s: mismatch %d (linear) %d (index)\n",
+						mnt_fs_get_target(fs), x, y);
+				nerrs++;
+			}
+			nlookups++;
+		}
+	}
+
+	printf("lookups: %zu\nmismatches: %zu\n", nlookups, nerrs);
+	rc = nerrs ? 1 : 0;
+done:
+	mnt_free_iter(itr);
+	mnt_free_iter(itr2);
+	mnt_unref_table(tb);
+	mnt_unref_table(ix);
+	mnt_unref_table(fstab);
+	return rc;
+}
+
 static int test_find_pair(struct libmnt_test *ts, int argc, char *argv[])
 {
 	struct libmnt_table *tb;
@@ -2249,6 +2467,8 @@ int main(int argc, char *argv[])
 	{ "--uniq-target",   test_uniq,    "<file>" },
 	{ "--find-pair",     test_find_pair, "<file> <source> <target>" },
 	{ "--find-fs",       test_find_idx, "<file> <target>" },
+	{ "--keep-fs",       test_keep_fs, "<file> <target> use and modify entry after the table is freed" },
+	{ "--check-index",   test_check_index, "<file> [<fstab>] compare lookups with and without index" },
 	{ "--find-mountpoint", test_find_mountpoint, "<path>" },
 	{ "--copy-fs",       test_copy_fs, "<file>  copy root FS from the file" },
 	{ "--is-mounted",    test_is_mounted, "<fstab> check what from fstab is already mounted" },
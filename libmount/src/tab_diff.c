@@ -186,6 +186,23 @@ static int tabdiff_add_entry(struct libmnt_tabdiff *df, struct libmnt_fs *old,
 	return 0;
 }
 
+/* used by monitor.c */
+int mnt_tabdiff_reset(struct libmnt_tabdiff *df)
+{
+	return tabdiff_reset(df);
+}
+
+int mnt_tabdiff_add_entry(struct libmnt_tabdiff *df, struct libmnt_fs *old,
+			  struct libmnt_fs *new, int oper)
+{
+	return tabdiff_add_entry(df, old, new, oper);
+}
+
+int mnt_tabdiff_get_nchanges(struct libmnt_tabdiff *df)
+{
+	return df->nchanges;
+}
+
 static struct tabdiff_entry *tabdiff_get_mount(struct libmnt_tabdiff *df,
 					       const char *src,
 					       int id)
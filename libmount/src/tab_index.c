@@ -0,0 +1,378 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * This file is part of libmount from util-linux project.
+ *
+ * libmount is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ *
+ * Lookup index for struct libmnt_table.
+ *
+ * The index is a set of hash tables (one for each MNT_TABIDX_* key type).
+ * Every hash table is built on the first lookup which needs it and all
+ * of them are dropped by mnt_table_reset_index() when the table is
+ * modified. The buckets are arrays of positions in the table, so the
+ * entries in the bucket are in the same order as in the table and
+ * the lookup functions return the same entry as with the linear search.
+ *
+ * The index is only a filter, the callers still compare the candidates.
+ */
+#include "mountP.h"
+#include "strutils.h"
+
+struct tabidx_hash {
+	size_t		nbuckets;	/* zero if not built yet */
+	size_t		*start;		/* bucket offsets in @pos, nbuckets + 1 */
+	size_t		*pos;		/* positions in libmnt_tabidx->ents */
+};
+
+struct libmnt_tabidx {
+	struct libmnt_fs	**ents;	/* table entries in the table order */
+	size_t			nents;
+	int			ntags;	/* number of entries with NAME=value source */
+
+	struct tabidx_hash	hash[MNT_TABIDX_NR];
+};
+
+static uint32_t hash_num(uint64_t num)
+{
+	return (uint32_t) (num ^ (num >> 32)) * 2654435761U;
+}
+
+struct libmnt_tabidx_key mnt_tabidx_key_str(int type, const char *str)
+{
+	struct libmnt_tabidx_key k = { .type = type };
+
+	switch (type) {
+	case MNT_TABIDX_TARGET:
+	case MNT_TABIDX_SRCPATH:
+		k.hash = mnt_hash_path(str);
+		break;
+	default:
+		k.hash = mnt_hash_str(str);
+		break;
+	}
+	return k;
+}
+
+struct libmnt_tabidx_key mnt_tabidx_key_num(int type, uint64_t num)
+{
+	struct libmnt_tabidx_key k = { .type = type, .hash = hash_num(num) };
+	return k;
+}
+
+/* returns 1 and the hash if @fs is indexed by @type */
+static int get_fs_hash(struct libmnt_table *tb, struct libmnt_fs *fs,
+		       int type, uint32_t *hash)
+{
+	const char *p;
+
+	switch (type) {
+	case MNT_TABIDX_TARGET:
+		p = mnt_fs_get_target(fs);
+		if (!p)
+			return 0;
+		*hash = mnt_hash_path(p);
+		break;
+	case MNT_TABIDX_CTARGET:
+		/* see the last step in mnt_table_find_target() */
+		p = mnt_fs_get_target(fs);
+		if (!p || mnt_fs_is_swaparea(fs) || mnt_fs_is_kernel(fs)
+		    || (*p == '/' && *(p + 1) == '\0'))
+			return 0;
+		p = mnt_resolve_target(p, tb->cache);
+		if (!p)
+			return 0;
+		*hash = mnt_hash_str(p);
+		break;
+	case MNT_TABIDX_SRCPATH:
+		p = mnt_fs_get_srcpath(fs);
+		if (!p)
+			return 0;
+		*hash = mnt_hash_path(p);
+		break;
+	case MNT_TABIDX_CSRCPATH:
+		/* see the last step in mnt_table_find_srcpath() */
+		if (mnt_fs_is_netfs(fs) || mnt_fs_is_pseudofs(fs))
+			return 0;
+		p = mnt_fs_get_srcpath(fs);
+		if (p)
+			p = mnt_resolve_path(p, tb->cache);
+		if (!p)
+			return 0;
+		*hash = mnt_hash_str(p);
+		break;
+	case MNT_TABIDX_DEVNO:
+		*hash = hash_num(mnt_fs_get_devno(fs));
+		break;
+	case MNT_TABIDX_ID:
+		*hash = hash_num(mnt_fs_get_id(fs));
+		break;
+	case MNT_TABIDX_LOOPDEV:
+		p = mnt_fs_get_srcpath(fs);
+		if (!p || !startswith(p, "/dev/loop"))
+			return 0;
+		*hash = 0;
+		break;
+	default:
+		return 0;
+	}
+	return 1;
+}
+
+static struct libmnt_tabidx *get_index(struct libmnt_table *tb)
+{
+	struct libmnt_tabidx *ix;
+	struct libmnt_iter itr;
+	struct libmnt_fs *fs;
+	size_t i = 0;
+
+	if (tb->idx)
+		return tb->idx;
+
+	ix = calloc(1, sizeof(*ix));
+	if (!ix)
+		return NULL;
+	if (tb->nents) {
+		ix->ents = malloc(tb->nents * sizeof(struct libmnt_fs *));
+		if (!ix->ents) {
+			free(ix);
+			return NULL;
+		}
+	}
+
+	mnt_reset_iter(&itr, MNT_ITER_FORWARD);
+	while (mnt_table_next_fs(tb, &itr, &fs) == 0 && i < (size_t) tb->nents) {
+		ix->ents[i++] = fs;
+		if (mnt_fs_get_tag(fs, NULL, NULL) == 0)
+			ix->ntags++;
+	}
+	ix->nents = i;
+
+	DBG(TAB, ul_debugobj(tb, "new index [entries=%zu]", ix->nents));
+	tb->idx = ix;
+	return ix;
+}
+
+static struct tabidx_hash *get_hash(struct libmnt_table *tb,
+				    struct libmnt_tabidx *ix, int type)
+{
+	struct tabidx_hash *h = &ix->hash[type];
+	uint32_t *hashes = NULL;
+	unsigned char *indexed = NULL;
+	size_t i, sz;
+
+	if (h->nbuckets)
+		return h;
+
+	for (sz = 16; sz < ix->nents; sz <<= 1);
+
+	h->start = calloc(sz + 1, sizeof(size_t));
+	h->pos = malloc((ix->nents ? ix->nents : 1) * sizeof(size_t));
+	hashes = malloc((ix->nents ? ix->nents : 1) * sizeof(uint32_t));
+	indexed = calloc(ix->nents ? ix->nents : 1, 1);
+	if (!h->start || !h->pos || !hashes || !indexed)
+		goto err;
+
+	/* count entries in buckets */
+	for (i = 0; i < ix->nents; i++) {
+		if (!get_fs_hash(tb, ix->ents[i], type, &hashes[i]))
+			continue;
+		hashes[i] &= sz - 1;
+		indexed[i] = 1;
+		h->start[hashes[i] + 1]++;
+	}
+	for (i = 1; i <= sz; i++)
+		h->start[i] += h->start[i - 1];
+
+	/* fill buckets, @start[n] is used as a cursor and restored later */
+	for (i = 0; i < ix->nents; i++) {
+		if (indexed[i])
+			h->pos[h->start[hashes[i]]++] = i;
+	}
+	for (i = sz; i > 0; i--)
+		h->start[i] = h->start[i - 1];
+	h->start[0] = 0;
+
+	h->nbuckets = sz;
+	free(hashes);
+	free(indexed);
+
+	DBG(TAB, ul_debugobj(tb, "index %d built [buckets=%zu]", type, sz));
+	return h;
+err:
+	free(h->start);
+	free(h->pos);
+	h->start = h->pos = NULL;
+	free(hashes);
+	free(indexed);
+	return NULL;
+}
+
+static int cmp_pos(const void *a, const void *b)
+{
+	size_t x = *((const size_t *) a), y = *((const size_t *) b);
+
+	return x < y ? -1 : x > y ? 1 : 0;
+}
+
+/*
+ * Initializes @it to iterate over entries which match (by hash) any of the
+ * @keys. If the index is not enabled for @tb (or on error) then all the
+ * table entries are returned by mnt_table_next_candidate().
+ */
+void mnt_table_init_candidates(struct libmnt_table *tb,
+			       struct libmnt_tabidx_iter *it, int direction,
+			       const struct libmnt_tabidx_key *keys, size_t nkeys)
+{
+	struct libmnt_tabidx *ix;
+	size_t i, n = 0;
+
+	memset(it, 0, sizeof(*it));
+	mnt_reset_iter(&it->itr, direction);
+	it->direction = direction;
+
+	if (!tb->indexed || !nkeys || !(ix = get_index(tb)))
+		return;
+
+	for (i = 0; i < nkeys; i++) {
+		struct tabidx_hash *h = get_hash(tb, ix, keys[i].type);
+		size_t b;
+
+		if (!h)
+			goto fallback;
+		b = keys[i].hash & (h->nbuckets - 1);
+
+		if (nkeys == 1) {
+			it->pos = h->pos + h->start[b];
+			it->npos = h->start[b + 1] - h->start[b];
+			break;
+		}
+
+		/* more keys, merge positions */
+		if (h->start[b + 1] > h->start[b]) {
+			size_t *buf, sz = h->start[b + 1] - h->start[b];
+
+			buf = realloc(it->buf, (n + sz) * sizeof(size_t));
+			if (!buf)
+				goto fallback;
+			memcpy(buf + n, h->pos + h->start[b], sz * sizeof(size_t));
+			it->buf = buf;
+			n += sz;
+		}
+	}
+
+	if (nkeys > 1 && n) {
+		size_t x;
+
+		qsort(it->buf, n, sizeof(size_t), cmp_pos);
+		for (i = 1, x = 1; i < n; i++) {
+			if (it->buf[i] != it->buf[x - 1])
+				it->buf[x++] = it->buf[i];
+		}
+		it->pos = it->buf;
+		it->npos = x;
+	}
+
+	it->ents = ix->ents;
+	return;
+fallback:
+	mnt_table_deinit_candidates(it);
+	mnt_reset_iter(&it->itr, direction);
+	it->direction = direction;
+}
+
+/*
+ * Returns 0 and the next entry in @fs, or 1 at the end.
+ */
+int mnt_table_next_candidate(struct libmnt_table *tb,
+			     struct libmnt_tabidx_iter *it,
+			     struct libmnt_fs **fs)
+{
+	size_t i;
+
+	if (!it->ents)
+		return mnt_table_next_fs(tb, &it->itr, fs);
+
+	*fs = NULL;
+	if (it->i >= it->npos)
+		return 1;
+
+	i = it->direction == MNT_ITER_FORWARD ? it->i : it->npos - it->i - 1;
+	it->i++;
+	*fs = it->ents[it->pos[i]];
+	return 0;
+}
+
+void mnt_table_deinit_candidates(struct libmnt_tabidx_iter *it)
+{
+	free(it->buf);
+	memset(it, 0, sizeof(*it));
+}
+
+/*
+ * Returns number of entries with NAME=value source or -1 if index is not
+ * used for the table.
+ */
+int mnt_table_index_get_ntags(struct libmnt_table *tb)
+{
+	struct libmnt_tabidx *ix;
+
+	if (!tb->indexed || !(ix = get_index(tb)))
+		return -1;
+	return ix->ntags;
+}
+
+/*
+ * Drops the index, it will be rebuilt on the next lookup.
+ */
+void mnt_table_reset_index(struct libmnt_table *tb)
+{
+	struct libmnt_tabidx *ix;
+	size_t i;
+
+	if (!tb || !tb->idx)
+		return;
+
+	ix = tb->idx;
+	for (i = 0; i < MNT_TABIDX_NR; i++) {
+		free(ix->hash[i].start);
+		free(ix->hash[i].pos);
+	}
+	free(ix->ents);
+	free(ix);
+	tb->idx = NULL;
+}
+
+/**
+ * mnt_table_enable_index:
+ * @tb: pointer to tab
+ * @enable: TRUE or FALSE
+ *
+ * Enables hash indexes for lookups by target, source path, device number
+ * and mount ID. It's used by mnt_table_find_target(),
+ * mnt_table_find_srcpath(), mnt_table_find_devno(), mnt_table_is_fs_mounted()
+ * and for parent lookups (e.g. mnt_table_get_root_fs()). The index is
+ * recommended for large tables when more lookups are expected.
+ *
+ * The index is built on demand and it's dropped when an entry is added to or
+ * removed from the table, or when the source or target of an entry is
+ * modified by mnt_fs_set_source() or mnt_fs_set_target().
+ *
+ * Returns: 0 on success or negative number in case of error.
+ *
+ * Since: 2.38
+ */
+int mnt_table_enable_index(struct libmnt_table *tb, int enable)
+{
+	if (!tb)
+		return -EINVAL;
+
+	DBG(TAB, ul_debugobj(tb, "index: %s", enable ? "ON" : "OFF"));
+	tb->indexed = enable ? 1 : 0;
+	if (!enable)
+		mnt_table_reset_index(tb);
+	return 0;
+}
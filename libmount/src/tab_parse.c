@@ -304,6 +304,174 @@ fail:
 	return rc;
 }
 
+/*
+ * Terminates and unmangles the field in place, @end is set to the next
+ * character after the field separator.
+ */
+static char *next_inplace_field(char *s, char **end)
+{
+	char *e = (char *) skip_nonspearator(s);
+
+	if (e == s)
+		return NULL;	/* empty string */
+
+	*end = *e ? e + 1 : e;
+	*e = '\0';
+	unmangle_string(s);
+	return s;
+}
+
+/*
+ * The same as mnt_parse_mountinfo_line(), but the line is modified and the
+ * fields are not copied -- the strings in @fs point to the @s. The merged
+ * options string is written to @tail (see parse_mountinfo_arena()).
+ */
+static int mnt_parse_mountinfo_line_inplace(struct libmnt_fs *fs, char *s,
+					    char **tail, size_t *tailsz)
+{
+	int rc = 0;
+	unsigned int maj, min;
+	char *p, *e, c;
+	size_t sz;
+
+	fs->flags |= MNT_FS_KERNEL;
+
+	/* (1) id */
+	s = (char *) next_s32(s, &fs->id, &rc);
+	if (!s || !*s || rc) {
+		DBG(TAB, ul_debug("tab parse error: [id]"));
+		goto fail;
+	}
+
+	s = (char *) skip_separator(s);
+
+	/* (2) parent */
+	s = (char *) next_s32(s, &fs->parent, &rc);
+	if (!s || !*s || rc) {
+		DBG(TAB, ul_debug("tab parse error: [parent]"));
+		goto fail;
+	}
+
+	s = (char *) skip_separator(s);
+
+	/* (3) maj:min */
+	if (sscanf(s, "%u:%u", &maj, &min) != 2) {
+		DBG(TAB, ul_debug("tab parse error: [maj:min]"));
+		goto fail;
+	}
+	fs->devno = makedev(maj, min);
+	s = (char *) skip_nonspearator(s);
+	s = (char *) skip_separator(s);
+
+	/* (4) mountroot */
+	fs->root = next_inplace_field(s, &s);
+	if (!fs->root) {
+		DBG(TAB, ul_debug("tab parse error: [mountroot]"));
+		goto fail;
+	}
+
+	s = (char *) skip_separator(s);
+
+	/* (5) target */
+	fs->target = next_inplace_field(s, &s);
+	if (!fs->target) {
+		DBG(TAB, ul_debug("tab parse error: [target]"));
+		goto fail;
+	}
+
+	/* remove "\040(deleted)" suffix */
+	p = (char *) endswith(fs->target, PATH_DELETED_SUFFIX);
+	if (p && *p)
+		*p = '\0';
+
+	s = (char *) skip_separator(s);
+
+	/* (6) vfs options (fs-independent) */
+	e = (char *) skip_nonspearator(s);
+	if (e == s) {
+		DBG(TAB, ul_debug("tab parse error: [VFS options]"));
+		goto fail;
+	}
+
+	/* (7) optional fields, terminated by " - " */
+	p = strstr(e, " - ");
+	if (!p) {
+		DBG(TAB, ul_debug("mountinfo parse error: separator not found"));
+		return -EINVAL;
+	}
+	*e = '\0';
+	fs->vfs_optstr = s;
+	unmangle_string(fs->vfs_optstr);
+
+	if (p > e + 1) {
+		*p = '\0';
+		fs->opt_fields = e + 1;
+	}
+
+	s = (char *) skip_separator(p + 3);
+
+	/* (8) FS type */
+	e = (char *) skip_nonspearator(s);
+	if (e == s) {
+		DBG(TAB, ul_debug("tab parse error: [fstype]"));
+		goto fail;
+	}
+	c = *e;
+	*e = '\0';
+	unmangle_string(s);
+	__mnt_fs_set_fstype_ptr(fs, s);
+
+	/* (9) source -- maybe empty string */
+	if (!c) {
+		DBG(TAB, ul_debug("tab parse error: [source]"));
+		goto fail;
+	} else if (c == ' ' && *(e + 1) == ' ') {
+		/* use the terminated fstype separator as an empty string */
+		__mnt_fs_set_source_ptr(fs, e);
+		s = e + 1;
+	} else {
+		s = (char *) skip_separator(e + 1);
+		p = next_inplace_field(s, &s);
+		if (!p || (rc = __mnt_fs_set_source_ptr(fs, p))) {
+			DBG(TAB, ul_debug("tab parse error: [regular source]"));
+			goto fail;
+		}
+	}
+
+	s = (char *) skip_separator(s);
+
+	/* (10) fs options (fs specific) */
+	fs->fs_optstr = next_inplace_field(s, &s);
+	if (!fs->fs_optstr) {
+		DBG(TAB, ul_debug("tab parse error: [FS options]"));
+		goto fail;
+	}
+
+	/* merge VFS and FS options to one string */
+	sz = strlen(fs->vfs_optstr) + strlen(fs->fs_optstr) + 5;
+	if (sz <= *tailsz &&
+	    mnt_merge_optstr_to_buffer(fs->vfs_optstr, fs->fs_optstr, *tail, sz) == 0) {
+		fs->optstr = *tail;
+		sz = strlen(*tail) + 1;
+		*tail += sz;
+		*tailsz -= sz;
+	} else
+		fs->optstr = mnt_fs_strdup_options(fs);
+
+	if (!fs->optstr) {
+		rc = -ENOMEM;
+		DBG(TAB, ul_debug("tab parse error: [merge VFS and FS options]"));
+		goto fail;
+	}
+
+	return 0;
+fail:
+	if (rc == 0)
+		rc = -EINVAL;
+	DBG(TAB, ul_debug("tab parse error on: '%s' [rc=%d]", s, rc));
+	return rc;
+}
+
 /*
  * Parses one line from utab file
  */
@@ -696,29 +864,192 @@ static int kernel_fs_postparse(struct libmnt_table *tb,
 	return rc;
 }
 
-/**
- * mnt_table_parse_stream:
- * @tb: tab pointer
- * @f: file stream
- * @filename: filename used for debug and error messages
+/*
+ * Parses one /proc/#/mountinfo line to @fs, the @fs is not added to @tb.
+ * The @tid has to be initialized to -1 before the first call.
  *
- * Returns: 0 on success, negative number in case of error.
+ * This is used to re-parse only modified lines, see monitor.c.
  */
-int mnt_table_parse_stream(struct libmnt_table *tb, FILE *f, const char *filename)
+int mnt_table_parse_mountinfo_line(struct libmnt_table *tb, struct libmnt_fs *fs,
+				   const char *line, pid_t *tid, const char *filename)
+{
+	int rc;
+
+	assert(tb);
+	assert(fs);
+	assert(line);
+
+	rc = mnt_parse_mountinfo_line(fs, line);
+	if (rc == 0)
+		rc = kernel_fs_postparse(tb, fs, tid, filename);
+	return rc;
+}
+
+/*
+ * Parses mountinfo from @buf, the @buf is used as the arena for all the
+ * entries and it's deallocated when the last entry is deallocated.
+ */
+static int parse_mountinfo_arena(struct libmnt_table *tb, char *buf, size_t len,
+				 const char *filename)
+{
+	struct libmnt_arena *ar;
+	char *p, *end, *tail, *x;
+	size_t nlines = 1, tailsz, lineno = 0;
+	pid_t tid = -1;
+	int rc = 0;
+
+	for (p = buf; (p = memchr(p, '\n', len - (p - buf))); p++)
+		nlines++;
+
+	/* the merged options string is never longer than the line + 5 bytes */
+	tailsz = len + nlines * 5;
+	x = realloc(buf, len + 1 + tailsz);
+	if (!x) {
+		free(buf);
+		return -ENOMEM;
+	}
+	buf = x;
+	buf[len] = '\0';
+
+	ar = mnt_new_arena(buf, len + 1 + tailsz, nlines);
+	if (!ar) {
+		free(buf);
+		return -ENOMEM;
+	}
+	tail = buf + len + 1;
+	end = buf + len;
+
+	for (p = buf; p < end; ) {
+		struct libmnt_fs *fs;
+		char *s, *next;
+
+		lineno++;
+		s = memchr(p, '\n', end - p);
+		next = s ? s + 1 : end;
+		if (!s)
+			s = end;
+		*s = '\0';
+		if (s > p && *(s - 1) == '\r')
+			*(--s) = '\0';
+
+		s = (char *) skip_blank(p);
+		p = next;
+		if (*s == '\0' || *s == '#')
+			continue;
+
+		fs = mnt_arena_new_fs(ar);
+		if (!fs) {
+			rc = -ENOMEM;
+			goto err;
+		}
+
+		/* parse */
+		rc = mnt_parse_mountinfo_line_inplace(fs, s, &tail, &tailsz);
+		if (rc != 0) {
+			DBG(TAB, ul_debugobj(tb, "%s:%zu: mountinfo parse error",
+						filename, lineno));
+			rc = tb->errcb ? tb->errcb(tb, filename, lineno) : 1;
+		}
+
+		if (rc == 0 && tb->fltrcb && tb->fltrcb(fs, tb->fltrcb_data))
+			rc = 1;	/* filtered out by callback... */
+
+		/* add to the table */
+		if (rc == 0) {
+			rc = mnt_table_add_fs(tb, fs);
+			if (rc == 0) {
+				rc = kernel_fs_postparse(tb, fs, &tid, filename);
+				if (rc)
+					mnt_table_remove_fs(tb, fs);
+			}
+		}
+
+		/* remove reference (or deallocate on error) */
+		mnt_unref_fs(fs);
+
+		/* recoverable error */
+		if (rc > 0) {
+			DBG(TAB, ul_debugobj(tb, "recoverable error (continue)"));
+			continue;
+		}
+
+		/* fatal errors */
+		if (rc < 0 && p < end) {
+			DBG(TAB, ul_debugobj(tb, "fatal error"));
+			goto err;
+		}
+	}
+
+	rc = 0;
+err:
+	mnt_unref_arena(ar);
+	return rc;
+}
+
+/* Reads the whole stream to the new buffer */
+static int read_stream(FILE *f, char **buf, size_t *len)
+{
+	size_t sz = 0, bufsz = 0;
+	char *b = NULL;
+
+	do {
+		size_t n;
+
+		if (bufsz - sz < BUFSIZ) {
+			char *x;
+
+			bufsz = bufsz ? bufsz * 2 : BUFSIZ * 8;
+			x = realloc(b, bufsz);
+			if (!x) {
+				free(b);
+				return -ENOMEM;
+			}
+			b = x;
+		}
+		n = fread(b + sz, 1, bufsz - sz, f);
+		sz += n;
+	} while (!feof(f) && !ferror(f));
+
+	if (ferror(f)) {
+		free(b);
+		return errno ? -errno : -EIO;
+	}
+	*buf = b;
+	*len = sz;
+	return 0;
+}
+
+/* returns format of the first entry in the buffer */
+static int guess_buffer_format(const char *buf, size_t len)
+{
+	const char *p = buf, *end = buf + len;
+
+	while (p < end) {
+		const char *s = p, *e = memchr(p, '\n', end - p);
+		char line[64];
+		size_t sz;
+
+		p = e ? e + 1 : end;
+		while (s < p && (*s == ' ' || *s == '\t'))
+			s++;
+		if (s == p || *s == '\n' || *s == '\r' || *s == '#')
+			continue;
+
+		sz = min((size_t) (p - s), sizeof(line) - 1);
+		memcpy(line, s, sz);
+		line[sz] = '\0';
+		return guess_table_format(line);
+	}
+	return MNT_FMT_GUESS;
+}
+
+static int parse_stream_lines(struct libmnt_table *tb, FILE *f, const char *filename)
 {
 	int rc = -1;
 	int flags = 0;
 	pid_t tid = -1;
 	struct libmnt_parser pa = { .line = 0 };
 
-	assert(tb);
-	assert(f);
-	assert(filename);
-
-	DBG(TAB, ul_debugobj(tb, "%s: start parsing [entries=%d, filter=%s]",
-				filename, mnt_table_get_nents(tb),
-				tb->fltrcb ? "yes" : "not"));
-
 	pa.filename = filename;
 	pa.f = f;
 
@@ -785,6 +1116,71 @@ err:
 	return rc;
 }
 
+/*
+ * Mountinfo is read to one buffer and parsed in place, other formats (if
+ * guessed) are parsed from the buffer by the line-by-line parser.
+ */
+static int parse_stream_buffer(struct libmnt_table *tb, FILE *f, const char *filename)
+{
+	char *buf = NULL;
+	size_t len = 0;
+	int fmt, rc;
+	FILE *m;
+
+	rc = read_stream(f, &buf, &len);
+	if (rc)
+		return rc;
+
+	fmt = tb->fmt == MNT_FMT_GUESS ? guess_buffer_format(buf, len) : tb->fmt;
+	if (fmt == MNT_FMT_MOUNTINFO) {
+		tb->fmt = fmt;
+		rc = parse_mountinfo_arena(tb, buf, len, filename);
+
+		DBG(TAB, ul_debugobj(tb, "%s: stop parsing (%d entries, rc=%d)",
+				filename, mnt_table_get_nents(tb), rc));
+		return rc;
+	}
+	if (!len) {
+		free(buf);
+		return 0;
+	}
+
+	m = fmemopen(buf, len, "r");
+	if (!m) {
+		rc = -errno;
+		free(buf);
+		return rc;
+	}
+	rc = parse_stream_lines(tb, m, filename);
+	fclose(m);
+	free(buf);
+	return rc;
+}
+
+/**
+ * mnt_table_parse_stream:
+ * @tb: tab pointer
+ * @f: file stream
+ * @filename: filename used for debug and error messages
+ *
+ * Returns: 0 on success, negative number in case of error.
+ */
+int mnt_table_parse_stream(struct libmnt_table *tb, FILE *f, const char *filename)
+{
+	assert(tb);
+	assert(f);
+	assert(filename);
+
+	DBG(TAB, ul_debugobj(tb, "%s: start parsing [entries=%d, filter=%s]",
+				filename, mnt_table_get_nents(tb),
+				tb->fltrcb ? "yes" : "not"));
+
+	if (tb->fmt == MNT_FMT_MOUNTINFO || tb->fmt == MNT_FMT_GUESS)
+		return parse_stream_buffer(tb, f, filename);
+
+	return parse_stream_lines(tb, f, filename);
+}
+
 /**
  * mnt_table_parse_file:
  * @tb: tab pointer
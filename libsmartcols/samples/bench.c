@@ -0,0 +1,157 @@
+/*
+ * This file may be redistributed under the terms of the
+ * GNU Lesser General Public License.
+ *
+ * Measures time to create, fill, print and destroy a large table, for
+ * example:
+ *
+ *	sample-scols-bench --lines 1000000
+ *	sample-scols-bench --lines 1000000 --arena
+ *	sample-scols-bench --lines 1000000 --print --jobs 4 > /dev/null
+ */
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "c.h"
+#include "nls.h"
+#include "strutils.h"
+
+#include "libsmartcols.h"
+
+static double time_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1E9;
+}
+
+static long maxrss_kb(void)
+{
+	struct rusage ru;
+
+	if (getrusage(RUSAGE_SELF, &ru) != 0)
+		return -1;
+	return ru.ru_maxrss;
+}
+
+static void __attribute__((__noreturn__)) usage(void)
+{
+	FILE *out = stdout;
+	fprintf(out,
+		"\n %s [options]\n\n", program_invocation_short_name);
+
+	fputs(" -a, --arena                    allocate lines from the table memory pool\n", out);
+	fputs(" -c, --columns <num>            number of columns (default 10)\n", out);
+	fputs(" -j, --jobs <num>               number of threads to count widths\n", out);
+	fputs(" -l, --lines <num>              number of lines (default 1000000)\n", out);
+	fputs(" -p, --print                    print the table to stdout\n", out);
+	fputs(" -r, --raw                      use raw output format\n", out);
+	fputs(" -h, --help                     this help\n", out);
+	fputs("\n", out);
+
+	exit(EXIT_SUCCESS);
+}
+
+int main(int argc, char *argv[])
+{
+	struct libscols_table *tb;
+	size_t i, j, nlines = 1000000, ncols = 10;
+	int c, arena = 0, print = 0, raw = 0;
+	unsigned int njobs = 1;
+	double start, filled, printed, freed;
+	char buf[64];
+
+	static const struct option longopts[] = {
+		{ "arena",   0, NULL, 'a' },
+		{ "columns", 1, NULL, 'c' },
+		{ "jobs",    1, NULL, 'j' },
+		{ "lines",   1, NULL, 'l' },
+		{ "print",   0, NULL, 'p' },
+		{ "raw",     0, NULL, 'r' },
+		{ "help",    0, NULL, 'h' },
+		{ NULL, 0, NULL, 0 },
+	};
+
+	setlocale(LC_ALL, "");	/* just to have enable UTF8 chars */
+	scols_init_debug(0);
+
+	while((c = getopt_long(argc, argv, "ac:hj:l:pr", longopts, NULL)) != -1) {
+		switch(c) {
+		case 'a':
+			arena = 1;
+			break;
+		case 'c':
+			ncols = strtou32_or_err(optarg, "failed to parse number of columns");
+			break;
+		case 'j':
+			njobs = strtou32_or_err(optarg, "failed to parse number of jobs");
+			break;
+		case 'l':
+			nlines = strtou32_or_err(optarg, "failed to parse number of lines");
+			break;
+		case 'p':
+			print = 1;
+			break;
+		case 'r':
+			raw = 1;
+			break;
+		case 'h':
+			usage();
+			break;
+		default:
+			errtryhelp(EXIT_FAILURE);
+		}
+	}
+
+	start = time_now();
+
+	tb = scols_new_table();
+	if (!tb)
+		err(EXIT_FAILURE, "failed to create output table");
+	scols_table_enable_raw(tb, raw);
+	scols_table_enable_arena(tb, arena);
+	scols_table_set_jobs(tb, njobs);
+
+	for (j = 0; j < ncols; j++) {
+		snprintf(buf, sizeof(buf), "COL%zu", j);
+		if (!scols_table_new_column(tb, buf, 0, 0))
+			err(EXIT_FAILURE, "failed to create output column");
+	}
+
+	for (i = 0; i < nlines; i++) {
+		struct libscols_line *ln = scols_table_new_line(tb, NULL);
+
+		if (!ln)
+			err(EXIT_FAILURE, "failed to create output line");
+		for (j = 0; j < ncols; j++) {
+			snprintf(buf, sizeof(buf), "data-%zu-%zu", i, j);
+			if (scols_line_set_data(ln, j, buf))
+				err(EXIT_FAILURE, "failed to set line data");
+		}
+	}
+	filled = time_now();
+
+	if (print)
+		scols_print_table(tb);
+	printed = time_now();
+
+	fprintf(stderr, "lines: %zu, columns: %zu, arena: %s, jobs: %u, maxrss: %ld KiB\n",
+			nlines, ncols, arena ? "yes" : "no", njobs, maxrss_kb());
+
+	scols_unref_table(tb);
+	freed = time_now();
+
+	fprintf(stderr, "fill:  %.3f s\n", filled - start);
+	if (print)
+		fprintf(stderr, "print: %.3f s\n", printed - filled);
+	fprintf(stderr, "free:  %.3f s\n", freed - printed);
+	fprintf(stderr, "total: %.3f s\n", freed - start);
+
+	return EXIT_SUCCESS;
+}
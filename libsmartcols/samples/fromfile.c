@@ -215,6 +215,9 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(" -w, --width <num>              hardcode terminal width\n", out);
 	fputs(" -p, --tree-parent-column <n>   parent column\n", out);
 	fputs(" -i, --tree-id-column <n>       id column\n", out);
+	fputs(" -S, --stream <num>             streaming output, <num> lines to calculate widths\n", out);
+	fputs(" -A, --arena                    allocate lines from the table memory pool\n", out);
+	fputs(" -j, --jobs <num>               number of threads to count widths\n", out);
 	fputs(" -h, --help                     this help\n", out);
 	fputs("\n", out);
 
@@ -226,6 +229,7 @@ int main(int argc, char *argv[])
 	struct libscols_table *tb;
 	int c, n, nlines = 0;
 	int parent_col = -1, id_col = -1;
+	int stream = -1;
 
 	static const struct option longopts[] = {
 		{ "maxout", 0, NULL, 'm' },
@@ -239,6 +243,9 @@ int main(int argc, char *argv[])
 		{ "raw",    0, NULL, 'r' },
 		{ "export", 0, NULL, 'E' },
 		{ "colsep",  1, NULL, 'C' },
+		{ "stream", 1, NULL, 'S' },
+		{ "arena",  0, NULL, 'A' },
+		{ "jobs",   1, NULL, 'j' },
 		{ "help",   0, NULL, 'h' },
 		{ NULL, 0, NULL, 0 },
 	};
@@ -257,7 +264,7 @@ int main(int argc, char *argv[])
 	if (!tb)
 		err(EXIT_FAILURE, "failed to create output table");
 
-	while((c = getopt_long(argc, argv, "hCc:Ei:JMmn:p:rw:", longopts, NULL)) != -1) {
+	while((c = getopt_long(argc, argv, "AhCc:Ei:j:JMmn:p:rS:w:", longopts, NULL)) != -1) {
 
 		err_exclusive_options(c, longopts, excl, excl_st);
 
@@ -304,6 +311,15 @@ int main(int argc, char *argv[])
 		case 'n':
 			nlines = strtou32_or_err(optarg, "failed to parse number of lines");
 			break;
+		case 'A':
+			scols_table_enable_arena(tb, 1);
+			break;
+		case 'j':
+			scols_table_set_jobs(tb, strtou32_or_err(optarg, "failed to parse number of jobs"));
+			break;
+		case 'S':
+			stream = strtou32_or_err(optarg, "failed to parse number of lines");
+			break;
 		case 'w':
 			scols_table_set_termforce(tb, SCOLS_TERMFORCE_ALWAYS);
 			scols_table_set_termwidth(tb, strtou32_or_err(optarg, "failed to parse terminal width"));
@@ -319,8 +335,16 @@ int main(int argc, char *argv[])
 		errx(EXIT_FAILURE, "--nlines not set");
 
 	for (n = 0; n < nlines; n++) {
-		struct libscols_line *ln = scols_new_line();
+		struct libscols_line *ln;
 
+		if (scols_table_is_arena(tb)) {
+			/* only lines created by the table use the arena */
+			if (!scols_table_new_line(tb, NULL))
+				err(EXIT_FAILURE, "failed to add a new line");
+			continue;
+		}
+
+		ln = scols_new_line();
 		if (!ln || scols_table_add_line(tb, ln))
 			err(EXIT_FAILURE, "failed to add a new line");
 
@@ -345,7 +369,34 @@ int main(int argc, char *argv[])
 
 	scols_table_enable_colors(tb, isatty(STDOUT_FILENO));
 
-	scols_print_table(tb);
+	if (stream >= 0) {
+		struct libscols_iter *itr = scols_new_iter(SCOLS_ITER_FORWARD);
+		size_t i, nlns = scols_table_get_nlines(tb);
+		struct libscols_line **lns = xcalloc(nlns, sizeof(*lns));
+
+		scols_table_enable_streaming(tb, 1);
+		scols_table_set_streaming_sample(tb, stream);
+
+		/* detach all lines and add them back one by one, the table
+		 * contains only the not yet printed lines as for real streaming */
+		for (i = 0; i < nlns && scols_table_next_line(tb, itr, &lns[i]) == 0; i++)
+			scols_ref_line(lns[i]);
+		scols_free_iter(itr);
+		scols_table_remove_lines(tb);
+
+		for (i = 0; i < nlns; i++) {
+			if (scols_table_add_line(tb, lns[i]) != 0)
+				err(EXIT_FAILURE, "failed to add a line");
+			scols_unref_line(lns[i]);
+
+			/* the printed lines are removed from the table */
+			if (scols_table_stream_line(tb, lns[i]) != 0)
+				err(EXIT_FAILURE, "failed to print line");
+		}
+		scols_table_stream_end(tb);
+		free(lns);
+	} else
+		scols_print_table(tb);
 	scols_unref_table(tb);
 	return EXIT_SUCCESS;
 }
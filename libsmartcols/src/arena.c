@@ -0,0 +1,105 @@
+/*
+ * arena.c - memory pool for lines, cells and cell data
+ *
+ * This file may be redistributed under the terms of the
+ * GNU Lesser General Public License.
+ *
+ *
+ * The arena is a list of large chunks, the memory is allocated from the current
+ * chunk and it is never returned to the chunk. All the chunks are deallocated
+ * by scols_free_arena() when the table is destroyed.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "smartcolsP.h"
+
+#define ARENA_CHUNK_SIZE	(64 * 1024)
+#define ARENA_ALIGN		(2 * sizeof(void *))
+
+struct arena_chunk {
+	struct arena_chunk *next;
+	size_t	size;		/* size of the data[] */
+	size_t	used;		/* allocated bytes in data[] */
+
+	char	data[] __attribute__((aligned(2 * sizeof(void *))));
+};
+
+struct libscols_arena {
+	struct arena_chunk *chunks;	/* the current chunk is the first */
+	size_t		nchunks;
+};
+
+struct libscols_arena *scols_new_arena(void)
+{
+	return calloc(1, sizeof(struct libscols_arena));
+}
+
+void scols_free_arena(struct libscols_arena *ar)
+{
+	struct arena_chunk *ch, *next;
+
+	if (!ar)
+		return;
+
+	DBG(TAB, ul_debugobj(ar, "free arena [chunks=%zu]", ar->nchunks));
+	for (ch = ar->chunks; ch; ch = next) {
+		next = ch->next;
+		free(ch);
+	}
+	free(ar);
+}
+
+static void *arena_alloc(struct libscols_arena *ar, size_t sz, size_t align)
+{
+	struct arena_chunk *ch = ar->chunks;
+	size_t off = 0;
+
+	if (ch)
+		off = (ch->used + align - 1) & ~(align - 1);
+
+	if (!ch || off + sz > ch->size) {
+		size_t chsz = sz > ARENA_CHUNK_SIZE / 4 ? sz : ARENA_CHUNK_SIZE;
+
+		/* large requests get their own chunk, the current chunk is
+		 * still used for the next small requests */
+		ch = malloc(sizeof(struct arena_chunk) + chsz);
+		if (!ch)
+			return NULL;
+		ch->size = chsz;
+		ch->used = 0;
+		off = 0;
+
+		if (chsz != ARENA_CHUNK_SIZE && ar->chunks) {
+			ch->next = ar->chunks->next;
+			ar->chunks->next = ch;
+		} else {
+			ch->next = ar->chunks;
+			ar->chunks = ch;
+		}
+		ar->nchunks++;
+	}
+
+	ch->used = off + sz;
+	return ch->data + off;
+}
+
+/* returns zeroized memory */
+void *scols_arena_alloc(struct libscols_arena *ar, size_t sz)
+{
+	void *p = arena_alloc(ar, sz, ARENA_ALIGN);
+
+	if (p)
+		memset(p, 0, sz);
+	return p;
+}
+
+char *scols_arena_strdup(struct libscols_arena *ar, const char *str)
+{
+	size_t sz = strlen(str) + 1;
+	char *p = arena_alloc(ar, sz, 1);
+
+	if (p)
+		memcpy(p, str, sz);
+	return p;
+}
@@ -1,3 +1,5 @@
+#include <pthread.h>
+
 #include "smartcolsP.h"
 #include "mbsalign.h"
 
@@ -41,6 +43,14 @@ static int count_cell_width(struct libscols_table *tb,
 	char *data;
 	int rc;
 
+	if (!scols_column_is_tree(cl) && !scols_column_is_customwrap(cl)) {
+		/* the width depends on the cell data only */
+		struct libscols_cell *ce = scols_line_get_cell(ln, cl->seqnum);
+
+		len = ce ? scols_cell_get_width(ce, scols_table_is_noencoding(tb)) : 0;
+		goto count;
+	}
+
 	rc = __cell_to_buffer(tb, ln, cl, buf);
 	if (rc)
 		return rc;
@@ -57,6 +67,7 @@ static int count_cell_width(struct libscols_table *tb,
 
 	if (len == (size_t) -1)		/* ignore broken multibyte strings */
 		len = 0;
+count:
 	cl->width_max = max(len, cl->width_max);
 
 	if (cl->is_extreme && cl->width_avg && len > cl->width_avg * 2)
@@ -83,6 +94,96 @@ static int walk_count_cell_width(struct libscols_table *tb,
 	return count_cell_width(tb, ln, cl, (struct ul_buffer *) data);
 }
 
+struct width_pool {
+	struct libscols_table	*tb;
+	struct libscols_column	**cols;		/* columns to count */
+	size_t			ncols;
+	size_t			next;		/* next column for a thread */
+	pthread_mutex_t		lock;
+};
+
+static void *width_thread(void *data)
+{
+	struct width_pool *pool = (struct width_pool *) data;
+	int noenc = scols_table_is_noencoding(pool->tb);
+
+	for (;;) {
+		struct libscols_column *cl;
+		struct libscols_iter itr;
+		struct libscols_line *ln;
+		size_t i;
+
+		pthread_mutex_lock(&pool->lock);
+		i = pool->next++;
+		pthread_mutex_unlock(&pool->lock);
+
+		if (i >= pool->ncols)
+			break;
+		cl = pool->cols[i];
+
+		scols_reset_iter(&itr, SCOLS_ITER_FORWARD);
+		while (scols_table_next_line(pool->tb, &itr, &ln) == 0) {
+			struct libscols_cell *ce = scols_line_get_cell(ln, cl->seqnum);
+
+			if (ce)
+				scols_cell_get_width(ce, noenc);
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Counts the widths of the cells by tb->njobs threads (every thread
+ * counts whole columns). The widths are cached in the cells, so
+ * count_column_width() does not count them again. Only the columns where
+ * the width depends on the cell data are counted.
+ */
+static void cache_cells_width(struct libscols_table *tb)
+{
+	struct width_pool pool = { .tb = tb };
+	struct libscols_column *cl;
+	struct libscols_iter itr;
+	pthread_t *threads;
+	size_t i, nthreads = 0;
+
+	if (tb->njobs <= 1 || tb->ncols < 2 || !tb->nlines)
+		return;
+
+	threads = calloc(tb->njobs, sizeof(pthread_t));
+	pool.cols = calloc(tb->ncols, sizeof(struct libscols_column *));
+	if (!threads || !pool.cols)
+		goto done;
+
+	scols_reset_iter(&itr, SCOLS_ITER_FORWARD);
+	while (scols_table_next_column(tb, &itr, &cl) == 0) {
+		if (scols_column_is_hidden(cl)
+		    || scols_column_is_tree(cl)
+		    || scols_column_is_customwrap(cl))
+			continue;
+		pool.cols[pool.ncols++] = cl;
+	}
+	if (pool.ncols < 2)
+		goto done;
+
+	pthread_mutex_init(&pool.lock, NULL);
+
+	for (i = 0; i < tb->njobs && i < pool.ncols; i++) {
+		if (pthread_create(&threads[nthreads], NULL, width_thread, &pool) != 0)
+			break;
+		nthreads++;
+	}
+
+	DBG(TAB, ul_debugobj(tb, "counting %zu columns by %zu threads", pool.ncols, nthreads));
+
+	for (i = 0; i < nthreads; i++)
+		pthread_join(threads[i], NULL);
+
+	pthread_mutex_destroy(&pool.lock);
+done:
+	free(threads);
+	free(pool.cols);
+}
+
 /*
  * This function counts column width.
  *
@@ -203,6 +304,8 @@ int __scols_calculate(struct libscols_table *tb, struct ul_buffer *buf)
 	if (has_groups(tb))
 		group_ncolumns = 1;
 
+	cache_cells_width(tb);
+
 	/* set basic columns width
 	 */
 	scols_reset_iter(&itr, SCOLS_ITER_FORWARD);
@@ -25,6 +25,7 @@
 #include <ctype.h>
 
 #include "smartcolsP.h"
+#include "mbsalign.h"
 
 /*
  * The cell has no ref-counting, free() and new() functions. All is
@@ -45,7 +46,8 @@ int scols_reset_cell(struct libscols_cell *ce)
 		return -EINVAL;
 
 	/*DBG(CELL, ul_debugobj(ce, "reset"));*/
-	free(ce->data);
+	if (!ce->data_in_arena)
+		free(ce->data);
 	free(ce->color);
 	memset(ce, 0, sizeof(*ce));
 	return 0;
@@ -62,9 +64,76 @@ int scols_reset_cell(struct libscols_cell *ce)
  */
 int scols_cell_set_data(struct libscols_cell *ce, const char *data)
 {
+	if (ce && ce->data_in_arena) {
+		ce->data = NULL;
+		ce->data_in_arena = 0;
+	}
+	if (ce)
+		ce->width_cached = 0;
 	return strdup_to_struct_member(ce, data, data);
 }
 
+/* Private API, the same as scols_cell_set_data(), but the copy of @data is
+ * allocated from @ar */
+int scols_cell_set_arena_data(struct libscols_cell *ce,
+			      struct libscols_arena *ar, const char *data)
+{
+	char *p = NULL;
+
+	if (!ce || !ar)
+		return -EINVAL;
+	if (data) {
+		p = scols_arena_strdup(ar, data);
+		if (!p)
+			return -ENOMEM;
+	}
+	if (!ce->data_in_arena)
+		free(ce->data);
+	ce->data = p;
+	ce->data_in_arena = 1;
+	ce->width_cached = 0;
+	return 0;
+}
+
+/*
+ * Private API, returns the number of terminal cells used by the cell data
+ * (see mbs_width() and mbs_safe_width()). The width is cached in the cell
+ * until the data are modified.
+ */
+size_t scols_cell_get_width(struct libscols_cell *ce, int noencoding)
+{
+	const unsigned char *p;
+	size_t len;
+
+	noencoding = noencoding ? 1 : 0;
+	if (ce->width_cached && ce->width_noenc == noencoding)
+		return ce->width;
+
+	p = (const unsigned char *) ce->data;
+	if (!p)
+		len = 0;
+	else {
+		/* printable ASCII is one cell per byte, the backslash is
+		 * encoded if followed by 'x' (see mbs_safe_encode()) */
+		while (*p >= 0x20 && *p < 0x7f && *p != '\\')
+			p++;
+		if (!*p)
+			len = p - (const unsigned char *) ce->data;
+		else
+			len = noencoding ? mbs_width(ce->data) :
+					   mbs_safe_width(ce->data);
+		if (len == (size_t) -1)		/* ignore broken multibyte strings */
+			len = 0;
+	}
+
+	if (len < (1U << 29)) {
+		ce->width = len;
+		ce->width_noenc = noencoding;
+		ce->width_cached = 1;
+	}
+	return len;
+}
+
 /**
  * scols_cell_refer_data:
  * @ce: a pointer to a struct libscols_cell instance
@@ -81,8 +150,11 @@ int scols_cell_refer_data(struct libscols_cell *ce, char *data)
 {
 	if (!ce)
 		return -EINVAL;
-	free(ce->data);
+	if (!ce->data_in_arena)
+		free(ce->data);
 	ce->data = data;
+	ce->data_in_arena = 0;
+	ce->width_cached = 0;
 	return 0;
 }
 
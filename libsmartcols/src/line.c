@@ -34,6 +34,15 @@
  *
  * Returns: a pointer to a new struct libscols_line instance.
  */
+static void init_line(struct libscols_line *ln)
+{
+	ln->refcount = 1;
+	INIT_LIST_HEAD(&ln->ln_lines);
+	INIT_LIST_HEAD(&ln->ln_children);
+	INIT_LIST_HEAD(&ln->ln_branch);
+	INIT_LIST_HEAD(&ln->ln_groups);
+}
+
 struct libscols_line *scols_new_line(void)
 {
 	struct libscols_line *ln;
@@ -43,11 +52,22 @@ struct libscols_line *scols_new_line(void)
 		return NULL;
 
 	DBG(LINE, ul_debugobj(ln, "alloc"));
-	ln->refcount = 1;
-	INIT_LIST_HEAD(&ln->ln_lines);
-	INIT_LIST_HEAD(&ln->ln_children);
-	INIT_LIST_HEAD(&ln->ln_branch);
-	INIT_LIST_HEAD(&ln->ln_groups);
+	init_line(ln);
+	return ln;
+}
+
+/* Private API, the line, cells and cell data are allocated from @ar and
+ * deallocated together with the arena (usually by scols_unref_table()) */
+struct libscols_line *scols_new_arena_line(struct libscols_arena *ar)
+{
+	struct libscols_line *ln;
+
+	ln = scols_arena_alloc(ar, sizeof(*ln));
+	if (!ln)
+		return NULL;
+
+	init_line(ln);
+	ln->arena = ar;
 	return ln;
 }
 
@@ -80,7 +100,8 @@ void scols_unref_line(struct libscols_line *ln)
 		scols_unref_group(ln->group);
 		scols_line_free_cells(ln);
 		free(ln->color);
-		free(ln);
+		if (!ln->arena)
+			free(ln);
 		return;
 	}
 }
@@ -103,7 +124,8 @@ void scols_line_free_cells(struct libscols_line *ln)
 	for (i = 0; i < ln->ncells; i++)
 		scols_reset_cell(&ln->cells[i]);
 
-	free(ln->cells);
+	if (!ln->arena)
+		free(ln->cells);
 	ln->ncells = 0;
 	ln->cells = NULL;
 }
@@ -136,9 +158,22 @@ int scols_line_alloc_cells(struct libscols_line *ln, size_t n)
 
 	DBG(LINE, ul_debugobj(ln, "alloc %zu cells", n));
 
-	ce = realloc(ln->cells, n * sizeof(struct libscols_cell));
-	if (!ce)
-		return -errno;
+	if (ln->arena) {
+		/* the old array stays in the arena */
+		if (n < ln->ncells) {
+			ln->ncells = n;
+			return 0;
+		}
+		ce = scols_arena_alloc(ln->arena, n * sizeof(struct libscols_cell));
+		if (!ce)
+			return -ENOMEM;
+		if (ln->ncells)
+			memcpy(ce, ln->cells, ln->ncells * sizeof(struct libscols_cell));
+	} else {
+		ce = realloc(ln->cells, n * sizeof(struct libscols_cell));
+		if (!ce)
+			return -errno;
+	}
 
 	if (n > ln->ncells)
 		memset(ce + ln->ncells, 0,
@@ -442,6 +477,8 @@ int scols_line_set_data(struct libscols_line *ln, size_t n, const char *data)
 
 	if (!ce)
 		return -EINVAL;
+	if (ln->arena)
+		return scols_cell_set_arena_data(ce, ln->arena, data);
 	return scols_cell_set_data(ce, data);
 }
 
@@ -98,6 +98,132 @@ int scols_table_print_range_to_string(
 }
 #endif
 
+static int stream_start(struct libscols_table *tb)
+{
+	int rc;
+
+	DBG(TAB, ul_debugobj(tb, "start streaming [sample=%zu]", tb->nlines));
+
+	tb->header_printed = 0;
+	tb->nstreamed = 0;
+	rc = __scols_initialize_printing(tb, &tb->stream_buf);
+	if (rc)
+		return rc;
+
+	tb->stream_started = 1;
+
+	if (scols_table_is_json(tb)) {
+		ul_jsonwrt_root_open(&tb->json);
+		ul_jsonwrt_array_open(&tb->json, tb->name ? tb->name : "");
+	}
+
+	if (tb->format == SCOLS_FMT_HUMAN)
+		__scols_print_title(tb);
+
+	return __scols_print_header(tb, &tb->stream_buf);
+}
+
+/* print and remove lines from the begin of the table up to @end */
+static int stream_lines(struct libscols_table *tb, struct libscols_line *end)
+{
+	int rc = 0;
+
+	while (rc == 0 && !list_empty(&tb->tb_lines)) {
+		struct libscols_line *ln = list_entry(tb->tb_lines.next,
+					struct libscols_line, ln_lines);
+		int last = ln == end;
+
+		rc = __scols_print_next_line(tb, &tb->stream_buf, ln,
+					     tb->nstreamed == 0);
+		tb->nstreamed++;
+		scols_table_remove_line(tb, ln);
+		if (last)
+			break;
+	}
+	return rc;
+}
+
+/**
+ * scols_table_stream_line:
+ * @tb: table
+ * @ln: complete line
+ *
+ * Prints all lines from the begin of the table up to @ln and removes them
+ * from the table. The lines are not printed if the table is not printed
+ * yet and number of lines in the table is smaller than the streaming
+ * sample, see scols_table_set_streaming_sample().
+ *
+ * The header is printed before the first line.
+ *
+ * Returns: 0, a negative value in case of an error.
+ *
+ * Since: 2.38
+ */
+int scols_table_stream_line(struct libscols_table *tb, struct libscols_line *ln)
+{
+	int rc;
+
+	if (!tb || !ln || !tb->streaming || scols_table_is_tree(tb))
+		return -EINVAL;
+	if (list_empty(&tb->tb_columns))
+		return -EINVAL;
+
+	if (!tb->stream_started) {
+		if (tb->format == SCOLS_FMT_HUMAN && tb->nlines < tb->stream_sample)
+			return 0;
+		rc = stream_start(tb);
+		if (rc)
+			return rc;
+	}
+
+	return stream_lines(tb, ln);
+}
+
+static int do_print_table(struct libscols_table *tb, int *is_empty);
+
+/**
+ * scols_table_stream_end:
+ * @tb: table
+ *
+ * Prints the rest of the lines and terminates the output in the streaming
+ * mode. The output is the same as for scols_print_table() (except the
+ * column widths, see scols_table_enable_streaming()).
+ *
+ * Returns: 0, a negative value in case of an error.
+ *
+ * Since: 2.38
+ */
+int scols_table_stream_end(struct libscols_table *tb)
+{
+	int rc = 0;
+
+	if (!tb || !tb->streaming || scols_table_is_tree(tb))
+		return -EINVAL;
+
+	DBG(TAB, ul_debugobj(tb, "end streaming"));
+
+	if (!tb->stream_started) {
+		if (list_empty(&tb->tb_lines))
+			/* nothing printed, the same as for empty table */
+			return do_print_table(tb, NULL);
+		rc = stream_start(tb);
+	}
+
+	if (!rc)
+		rc = stream_lines(tb, NULL);
+
+	if (scols_table_is_json(tb)) {
+		ul_jsonwrt_array_close(&tb->json);
+		ul_jsonwrt_root_close(&tb->json);
+	} else if (tb->nstreamed)
+		fputc('\n', tb->out);
+
+	__scols_cleanup_printing(tb, &tb->stream_buf);
+	tb->stream_started = 0;
+	tb->nstreamed = 0;
+	return rc;
+}
+
 static int do_print_table(struct libscols_table *tb, int *is_empty)
 {
 	int rc = 0;
@@ -1005,6 +1005,40 @@ int __scols_print_range(struct libscols_table *tb,
 
 }
 
+/*
+ * Prints @ln as the next line of the table (streaming). We don't know whether
+ * the line is the last one, so the line separator is printed before the line.
+ */
+int __scols_print_next_line(struct libscols_table *tb,
+			    struct ul_buffer *buf,
+			    struct libscols_line *ln,
+			    int first)
+{
+	int rc;
+
+	assert(tb);
+	assert(ln);
+
+	if (!first && !scols_table_is_json(tb)) {
+		if (tb->no_linesep == 0) {
+			fputs(linesep(tb), tb->out);
+			tb->termlines_used++;
+		}
+		if (want_repeat_header(tb))
+			__scols_print_header(tb, buf);
+	}
+
+	if (scols_table_is_json(tb))
+		ul_jsonwrt_object_open(&tb->json, NULL);
+
+	rc = print_line(tb, ln, buf);
+
+	if (scols_table_is_json(tb))
+		ul_jsonwrt_object_close(&tb->json);
+
+	return rc;
+}
+
 int __scols_print_table(struct libscols_table *tb, struct ul_buffer *buf)
 {
 	struct libscols_iter itr;
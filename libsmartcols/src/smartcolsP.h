@@ -75,6 +75,16 @@ struct libscols_symbols {
 	char	*cell_padding;
 };
 
+/*
+ * arena.c
+ */
+struct libscols_arena;
+
+struct libscols_arena *scols_new_arena(void);
+void scols_free_arena(struct libscols_arena *ar);
+void *scols_arena_alloc(struct libscols_arena *ar, size_t sz);
+char *scols_arena_strdup(struct libscols_arena *ar, const char *str);
+
 /*
  * Table cells
  */
@@ -83,8 +93,18 @@ struct libscols_cell {
 	char	*color;
 	void    *userdata;
 	int	flags;
+
+	unsigned int	width	      :29,	/* cached data width, see scols_cell_get_width() */
+			width_cached  :1,	/* @width is valid */
+			width_noenc   :1,	/* @width counted without encoding */
+			data_in_arena :1;	/* don't free() data */
 };
 
+extern size_t scols_cell_get_width(struct libscols_cell *ce, int noencoding);
+
+extern int scols_cell_set_arena_data(struct libscols_cell *ce,
+				     struct libscols_arena *ar, const char *data);
+
 extern int scols_line_move_cells(struct libscols_line *ln, size_t newn, size_t oldn);
 
 /*
@@ -180,6 +200,8 @@ struct libscols_line {
 	struct libscols_cell	*cells;		/* array with data */
 	size_t			ncells;		/* number of cells */
 
+	struct libscols_arena	*arena;		/* line, cells and data allocated by table arena */
+
 	struct list_head	ln_lines;	/* member of table->tb_lines */
 	struct list_head	ln_branch;	/* head of line->ln_children */
 	struct list_head	ln_children;	/* member of line->ln_children or group->gr_children */
@@ -237,8 +259,15 @@ struct libscols_table {
 	size_t	termlines_used;	/* printed line counter */
 	size_t	header_next;	/* where repeat header */
 
+	struct ul_buffer stream_buf;	/* printing buffer for streaming */
+	size_t	stream_sample;	/* number of lines to calculate widths (streaming) */
+	size_t	nstreamed;	/* number of already printed lines (streaming) */
+	unsigned int njobs;	/* number of threads to calculate widths */
+
 	const char *cur_color;	/* current active color when printing */
 
+	struct libscols_arena *arena;	/* memory for lines and cells, see scols_table_enable_arena() */
+
 	/* flags */
 	unsigned int	ascii		:1,	/* don't use unicode */
 			colors_wanted	:1,	/* enable colors */
@@ -254,7 +283,10 @@ struct libscols_table {
 			no_headings	:1,	/* don't print header */
 			no_encode	:1,	/* don't care about control and non-printable chars */
 			no_linesep	:1,	/* don't print line separator */
-			no_wrap		:1;	/* never wrap lines */
+			no_wrap		:1,	/* never wrap lines */
+			streaming	:1,	/* print lines as soon as possible */
+			use_arena	:1,	/* allocate new lines from arena */
+			stream_started	:1;	/* header already printed by streaming */
 };
 
 #define IS_ITER_FORWARD(_i)	((_i)->direction == SCOLS_ITER_FORWARD)
@@ -286,6 +318,7 @@ static inline int scols_iter_is_last(const struct libscols_iter *itr)
 /*
  * line.c
  */
+struct libscols_line *scols_new_arena_line(struct libscols_arena *ar);
 int scols_line_next_group_child(struct libscols_line *ln,
                           struct libscols_iter *itr,
                           struct libscols_line **chld);
@@ -345,6 +378,10 @@ int __scols_print_range(struct libscols_table *tb,
                         struct ul_buffer *buf,
                         struct libscols_iter *itr,
                         struct libscols_line *end);
+int __scols_print_next_line(struct libscols_table *tb,
+			    struct ul_buffer *buf,
+			    struct libscols_line *ln,
+			    int first);
 
 static inline int is_tree_root(struct libscols_line *ln)
 {
@@ -76,6 +76,7 @@ struct libscols_table *scols_new_table(void)
 
 	tb->refcount = 1;
 	tb->out = stdout;
+	tb->stream_sample = 1;
 
 	get_terminal_dimension(&c, &l);
 	tb->termwidth  = c > 0 ? c : 80;
@@ -127,9 +128,11 @@ void scols_unref_table(struct libscols_table *tb)
 		DBG(TAB, ul_debugobj(tb, "dealloc <-"));
 		scols_table_remove_groups(tb);
 		scols_table_remove_lines(tb);
+		scols_free_arena(tb->arena);
 		scols_table_remove_columns(tb);
 		scols_unref_symbols(tb->symbols);
 		scols_reset_cell(&tb->title);
+		ul_buffer_free_data(&tb->stream_buf);
 		free(tb->grpset);
 		free(tb->linesep);
 		free(tb->colsep);
@@ -740,7 +743,12 @@ struct libscols_line *scols_table_new_line(struct libscols_table *tb,
 	if (!tb)
 		return NULL;
 
-	ln = scols_new_line();
+	if (tb->use_arena) {
+		if (!tb->arena)
+			tb->arena = scols_new_arena();
+		ln = tb->arena ? scols_new_arena_line(tb->arena) : NULL;
+	} else
+		ln = scols_new_line();
 	if (!ln)
 		return NULL;
 
@@ -1242,6 +1250,138 @@ int scols_table_is_nowrap(const struct libscols_table *tb)
 	return tb->no_wrap;
 }
 
+/**
+ * scols_table_enable_streaming:
+ * @tb: table
+ * @enable: 1 or 0
+ *
+ * Enables streaming output. The lines are printed by scols_table_stream_line()
+ * as soon as they are complete and removed from the table, so the memory
+ * usage does not depend on number of lines. The output has to be terminated
+ * by scols_table_stream_end().
+ *
+ * The widths of the columns (only for the default human readable output) are
+ * calculated from the first lines of the table, see
+ * scols_table_set_streaming_sample(). The longer data in the next lines are
+ * truncated or wrapped according to the column flags, otherwise the columns
+ * are not aligned. The raw, export and JSON output is the same as for
+ * scols_print_table(). Trees are not supported.
+ *
+ * Returns: 0 on success, negative number in case of an error.
+ *
+ * Since: 2.38
+ */
+int scols_table_enable_streaming(struct libscols_table *tb, int enable)
+{
+	if (!tb || tb->stream_started)
+		return -EINVAL;
+	DBG(TAB, ul_debugobj(tb, "streaming: %s", enable ? "ENABLE" : "DISABLE"));
+	tb->streaming = enable ? 1 : 0;
+	return 0;
+}
+
+/**
+ * scols_table_is_streaming:
+ * @tb: a pointer to a struct libscols_table instance
+ *
+ * Returns: 1 if streaming is enabled.
+ *
+ * Since: 2.38
+ */
+int scols_table_is_streaming(const struct libscols_table *tb)
+{
+	return tb->streaming;
+}
+
+/**
+ * scols_table_enable_arena:
+ * @tb: table
+ * @enable: 1 or 0
+ *
+ * Enables allocation of the lines created by scols_table_new_line() (and
+ * their cells and the data set by scols_line_set_data()) from a memory pool
+ * owned by the table. The pool is deallocated at once by scols_unref_table(),
+ * so the table destruction is faster and the memory usage is smaller for
+ * tables with many lines.
+ *
+ * The memory is never returned to the pool before the table is destroyed,
+ * so it's not recommended for tables with many removed lines (e.g.
+ * streaming). The lines must not be used (nor referenced) after the table
+ * is destroyed. The lines created by scols_new_line() are not affected.
+ *
+ * Returns: 0 on success, negative number in case of an error.
+ *
+ * Since: 2.38
+ */
+int scols_table_enable_arena(struct libscols_table *tb, int enable)
+{
+	if (!tb)
+		return -EINVAL;
+	DBG(TAB, ul_debugobj(tb, "arena: %s", enable ? "ENABLE" : "DISABLE"));
+	tb->use_arena = enable ? 1 : 0;
+	return 0;
+}
+
+/**
+ * scols_table_is_arena:
+ * @tb: a pointer to a struct libscols_table instance
+ *
+ * Returns: 1 if new lines are allocated from the table memory pool.
+ *
+ * Since: 2.38
+ */
+int scols_table_is_arena(const struct libscols_table *tb)
+{
+	return tb->use_arena;
+}
+
+/**
+ * scols_table_set_streaming_sample:
+ * @tb: table
+ * @nlines: number of lines
+ *
+ * Sets number of lines kept in the table before the first line is printed
+ * in the streaming mode. The lines are used to calculate widths of the
+ * columns. The default is 1 (the first line only). The sample is not used
+ * for raw, export and JSON output.
+ *
+ * Returns: 0 on success, negative number in case of an error.
+ *
+ * Since: 2.38
+ */
+int scols_table_set_streaming_sample(struct libscols_table *tb, size_t nlines)
+{
+	if (!tb)
+		return -EINVAL;
+	tb->stream_sample = nlines;
+	return 0;
+}
+
+/**
+ * scols_table_set_jobs:
+ * @tb: table
+ * @njobs: number of threads
+ *
+ * Sets the number of threads used to count the widths of the cells before
+ * the table is printed. Every thread counts whole columns, so it's usable
+ * for tables with many lines and columns. The tree columns and the columns
+ * with a custom wrap function are always counted by the calling thread.
+ *
+ * The default is 1 (no threads). The output does not depend on @njobs.
+ *
+ * Returns: 0 on success, negative number in case of an error.
+ *
+ * Since: 2.38
+ */
+int scols_table_set_jobs(struct libscols_table *tb, unsigned int njobs)
+{
+	if (!tb)
+		return -EINVAL;
+	DBG(TAB, ul_debugobj(tb, "set number of jobs to %u", njobs));
+	tb->njobs = njobs;
+	return 0;
+}
+
 /**
  * scols_table_enable_noencoding:
  * @tb: table
@@ -56,6 +56,12 @@
 #ifdef HAVE_SYS_FILE_H
 #include <sys/file.h>
 #endif
+#if defined(HAVE_UUIDD) && defined(HAVE_TLS)
+#include <sys/mman.h>
+#endif
+#ifdef HAVE_TLS
+#include <pthread.h>
+#endif
 #ifdef HAVE_SYS_IOCTL_H
 #include <sys/ioctl.h>
 #endif
@@ -210,6 +216,9 @@ static int get_node_id(unsigned char *node_id)
 /* Assume that the gettimeofday() has microsecond granularity */
 #define MAX_ADJUSTMENT 10
 
+/* Number of time UUIDs reserved in the clock state file at once */
+#define UUID_TIME_BLOCK	1000
+
 /*
  * Get clock from global sequence clock counter.
  *
@@ -394,6 +403,109 @@ fail:
 	return -1;
 }
 
+#ifdef HAVE_TLS
+/* don't try to map the ring again for a few seconds if it's not available */
+#define UUIDD_LEASE_RETRY	5
+
+static const char *lease_path = UUIDD_LEASE_PATH;
+
+static struct uuidd_lease_ring *map_lease_ring(void)
+{
+	struct uuidd_lease_ring *r;
+	struct stat st;
+	int fd;
+
+	fd = open(lease_path, O_RDWR | O_CLOEXEC);
+	if (fd < 0)
+		return NULL;
+	if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(*r)) {
+		close(fd);
+		return NULL;
+	}
+	r = mmap(NULL, sizeof(*r), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (r == MAP_FAILED)
+		return NULL;
+
+	if (__atomic_load_n(&r->magic, __ATOMIC_ACQUIRE) != UUIDD_LEASE_MAGIC
+	    || r->nslots != UUIDD_LEASE_NSLOTS) {
+		munmap(r, sizeof(*r));
+		return NULL;
+	}
+	return r;
+}
+
+/*
+ * Try to take a lease of time UUIDs from the uuidd shared-memory ring (see
+ * uuidd --lease). The leases are reserved by the daemon, so the UUIDs are
+ * unique across processes.
+ *
+ * Returns 0 on success (the first UUID in @out, number of UUIDs in @num),
+ * non-zero on failure.
+ */
+static int get_uuid_via_lease(uuid_t out, int *num, time_t *created)
+{
+	static struct uuidd_lease_ring *ring;
+	static time_t failed;
+	struct uuidd_lease_ring *r, *old;
+	uint32_t busy;
+	time_t now;
+	size_t i;
+
+	now = time(NULL);
+	r = old = __atomic_load_n(&ring, __ATOMIC_ACQUIRE);
+	if (r && __atomic_load_n(&r->magic, __ATOMIC_ACQUIRE) != UUIDD_LEASE_MAGIC)
+		r = NULL;	/* daemon is gone, the old mapping is not unmapped
+				 * as it could be used by another thread */
+	if (!r) {
+		if (__atomic_load_n(&failed, __ATOMIC_RELAXED) + UUIDD_LEASE_RETRY > now)
+			return -1;
+		r = map_lease_ring();
+		if (!r) {
+			__atomic_store_n(&failed, now, __ATOMIC_RELAXED);
+			return -1;
+		}
+		if (!__atomic_compare_exchange_n(&ring, &old, r, 0,
+					__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+			/* another thread was faster, @old is the current ring */
+			munmap(r, sizeof(*r));
+			r = old;
+		}
+	}
+
+	busy = UUIDD_LEASE_BUSY_BY(getpid());
+
+	for (i = 0; i < UUIDD_LEASE_NSLOTS; i++) {
+		uint32_t n = __atomic_fetch_add(&r->head, 1, __ATOMIC_RELAXED);
+		struct uuidd_lease *l = &r->slots[n % UUIDD_LEASE_NSLOTS];
+		uint32_t state = UUIDD_LEASE_READY;
+		int ok;
+
+		if (!__atomic_compare_exchange_n(&l->state, &state, busy,
+					0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			continue;
+
+		/* expired leases are dropped, the daemon will refill the slot */
+		ok = l->num > 0 && l->created + UUIDD_LEASE_EXPIRE >= now;
+		if (ok) {
+			memcpy(out, l->uuid, sizeof(uuid_t));
+			*num = l->num;
+			*created = l->created;
+		}
+
+		/* the lease is not used if the daemon has reclaimed the slot
+		 * in the meantime (it thinks that we are dead) */
+		state = busy;
+		if (!__atomic_compare_exchange_n(&l->state, &state, UUIDD_LEASE_EMPTY,
+					0, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+			ok = 0;
+		if (ok)
+			return 0;
+	}
+	return -1;
+}
+#endif /* HAVE_TLS */
+
 #else /* !defined(HAVE_UUIDD) && defined(HAVE_SYS_UN_H) */
 static int get_uuid_via_daemon(int op __attribute__((__unused__)),
 				uuid_t out __attribute__((__unused__)),
@@ -401,6 +513,15 @@ static int get_uuid_via_daemon(int op __attribute__((__unused__)),
 {
 	return -1;
 }
+
+# ifdef HAVE_TLS
+static int get_uuid_via_lease(uuid_t out __attribute__((__unused__)),
+			      int *num __attribute__((__unused__)),
+			      time_t *created __attribute__((__unused__)))
+{
+	return -1;
+}
+# endif
 #endif
 
 int __uuid_generate_time(uuid_t out, int *num)
@@ -432,6 +553,27 @@ int __uuid_generate_time(uuid_t out, int *num)
 	return ret;
 }
 
+#ifdef HAVE_TLS
+/*
+ * The thread-local block of UUIDs is copied to the child on fork(), so the
+ * parent and the child would generate the same UUIDs from the block. The
+ * child increments the generation and the blocks of the older generation
+ * are dropped.
+ */
+static unsigned int fork_generation;
+static pthread_once_t fork_once = PTHREAD_ONCE_INIT;
+
+static void fork_child(void)
+{
+	fork_generation++;
+}
+
+static void fork_register(void)
+{
+	pthread_atfork(NULL, NULL, fork_child);
+}
+#endif
+
 /*
  * Generate time-based UUID and store it to @out
  *
@@ -443,15 +585,27 @@ int __uuid_generate_time(uuid_t out, int *num)
 static int uuid_generate_time_generic(uuid_t out) {
 #ifdef HAVE_TLS
 	THREAD_LOCAL int		num = 0;
+	THREAD_LOCAL int		ret = 0;	/* result for the whole block */
 	THREAD_LOCAL struct uuid	uu;
 	THREAD_LOCAL time_t		last_time = 0;
+	THREAD_LOCAL unsigned int	generation;
 	time_t				now;
 
 	if (num > 0) {
 		now = time(NULL);
-		if (now > last_time+1)
+		if (now > last_time+1 || generation != fork_generation)
 			num = 0;
 	}
+	if (num <= 0) {
+		pthread_once(&fork_once, fork_register);
+		generation = fork_generation;
+	}
+	if (num <= 0 && get_uuid_via_lease(out, &num, &last_time) == 0) {
+		uuid_unpack(out, &uu);
+		num--;
+		ret = 0;
+		return 0;
+	}
 	if (num <= 0) {
 		num = 1000;
 		if (get_uuid_via_daemon(UUIDD_OP_BULK_TIME_UUID,
@@ -459,27 +613,41 @@ static int uuid_generate_time_generic(uuid_t out) {
 			last_time = time(NULL);
 			uuid_unpack(out, &uu);
 			num--;
+			ret = 0;
 			return 0;
 		}
-		num = 0;
-	}
-	if (num > 0) {
-		uu.time_low++;
-		if (uu.time_low == 0) {
-			uu.time_mid++;
-			if (uu.time_mid == 0)
-				uu.time_hi_and_version++;
-		}
+
+		/*
+		 * No daemon, reserve the block of UUIDs in the clock state file
+		 * (the same way as uuidd does it for bulk requests). The file is
+		 * locked once per block and the UUIDs of the block are generated
+		 * from the thread-local state, so threads don't contend on the
+		 * lock. The blocks are disjoint for all processes which use the
+		 * state file.
+		 */
+		num = UUID_TIME_BLOCK;
+		ret = __uuid_generate_time(out, &num);
+		last_time = time(NULL);
+		uuid_unpack(out, &uu);
 		num--;
-		uuid_pack(&uu, out);
-		return 0;
+		return ret;
 	}
+
+	uu.time_low++;
+	if (uu.time_low == 0) {
+		uu.time_mid++;
+		if (uu.time_mid == 0)
+			uu.time_hi_and_version++;
+	}
+	num--;
+	uuid_pack(&uu, out);
+	return ret;
 #else
 	if (get_uuid_via_daemon(UUIDD_OP_TIME_UUID, out, 0) == 0)
 		return 0;
-#endif
 
 	return __uuid_generate_time(out, NULL);
+#endif
 }
 
 /*
@@ -499,30 +667,35 @@ int uuid_generate_time_safe(uuid_t out)
 }
 
 
+/*
+ * Reads random bytes for all the UUIDs at once and sets the version and
+ * variant bits in place. It's the same as uuid_unpack(), modify clock_seq and
+ * time_hi_and_version, and uuid_pack() for every UUID.
+ */
+static int generate_random_many(unsigned char *out, size_t n)
+{
+	size_t i;
+	int r;
+
+	r = ul_random_get_bytes(out, n * sizeof(uuid_t)) ? -1 : 0;
+
+	for (i = 0; i < n; i++, out += sizeof(uuid_t)) {
+		out[6] = (out[6] & 0x0F) | 0x40;	/* time_hi_and_version */
+		out[8] = (out[8] & 0x3F) | 0x80;	/* clock_seq */
+	}
+	return r;
+}
+
 int __uuid_generate_random(uuid_t out, int *num)
 {
-	uuid_t	buf;
-	struct uuid uu;
-	int i, n, r = 0;
+	int n;
 
 	if (!num || !*num)
 		n = 1;
 	else
 		n = *num;
 
-	for (i = 0; i < n; i++) {
-		if (ul_random_get_bytes(buf, sizeof(buf)))
-			r = -1;
-		uuid_unpack(buf, &uu);
-
-		uu.clock_seq = (uu.clock_seq & 0x3FFF) | 0x8000;
-		uu.time_hi_and_version = (uu.time_hi_and_version & 0x0FFF)
-			| 0x4000;
-		uuid_pack(&uu, out);
-		out += sizeof(uuid_t);
-	}
-
-	return r;
+	return generate_random_many(out, n);
 }
 
 void uuid_generate_random(uuid_t out)
@@ -533,6 +706,17 @@ void uuid_generate_random(uuid_t out)
 	__uuid_generate_random(out, &num);
 }
 
+/*
+ * Generates @n random-based UUIDs. The random bytes for all of them are read
+ * by one getrandom() call, which is much faster than to call
+ * uuid_generate_random() @n times.
+ */
+void uuid_generate_random_many(uuid_t out[], size_t n)
+{
+	if (n)
+		generate_random_many(out[0], n);
+}
+
 /*
  * This is the generic front-end to __uuid_generate_random and
  * uuid_generate_time.  It uses __uuid_generate_random output
@@ -597,3 +781,163 @@ void uuid_generate_sha1(uuid_t out, const uuid_t ns, const char *name, size_t le
 	uu.time_hi_and_version = (uu.time_hi_and_version & 0x0FFF) | 0x5000;
 	uuid_pack(&uu, out);
 }
+
+#ifdef TEST_PROGRAM
+#include <getopt.h>
+#include <sys/wait.h>
+
+static void print_time_uuids(size_t count)
+{
+	char str[UUID_STR_LEN];
+	uuid_t uu;
+
+	while (count--) {
+		uuid_generate_time(uu);
+		uuid_unparse(uu, str);
+		printf("%s\n", str);
+	}
+}
+
+#if defined(HAVE_UUIDD) && defined(HAVE_SYS_UN_H) && defined(HAVE_TLS)
+/* take a READY slot as a client which is killed before it releases the slot */
+static void lease_stale(void)
+{
+	struct uuidd_lease_ring *r = map_lease_ring();
+	pid_t pid;
+	size_t i;
+
+	if (!r)
+		errx(EXIT_FAILURE, "cannot map %s", lease_path);
+
+	pid = fork();
+	if (pid < 0)
+		err(EXIT_FAILURE, "fork failed");
+	if (pid == 0)
+		_exit(EXIT_SUCCESS);
+	if (waitpid(pid, NULL, 0) != pid)
+		err(EXIT_FAILURE, "waitpid failed");
+
+	for (i = 0; i < UUIDD_LEASE_NSLOTS; i++) {
+		uint32_t state = UUIDD_LEASE_READY;
+
+		if (__atomic_compare_exchange_n(&r->slots[i].state, &state,
+					UUIDD_LEASE_BUSY_BY(pid), 0,
+					__ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			return;
+	}
+	errx(EXIT_FAILURE, "no ready slot in %s", lease_path);
+}
+
+static void lease_slots(const char *name)
+{
+	struct uuidd_lease_ring *r = map_lease_ring();
+	uint32_t want;
+	size_t i, n = 0;
+
+	if (strcmp(name, "empty") == 0)
+		want = UUIDD_LEASE_EMPTY;
+	else if (strcmp(name, "ready") == 0)
+		want = UUIDD_LEASE_READY;
+	else if (strcmp(name, "busy") == 0)
+		want = UUIDD_LEASE_BUSY;
+	else
+		errx(EXIT_FAILURE, "unknown slot state: %s", name);
+
+	if (!r)
+		errx(EXIT_FAILURE, "cannot map %s", lease_path);
+
+	for (i = 0; i < UUIDD_LEASE_NSLOTS; i++) {
+		uint32_t state = __atomic_load_n(&r->slots[i].state, __ATOMIC_ACQUIRE);
+
+		if (UUIDD_LEASE_STATE(state) == want)
+			n++;
+	}
+	printf("%s slots: %zu\n", name, n);
+}
+#endif
+
+static void __attribute__((__noreturn__)) usage(void)
+{
+	FILE *out = stdout;
+
+	fprintf(out, "\n %s [options] [<count>]\n\n", program_invocation_short_name);
+	fputs(" -f, --fork            generate <count> UUIDs in the parent and child after fork\n", out);
+	fputs(" -l, --lease <path>    use the uuidd lease ring at <path>\n", out);
+	fputs(" -s, --stale           take a lease slot by a dead process\n", out);
+	fputs(" -S, --slots <state>   print number of lease slots in the state (empty, ready or busy)\n", out);
+	fputs(" -h, --help            this help\n", out);
+	exit(EXIT_SUCCESS);
+}
+
+int main(int argc, char **argv)
+{
+	size_t count = 1;
+	pid_t pid = -1;
+	int c, dofork = 0;
+#if defined(HAVE_UUIDD) && defined(HAVE_SYS_UN_H) && defined(HAVE_TLS)
+	const char *slots = NULL;
+	int stale = 0;
+#endif
+
+	static const struct option longopts[] = {
+		{ "fork",  0, NULL, 'f' },
+		{ "lease", 1, NULL, 'l' },
+		{ "stale", 0, NULL, 's' },
+		{ "slots", 1, NULL, 'S' },
+		{ "help",  0, NULL, 'h' },
+		{ NULL, 0, NULL, 0 },
+	};
+
+	while ((c = getopt_long(argc, argv, "fl:sS:h", longopts, NULL)) != -1) {
+		switch (c) {
+		case 'f':
+			dofork = 1;
+			break;
+#if defined(HAVE_UUIDD) && defined(HAVE_SYS_UN_H) && defined(HAVE_TLS)
+		case 'l':
+			lease_path = optarg;
+			break;
+		case 's':
+			stale = 1;
+			break;
+		case 'S':
+			slots = optarg;
+			break;
+#endif
+		case 'h':
+			usage();
+		default:
+			fprintf(stderr, "Try '%s --help' for more information.\n",
+					program_invocation_short_name);
+			return EXIT_FAILURE;
+		}
+	}
+	if (optind < argc)
+		count = strtoul(argv[optind], NULL, 10);
+
+#if defined(HAVE_UUIDD) && defined(HAVE_SYS_UN_H) && defined(HAVE_TLS)
+	if (stale) {
+		lease_stale();
+		return EXIT_SUCCESS;
+	}
+	if (slots) {
+		lease_slots(slots);
+		return EXIT_SUCCESS;
+	}
+#endif
+	if (dofork) {
+		/* reserve the block in the parent, the child must not use it */
+		setvbuf(stdout, NULL, _IOLBF, 0);
+		print_time_uuids(1);
+		pid = fork();
+		if (pid < 0)
+			err(EXIT_FAILURE, "fork failed");
+	}
+
+	print_time_uuids(count);
+
+	if (pid > 0 && waitpid(pid, NULL, 0) != pid)
+		err(EXIT_FAILURE, "waitpid failed");
+	return EXIT_SUCCESS;
+}
+#endif /* TEST_PROGRAM */
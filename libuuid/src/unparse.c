@@ -33,44 +33,87 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include "c.h"
 
 #include "uuidP.h"
 
-static char const hexdigits_lower[16] = "0123456789abcdef";
-static char const hexdigits_upper[16] = "0123456789ABCDEF";
+/*
+ * The tables of two hex digits for every byte value, the UUID string is
+ * composed from 16 pairs (one per byte) without any per-digit operations.
+ */
+#define HEXDIGIT(n, a)	((n) < 10 ? '0' + (n) : (a) - 10 + (n))
+#define HEXPAIR(x, a)	{ HEXDIGIT((x) >> 4, a), HEXDIGIT((x) & 15, a) }
+#define HEXPAIRS4(x, a)	HEXPAIR(x, a), HEXPAIR(x + 1, a), HEXPAIR(x + 2, a), HEXPAIR(x + 3, a)
+#define HEXPAIRS16(x, a) HEXPAIRS4(x, a), HEXPAIRS4(x + 4, a), HEXPAIRS4(x + 8, a), HEXPAIRS4(x + 12, a)
+#define HEXPAIRS64(x, a) HEXPAIRS16(x, a), HEXPAIRS16(x + 16, a), HEXPAIRS16(x + 32, a), HEXPAIRS16(x + 48, a)
+
+static char const hexpairs_lower[256][2] = {
+	HEXPAIRS64(0x00, 'a'), HEXPAIRS64(0x40, 'a'),
+	HEXPAIRS64(0x80, 'a'), HEXPAIRS64(0xc0, 'a')
+};
+
+static char const hexpairs_upper[256][2] = {
+	HEXPAIRS64(0x00, 'A'), HEXPAIRS64(0x40, 'A'),
+	HEXPAIRS64(0x80, 'A'), HEXPAIRS64(0xc0, 'A')
+};
+
+#ifdef UUID_UNPARSE_DEFAULT_UPPER
+# define hexpairs_default	hexpairs_upper
+#else
+# define hexpairs_default	hexpairs_lower
+#endif
+
+/* position of the byte in the string */
+static unsigned char const uuid_fmt_offsets[16] = {
+	0, 2, 4, 6, 9, 11, 14, 16, 19, 21, 24, 26, 28, 30, 32, 34
+};
 
-static void uuid_fmt(const uuid_t uuid, char *buf, char const *restrict fmt)
+/* writes 36 characters, without the terminating zero */
+static inline void uuid_fmt_nozero(const uuid_t uuid, char *buf,
+				   char const pairs[256][2])
 {
-	char *p = buf;
 	int i;
 
-	for (i = 0; i < 16; i++) {
-		if (i == 4 || i == 6 || i == 8 || i == 10) {
-			*p++ = '-';
-		}
-		size_t tmp = uuid[i];
-		*p++ = fmt[tmp >> 4];
-		*p++ = fmt[tmp & 15];
-	}
-	*p = '\0';
+	for (i = 0; i < 16; i++)
+		memcpy(buf + uuid_fmt_offsets[i], pairs[uuid[i]], 2);
+
+	buf[8] = buf[13] = buf[18] = buf[23] = '-';
+}
+
+static void uuid_fmt(const uuid_t uuid, char *buf, char const pairs[256][2])
+{
+	uuid_fmt_nozero(uuid, buf, pairs);
+	buf[UUID_STR_LEN - 1] = '\0';
 }
 
 void uuid_unparse_lower(const uuid_t uu, char *out)
 {
-	uuid_fmt(uu, out, hexdigits_lower);
+	uuid_fmt(uu, out, hexpairs_lower);
 }
 
 void uuid_unparse_upper(const uuid_t uu, char *out)
 {
-	uuid_fmt(uu, out, hexdigits_upper);
+	uuid_fmt(uu, out, hexpairs_upper);
 }
 
 void uuid_unparse(const uuid_t uu, char *out)
 {
-#ifdef UUID_UNPARSE_DEFAULT_UPPER
-	uuid_fmt(uu, out, hexdigits_upper);
-#else
-	uuid_fmt(uu, out, hexdigits_lower);
-#endif
+	uuid_fmt(uu, out, hexpairs_default);
+}
+
+/*
+ * Converts @n UUIDs to strings. Every string is stored in UUID_STR_LEN bytes
+ * of the @out buffer, the last byte is @sep (use '\0' to get the standard
+ * zero terminated strings, or '\n' to get text ready to write to a file).
+ */
+void uuid_unparse_many(const uuid_t uu[], size_t n, char *out, char sep)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		uuid_fmt_nozero(uu[i], out, hexpairs_default);
+		out[UUID_STR_LEN - 1] = sep;
+		out += UUID_STR_LEN;
+	}
 }
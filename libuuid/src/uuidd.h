@@ -48,6 +48,46 @@
 #define UUIDD_OP_BULK_RANDOM_UUID	5
 #define UUIDD_MAX_OP			UUIDD_OP_BULK_RANDOM_UUID
 
+/*
+ * Shared-memory ring of time UUID leases (see uuidd --lease). Every slot
+ * contains the first UUID and the number of UUIDs reserved by the daemon
+ * by __uuid_generate_time(). A client takes a READY slot by
+ * READY -> BUSY compare-and-swap, copies the lease and marks the slot
+ * EMPTY. The BUSY state contains the PID of the owner, so the daemon can
+ * reclaim slots of killed clients. The daemon refills EMPTY, expired and
+ * reclaimed slots.
+ */
+#define UUIDD_LEASE_SUFFIX	".lease"
+#define UUIDD_LEASE_PATH	UUIDD_SOCKET_PATH UUIDD_LEASE_SUFFIX
+#define UUIDD_LEASE_MAGIC	0x55554c52	/* "UULR" */
+#define UUIDD_LEASE_NSLOTS	64
+#define UUIDD_LEASE_EXPIRE	1		/* seconds */
+
+enum {
+	UUIDD_LEASE_EMPTY = 0,
+	UUIDD_LEASE_READY,
+	UUIDD_LEASE_BUSY
+};
+
+#define UUIDD_LEASE_STATE(s)		((s) & 3)
+#define UUIDD_LEASE_OWNER(s)		((pid_t) ((s) >> 2))
+#define UUIDD_LEASE_BUSY_BY(pid)	(UUIDD_LEASE_BUSY | ((uint32_t) (pid) << 2))
+
+struct uuidd_lease {
+	uint32_t	state;		/* UUIDD_LEASE_* and owner PID */
+	int32_t		num;		/* number of UUIDs */
+	int64_t		created;	/* time(NULL) when reserved */
+	unsigned char	uuid[16];	/* the first UUID */
+};
+
+struct uuidd_lease_ring {
+	uint32_t	magic;		/* zero if the daemon is gone */
+	uint32_t	nslots;
+	uint32_t	head;		/* the next slot for clients */
+	uint32_t	pad;
+	struct uuidd_lease slots[UUIDD_LEASE_NSLOTS];
+};
+
 extern int __uuid_generate_time(uuid_t out, int *num);
 extern int __uuid_generate_random(uuid_t out, int *num);
 
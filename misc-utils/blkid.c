@@ -78,6 +78,7 @@ static void __attribute__((__noreturn__)) usage(void)
 			"                              cache file (-c /dev/null means no cache)\n"), out);
 	fputs(_(	" -d, --no-encoding          don't encode non-printing characters\n"), out);
 	fputs(_(	" -g, --garbage-collect      garbage collect the blkid cache\n"), out);
+	fputs(_(	" -j, --jobs <num>           probe devices by <num> threads\n"), out);
 	fputs(_(	" -o, --output <format>      output format; can be one of:\n"
 			"                              value, device, export or full; (default: full)\n"), out);
 	fputs(_(	" -k, --list-filesystems     list all known filesystems/RAIDs and exit\n"), out);
@@ -673,7 +674,7 @@ int main(int argc, char **argv)
 	int fltr_usage = 0;
 	char **fltr_type = NULL;
 	int fltr_flag = BLKID_FLTR_ONLYIN;
-	unsigned int numdev = 0, numtag = 0;
+	unsigned int numdev = 0, numtag = 0, njobs = 0;
 	int err = BLKID_EXIT_OTHER;
 	unsigned int i;
 	int c;
@@ -683,6 +684,7 @@ int main(int argc, char **argv)
 		{ "no-encoding",      no_argument,	 NULL, 'd' },
 		{ "no-part-details",  no_argument,       NULL, 'D' },
 		{ "garbage-collect",  no_argument,	 NULL, 'g' },
+		{ "jobs",	      required_argument, NULL, 'j' },
 		{ "output",	      required_argument, NULL, 'o' },
 		{ "list-filesystems", no_argument,	 NULL, 'k' },
 		{ "match-tag",	      required_argument, NULL, 's' },
@@ -716,7 +718,7 @@ int main(int argc, char **argv)
 	strutils_set_exitcode(BLKID_EXIT_OTHER);
 
 	while ((c = getopt_long (argc, argv,
-			    "c:DdgH:hilL:n:ko:O:ps:S:t:u:U:w:Vv", longopts, NULL)) != -1) {
+			    "c:DdgH:hij:lL:n:ko:O:ps:S:t:u:U:w:Vv", longopts, NULL)) != -1) {
 
 		err_exclusive_options(c, NULL, excl, excl_st);
 
@@ -752,6 +754,9 @@ int main(int argc, char **argv)
 		case 'i':
 			ctl.lowprobe_topology = 1;
 			break;
+		case 'j':
+			njobs = strtou32_or_err(optarg, _("invalid jobs argument"));
+			break;
 		case 'l':
 			ctl.lookup = 1;
 			break;
@@ -849,6 +854,8 @@ int main(int argc, char **argv)
 
 	if (!ctl.lowprobe && !ctl.eval && blkid_get_cache(&cache, read) < 0)
 		goto exit;
+	if (cache && njobs)
+		blkid_cache_set_jobs(cache, njobs);
 
 	if (ctl.gc) {
 		blkid_gc_cache(cache);
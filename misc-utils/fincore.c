@@ -21,16 +21,20 @@
 
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 #include <getopt.h>
 #include <stdio.h>
 #include <string.h>
+#include <ftw.h>
+#include <pthread.h>		/* --jobs */
 
 #include "c.h"
 #include "nls.h"
 #include "closestream.h"
 #include "xalloc.h"
 #include "strutils.h"
+#include "buffer.h"
 
 #include "libsmartcols.h"
 
@@ -42,6 +46,42 @@
    e.g. 128MB on x86_64. ( = N_PAGES_IN_WINDOW * 4096 ). */
 #define N_PAGES_IN_WINDOW ((size_t)(32 * 1024))
 
+/* Number of files processed (and printed) at once, the files of the batch
+   are divided between threads for --jobs. */
+#define N_FILES_IN_BATCH 1024
+
+#ifndef HAVE_CACHESTAT
+
+# if !defined(SYS_cachestat) && defined(__linux__) && !defined(__alpha__)
+#  define SYS_cachestat 451
+# endif
+
+struct cachestat_range {
+	uint64_t off;
+	uint64_t len;
+};
+
+struct cachestat {
+	uint64_t nr_cache;
+	uint64_t nr_dirty;
+	uint64_t nr_writeback;
+	uint64_t nr_evicted;
+	uint64_t nr_recently_evicted;
+};
+
+static inline int cachestat(unsigned int fd,
+			    const struct cachestat_range *cstat_range,
+			    struct cachestat *cstat, unsigned int flags)
+{
+# ifdef SYS_cachestat
+	return syscall(SYS_cachestat, fd, cstat_range, cstat, flags);
+# else
+	errno = ENOSYS;
+	return -1;
+# endif
+}
+
+#endif /* HAVE_CACHESTAT */
 
 struct colinfo {
 	const char *name;
@@ -54,7 +94,8 @@ enum {
 	COL_PAGES,
 	COL_SIZE,
 	COL_FILE,
-	COL_RES
+	COL_RES,
+	COL_EXTENTS
 };
 
 static struct colinfo infos[] = {
@@ -62,23 +103,48 @@ static struct colinfo infos[] = {
 	[COL_RES]    = { "RES",      5, SCOLS_FL_RIGHT, N_("file data resident in memory in bytes")},
 	[COL_SIZE]   = { "SIZE",     5, SCOLS_FL_RIGHT, N_("size of the file")},
 	[COL_FILE]   = { "FILE",     4, 0, N_("file name")},
+	[COL_EXTENTS]= { "EXTENTS",  0.3, SCOLS_FL_WRAP, N_("ranges of resident pages")},
 };
 
 static int columns[ARRAY_SIZE(infos) * 2] = {-1};
 static size_t ncolumns;
 
+/* the result for one file */
+struct fincore_state {
+	char		*name;
+	struct stat	sb;
+	off_t		count_incore;
+
+	struct ul_buffer extents;	/* resident pages for COL_EXTENTS */
+	off_t		ext_first;	/* the first page of the unfinished range or -1 */
+	off_t		ext_last;
+
+	int		rc;		/* <0 error, 0 success, 1 ignore */
+};
+
 struct fincore_control {
 	const size_t pagesize;
 
 	struct libscols_table *tb;		/* output */
 
+	struct fincore_state *batch;		/* files to process */
+	size_t nfiles;
+	unsigned char *vec;			/* mincore() vector for serial processing */
+
+	unsigned int njobs;			/* number of threads */
+	int rc;					/* exit code */
+
 	unsigned int bytes : 1,
 		     noheadings : 1,
 		     raw : 1,
-		     json : 1;
+		     json : 1,
+		     recursive : 1,
+		     extents : 1,		/* COL_EXTENTS required */
+		     cachestat : 1;		/* cachestat() is available */
 };
 
 
+
 static int column_name_to_id(const char *name, size_t namesz)
 {
 	size_t i;
@@ -107,13 +173,14 @@ static const struct colinfo *get_column_info(int num)
 }
 
 static int add_output_data(struct fincore_control *ctl,
-			   const char *name,
-			   off_t file_size,
-			   off_t count_incore)
+			   struct fincore_state *st)
 {
 	size_t i;
 	char *tmp;
 	struct libscols_line *ln;
+	const char *name = st->name;
+	off_t file_size = st->sb.st_size;
+	off_t count_incore = st->count_incore;
 
 	assert(ctl);
 	assert(ctl->tb);
@@ -151,6 +218,10 @@ static int add_output_data(struct fincore_control *ctl,
 				tmp = size_to_human_string(SIZE_SUFFIX_1LETTER, file_size);
 			rc = scols_line_refer_data(ln, i, tmp);
 			break;
+		case COL_EXTENTS:
+			tmp = ul_buffer_get_data(&st->extents, NULL, NULL);
+			rc = scols_line_set_data(ln, i, tmp ? tmp : "");
+			break;
 		default:
 			return -EINVAL;
 		}
@@ -159,44 +230,135 @@ static int add_output_data(struct fincore_control *ctl,
 			err(EXIT_FAILURE, _("failed to add output data"));
 	}
 
+	if (scols_table_is_streaming(ctl->tb)
+	    && scols_table_stream_line(ctl->tb, ln) != 0)
+		err(EXIT_FAILURE, _("failed to print output line"));
 	return 0;
 }
 
+/*
+ * Returns number of resident pages in the mincore() vector. Only the least
+ * significant bit of every byte is defined, so the vector is read by words
+ * and the bits are counted by popcount.
+ */
+static off_t count_resident(const unsigned char *vec, size_t n)
+{
+	const uint64_t mask = 0x0101010101010101ULL;
+	off_t count = 0;
+	size_t i;
+
+	for (i = 0; i + sizeof(uint64_t) <= n; i += sizeof(uint64_t)) {
+		uint64_t w;
+
+		memcpy(&w, vec + i, sizeof(w));
+		count += __builtin_popcountll(w & mask);
+	}
+	for (; i < n; i++)
+		count += vec[i] & 0x1;
+
+	return count;
+}
+
+static void flush_extent(struct fincore_state *st)
+{
+	char buf[64];
+
+	if (st->ext_first < 0)
+		return;
+
+	if (st->ext_first == st->ext_last)
+		snprintf(buf, sizeof(buf), "%s%jd",
+				ul_buffer_is_empty(&st->extents) ? "" : ",",
+				(intmax_t) st->ext_first);
+	else
+		snprintf(buf, sizeof(buf), "%s%jd-%jd",
+				ul_buffer_is_empty(&st->extents) ? "" : ",",
+				(intmax_t) st->ext_first, (intmax_t) st->ext_last);
+
+	if (ul_buffer_append_string(&st->extents, buf))
+		err(EXIT_FAILURE, _("failed to allocate output data"));
+	st->ext_first = -1;
+}
+
+/* adds ranges of resident pages, @page is the first page of the window */
+static void add_extents(struct fincore_state *st,
+			const unsigned char *vec, size_t n, off_t page)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++, page++) {
+		if (!(vec[i] & 0x1))
+			continue;
+		if (st->ext_first >= 0 && st->ext_last + 1 == page) {
+			st->ext_last = page;
+			continue;
+		}
+		flush_extent(st);
+		st->ext_first = st->ext_last = page;
+	}
+}
+
 static int do_mincore(struct fincore_control *ctl,
+		      unsigned char *vec,
 		      void *window, const size_t len,
-		      const char *name,
-		      off_t *count_incore)
+		      off_t file_offset,
+		      struct fincore_state *st)
 {
-	static unsigned char vec[N_PAGES_IN_WINDOW];
-	int n = (len / ctl->pagesize) + ((len % ctl->pagesize)? 1: 0);
+	size_t n = (len / ctl->pagesize) + ((len % ctl->pagesize)? 1: 0);
 
 	if (mincore (window, len, vec) < 0) {
-		warn(_("failed to do mincore: %s"), name);
+		warn(_("failed to do mincore: %s"), st->name);
 		return -errno;
 	}
 
-	while (n > 0)
-	{
-		if (vec[--n] & 0x1)
-		{
-			vec[n] = 0;
-			(*count_incore)++;
-		}
+	st->count_incore += count_resident(vec, n);
+	if (ctl->extents)
+		add_extents(st, vec, n, file_offset / ctl->pagesize);
+
+	return 0;
+}
+
+/*
+ * Returns: <0 on error, 0 success, 1 cachestat() is not usable for the file.
+ */
+static int do_cachestat(int fd, off_t file_size, struct fincore_state *st)
+{
+	struct cachestat_range cs_range = { .off = 0, .len = file_size };
+	struct cachestat cs;
+
+	/* The kernel may refuse the file for other reasons than bad
+	 * arguments (e.g. EPERM if the caller can neither write nor owns the
+	 * file), mmap() and mincore() work for all readable files. */
+	if (cachestat(fd, &cs_range, &cs, 0) != 0) {
+		if (errno != EBADF)
+			return 1;
+		warn(_("failed to do cachestat: %s"), st->name);
+		return -errno;
 	}
 
+	st->count_incore = cs.nr_cache;
 	return 0;
 }
 
 static int fincore_fd (struct fincore_control *ctl,
+		       unsigned char *vec,
 		       int fd,
-		       const char *name,
 		       off_t file_size,
-		       off_t *count_incore)
+		       struct fincore_state *st)
 {
 	size_t window_size = N_PAGES_IN_WINDOW * ctl->pagesize;
 	off_t file_offset, len;
 	int rc = 0;
 
+	/* cachestat() counts the pages without mmap(), but it does not
+	 * return the positions of the pages */
+	if (ctl->cachestat && !ctl->extents) {
+		rc = do_cachestat(fd, file_size, st);
+		if (rc <= 0)
+			return rc;
+		rc = 0;
+	}
+
 	for (file_offset = 0; file_offset < file_size; file_offset += len) {
 		void  *window = NULL;
 
@@ -207,17 +369,18 @@ static int fincore_fd (struct fincore_control *ctl,
 		window = mmap(window, len, PROT_NONE, MAP_PRIVATE, fd, file_offset);
 		if (window == MAP_FAILED) {
 			rc = -EINVAL;
-			warn(_("failed to do mmap: %s"), name);
+			warn(_("failed to do mmap: %s"), st->name);
 			break;
 		}
 
-		rc = do_mincore(ctl, window, len, name, count_incore);
+		rc = do_mincore(ctl, vec, window, len, file_offset, st);
+		munmap (window, len);
 		if (rc)
 			break;
-
-		munmap (window, len);
 	}
 
+	if (ctl->extents)
+		flush_extent(st);
 	return rc;
 }
 
@@ -225,34 +388,191 @@ static int fincore_fd (struct fincore_control *ctl,
  * Returns: <0 on error, 0 success, 1 ignore.
  */
 static int fincore_name(struct fincore_control *ctl,
-			const char *name,
-			struct stat *sb,
-			off_t *count_incore)
+			unsigned char *vec,
+			struct fincore_state *st)
 {
 	int fd;
 	int rc = 0;
 
-	if ((fd = open (name, O_RDONLY)) < 0) {
-		warn(_("failed to open: %s"), name);
+	if ((fd = open (st->name, O_RDONLY)) < 0) {
+		warn(_("failed to open: %s"), st->name);
 		return -errno;
 	}
 
-	if (fstat (fd, sb) < 0) {
-		warn(_("failed to do fstat: %s"), name);
+	if (fstat (fd, &st->sb) < 0) {
+		warn(_("failed to do fstat: %s"), st->name);
 		close (fd);
 		return -errno;
 	}
 
-	if (S_ISDIR(sb->st_mode))
+	if (S_ISDIR(st->sb.st_mode))
 		rc = 1;			/* ignore */
 
-	else if (sb->st_size)
-		rc = fincore_fd(ctl, fd, name, sb->st_size, count_incore);
+	else if (st->sb.st_size)
+		rc = fincore_fd(ctl, vec, fd, st->sb.st_size, st);
 
 	close (fd);
 	return rc;
 }
 
+/*
+ * The files for worker threads (--jobs). Every thread takes the next file of
+ * the batch, the results are printed in the batch order after all the threads
+ * are done, so the output is the same as for the serial processing.
+ */
+struct fincore_pool {
+	struct fincore_control *ctl;
+	size_t next;			/* the next file to be processed */
+	pthread_mutex_t lock;		/* protects @next */
+};
+
+static void *fincore_worker(void *data)
+{
+	struct fincore_pool *pool = data;
+	struct fincore_control *ctl = pool->ctl;
+	unsigned char *vec = xmalloc(N_PAGES_IN_WINDOW);
+
+	while (1) {
+		size_t i;
+
+		pthread_mutex_lock(&pool->lock);
+		i = pool->next++;
+		pthread_mutex_unlock(&pool->lock);
+
+		if (i >= ctl->nfiles)
+			break;
+		ctl->batch[i].rc = fincore_name(ctl, vec, &ctl->batch[i]);
+	}
+
+	free(vec);
+	return NULL;
+}
+
+static void process_batch_parallel(struct fincore_control *ctl)
+{
+	struct fincore_pool pool = {
+		.ctl = ctl,
+		.lock = PTHREAD_MUTEX_INITIALIZER
+	};
+	pthread_t *threads;
+	size_t i, nthreads = 0;
+
+	threads = xcalloc(ctl->njobs, sizeof(pthread_t));
+
+	for (i = 0; i < ctl->njobs && i < ctl->nfiles; i++) {
+		if (pthread_create(&threads[nthreads], NULL, fincore_worker, &pool) != 0) {
+			warn(_("cannot create thread"));
+			break;
+		}
+		nthreads++;
+	}
+
+	if (nthreads == 0)
+		/* fallback, use the main thread */
+		fincore_worker(&pool);
+
+	for (i = 0; i < nthreads; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+}
+
+static void process_batch(struct fincore_control *ctl)
+{
+	size_t i;
+
+	if (!ctl->nfiles)
+		return;
+
+	if (ctl->njobs > 1 && ctl->nfiles > 1)
+		process_batch_parallel(ctl);
+	else {
+		for (i = 0; i < ctl->nfiles; i++)
+			ctl->batch[i].rc = fincore_name(ctl, ctl->vec, &ctl->batch[i]);
+	}
+
+	for (i = 0; i < ctl->nfiles; i++) {
+		struct fincore_state *st = &ctl->batch[i];
+
+		switch (st->rc) {
+		case 0:
+			add_output_data(ctl, st);
+			break;
+		case 1:
+			break; /* ignore */
+		default:
+			ctl->rc = EXIT_FAILURE;
+			break;
+		}
+		free(st->name);
+		ul_buffer_free_data(&st->extents);
+	}
+	ctl->nfiles = 0;
+}
+
+static void add_file(struct fincore_control *ctl, const char *name)
+{
+	struct fincore_state *st;
+
+	if (ctl->nfiles == N_FILES_IN_BATCH)
+		process_batch(ctl);
+
+	st = &ctl->batch[ctl->nfiles++];
+	memset(st, 0, sizeof(*st));
+	st->name = xstrdup(name);
+	st->ext_first = -1;
+}
+
+/* nftw() does not have any argument for private data */
+static struct fincore_control *walk_ctl;
+
+static int walk_callback(const char *name, const struct stat *sb,
+			 int type, struct FTW *ftwbuf __attribute__((unused)))
+{
+	switch (type) {
+	case FTW_DNR:
+		warnx(_("cannot read directory: %s"), name);
+		walk_ctl->rc = EXIT_FAILURE;
+		break;
+	case FTW_NS:
+		warnx(_("cannot stat: %s"), name);
+		walk_ctl->rc = EXIT_FAILURE;
+		break;
+	case FTW_F:
+		/* don't open FIFOs, devices, etc. */
+		if (S_ISREG(sb->st_mode))
+			add_file(walk_ctl, name);
+		break;
+	}
+	return 0;
+}
+
+static void add_name(struct fincore_control *ctl, const char *name)
+{
+	struct stat sb;
+
+	if (ctl->recursive && stat(name, &sb) == 0 && S_ISDIR(sb.st_mode)) {
+		walk_ctl = ctl;
+		if (nftw(name, walk_callback, 32, FTW_PHYS) != 0) {
+			warn(_("failed to walk directory: %s"), name);
+			ctl->rc = EXIT_FAILURE;
+		}
+		return;
+	}
+
+	/* errors are reported by fincore_name() */
+	add_file(ctl, name);
+}
+
+static int cachestat_is_supported(void)
+{
+	struct cachestat_range cs_range = { 0 };
+	struct cachestat cs;
+
+	/* the kernel checks the arguments, so it returns EBADF for
+	 * an invalid file descriptor if the syscall is implemented */
+	return cachestat(-1, &cs_range, &cs, 0) != 0 && errno == EBADF;
+}
+
 static void __attribute__((__noreturn__)) usage(void)
 {
 	FILE *out = stdout;
@@ -264,9 +584,11 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(USAGE_OPTIONS, out);
 	fputs(_(" -J, --json            use JSON output format\n"), out);
 	fputs(_(" -b, --bytes           print sizes in bytes rather than in human readable format\n"), out);
+	fputs(_(" -j, --jobs <num>      number of threads to process files\n"), out);
 	fputs(_(" -n, --noheadings      don't print headings\n"), out);
 	fputs(_(" -o, --output <list>   output columns\n"), out);
 	fputs(_(" -r, --raw             use raw output format\n"), out);
+	fputs(_(" -R, --recursive       recursively check all files in directories\n"), out);
 
 	fputs(USAGE_SEPARATOR, out);
 	printf(USAGE_HELP_OPTIONS(23));
@@ -285,21 +607,24 @@ int main(int argc, char ** argv)
 {
 	int c;
 	size_t i;
-	int rc = EXIT_SUCCESS;
 	char *outarg = NULL;
 
 	struct fincore_control ctl = {
-		.pagesize = getpagesize()
+		.pagesize = getpagesize(),
+		.njobs = 1,
+		.rc = EXIT_SUCCESS
 	};
 
 	static const struct option longopts[] = {
 		{ "bytes",      no_argument, NULL, 'b' },
+		{ "jobs",       required_argument, NULL, 'j' },
 		{ "noheadings", no_argument, NULL, 'n' },
 		{ "output",     required_argument, NULL, 'o' },
 		{ "version",    no_argument, NULL, 'V' },
 		{ "help",	no_argument, NULL, 'h' },
 		{ "json",       no_argument, NULL, 'J' },
 		{ "raw",        no_argument, NULL, 'r' },
+		{ "recursive",  no_argument, NULL, 'R' },
 		{ NULL, 0, NULL, 0 },
 	};
 
@@ -308,11 +633,14 @@ int main(int argc, char ** argv)
 	textdomain(PACKAGE);
 	close_stdout_atexit();
 
-	while ((c = getopt_long (argc, argv, "bno:JrVh", longopts, NULL)) != -1) {
+	while ((c = getopt_long (argc, argv, "bj:no:JrRVh", longopts, NULL)) != -1) {
 		switch (c) {
 		case 'b':
 			ctl.bytes = 1;
 			break;
+		case 'j':
+			ctl.njobs = strtou32_or_err(optarg, _("invalid jobs argument"));
+			break;
 		case 'n':
 			ctl.noheadings = 1;
 			break;
@@ -325,6 +653,9 @@ int main(int argc, char ** argv)
 		case 'r':
 			ctl.raw = 1;
 			break;
+		case 'R':
+			ctl.recursive = 1;
+			break;
 		case 'V':
 			print_version(EXIT_SUCCESS);
 		case 'h':
@@ -361,6 +692,11 @@ int main(int argc, char ** argv)
 	if (ctl.json)
 		scols_table_set_name(ctl.tb, "fincore");
 
+	/* the column widths are not used for raw and JSON output, so the lines
+	 * are printed as soon as the batch is processed */
+	if (ctl.raw || ctl.json)
+		scols_table_enable_streaming(ctl.tb, 1);
+
 	for (i = 0; i < ncolumns; i++) {
 		const struct colinfo *col = get_column_info(i);
 		struct libscols_column *cl;
@@ -369,11 +705,15 @@ int main(int argc, char ** argv)
 		if (!cl)
 			err(EXIT_FAILURE, _("failed to allocate output column"));
 
+		if (get_column_id(i) == COL_EXTENTS)
+			ctl.extents = 1;
+
 		if (ctl.json) {
 			int id = get_column_id(i);
 
 			switch (id) {
 			case COL_FILE:
+			case COL_EXTENTS:
 				scols_column_set_json_type(cl, SCOLS_JSON_STRING);
 				break;
 			case COL_SIZE:
@@ -388,25 +728,21 @@ int main(int argc, char ** argv)
 		}
 	}
 
-	for(; optind < argc; optind++) {
-		char *name = argv[optind];
-		struct stat sb;
-		off_t count_incore = 0;
+	ctl.cachestat = cachestat_is_supported();
+	ctl.batch = xcalloc(N_FILES_IN_BATCH, sizeof(struct fincore_state));
+	ctl.vec = xmalloc(N_PAGES_IN_WINDOW);
 
-		switch (fincore_name(&ctl, name, &sb, &count_incore)) {
-		case 0:
-			add_output_data(&ctl, name, sb.st_size, count_incore);
-			break;
-		case 1:
-			break; /* ignore */
-		default:
-			rc = EXIT_FAILURE;
-			break;
-		}
-	}
+	for(; optind < argc; optind++)
+		add_name(&ctl, argv[optind]);
+	process_batch(&ctl);
 
-	scols_print_table(ctl.tb);
+	if (scols_table_is_streaming(ctl.tb))
+		scols_table_stream_end(ctl.tb);
+	else
+		scols_print_table(ctl.tb);
 	scols_unref_table(ctl.tb);
+	free(ctl.batch);
+	free(ctl.vec);
 
-	return rc;
+	return ctl.rc;
 }
@@ -1102,6 +1102,7 @@ static int poll_table(struct libmnt_table *tb, const char *tabfile,
 	struct libmnt_iter *itr = NULL;
 	struct libmnt_table *tb_new;
 	struct libmnt_tabdiff *diff = NULL;
+	struct libmnt_monitor *mn = NULL;
 	struct pollfd fds[1];
 
 	tb_new = mnt_new_table();
@@ -1134,6 +1135,16 @@ static int poll_table(struct libmnt_table *tb, const char *tabfile,
 
 	mnt_table_set_parser_errcb(tb_new, parser_errcb);
 
+	/* kernel table -- let libmount compare mount IDs and re-parse
+	 * modified lines only */
+	if (strcmp(tabfile, _PATH_PROC_MOUNTINFO) == 0) {
+		mn = mnt_new_monitor();
+		if (!mn || mnt_monitor_diff_kernel(mn, diff, NULL) < 0) {
+			warn(_("failed to initialize libmount monitor"));
+			goto done;
+		}
+	}
+
 	fds[0].fd = fileno(f);
 	fds[0].events = POLLPRI;
 
@@ -1150,10 +1161,14 @@ static int poll_table(struct libmnt_table *tb, const char *tabfile,
 			goto done;
 		}
 
-		rewind(f);
-		rc = mnt_table_parse_stream(tb_new, f, tabfile);
-		if (!rc)
-			rc = mnt_diff_tables(diff, tb, tb_new);
+		if (mn)
+			rc = mnt_monitor_diff_kernel(mn, diff, NULL);
+		else {
+			rewind(f);
+			rc = mnt_table_parse_stream(tb_new, f, tabfile);
+			if (!rc)
+				rc = mnt_diff_tables(diff, tb, tb_new);
+		}
 		if (rc < 0)
 			goto done;
 
@@ -1183,14 +1198,16 @@ static int poll_table(struct libmnt_table *tb, const char *tabfile,
 				goto done;
 		}
 
-		/* swap tables */
-		tmp = tb;
-		tb = tb_new;
-		tb_new = tmp;
-
 		/* remove already printed lines to reduce memory usage */
 		scols_table_remove_lines(table);
-		mnt_reset_table(tb_new);
+
+		if (!mn) {
+			/* swap tables */
+			tmp = tb;
+			tb = tb_new;
+			tb_new = tmp;
+			mnt_reset_table(tb_new);
+		}
 
 		if (count && (flags & FL_FIRSTONLY))
 			break;
@@ -1199,6 +1216,7 @@ static int poll_table(struct libmnt_table *tb, const char *tabfile,
 	rc = 0;
 done:
 	mnt_unref_table(tb_new);
+	mnt_unref_monitor(mn);
 	mnt_free_tabdiff(diff);
 	mnt_free_iter(itr);
 	if (f)
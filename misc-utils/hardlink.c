@@ -36,6 +36,7 @@
 #include <signal.h>		/* SIG*, sigaction */
 #include <getopt.h>		/* getopt_long() */
 #include <ctype.h>		/* tolower() */
+#include <pthread.h>		/* --jobs */
 
 #include "nls.h"
 #include "c.h"
@@ -43,6 +44,9 @@
 #include "strutils.h"
 #include "monotonic.h"
 #include "optutils.h"
+#include "fileutils.h"
+#include "closestream.h"
+#include "sha1.h"
 
 #include <regex.h>		/* regcomp(), regexec() */
 
@@ -56,6 +60,8 @@ static int quiet;		/* don't print anything */
  * struct file - Information about a file
  * @st:       The stat buffer associated with the file
  * @next:     Next file with the same size
+ * @head:     Digest of the first and the last block
+ * @digest:   Digest of the whole file
  * @basename: The offset off the basename in the filename
  * @path:     The path of the file
  *
@@ -64,6 +70,11 @@ static int quiet;		/* don't print anything */
 struct file {
 	struct stat st;
 	struct file *next;
+	unsigned char head[UL_SHA1LENGTH];
+	unsigned char digest[UL_SHA1LENGTH];
+	unsigned int has_head:1,
+		     has_digest:1,
+		     digest_cached:1;	/* persistent cache checked */
 	struct link {
 		struct link *next;
 		int basename;
@@ -102,6 +113,7 @@ enum log_level {
  * @linked: The number of files replaced by a hardlink to a master
  * @xattr_comparisons: The number of extended attribute comparisons
  * @comparisons: The number of comparisons
+ * @digests: The number of files read to compute digest
  * @saved: The (exaggerated) amount of space saved
  * @start_time: The time we started at
  */
@@ -111,6 +123,7 @@ static struct statistics {
 	size_t linked;
 	size_t xattr_comparisons;
 	size_t comparisons;
+	size_t digests;
 	double saved;
 	struct timeval start_time;
 } stats;
@@ -137,6 +150,8 @@ struct hdl_regex {
  * @keep_oldest: Choose the file with oldest timestamp as master (default = FALSE)
  * @dry_run: Specifies whether hardlink should not link files (default = FALSE)
  * @min_size: Minimum size of files to consider. (default = 1 byte)
+ * @njobs: Number of threads to compare files (default = 1)
+ * @cache_file: Persistent digest cache
  */
 static struct options {
 	struct hdl_regex *include;
@@ -154,6 +169,8 @@ static struct options {
 	unsigned int dry_run:1;
 	uintmax_t min_size;
 	size_t bufsiz;
+	unsigned int njobs;
+	const char *cache_file;
 } opts = {
 	/* default setting */
 	.respect_mode = TRUE,
@@ -162,7 +179,8 @@ static struct options {
 	.respect_xattrs = FALSE,
 	.keep_oldest = FALSE,
 	.min_size = 1,
-	.bufsiz = DEF_SCAN_BUFSIZ
+	.bufsiz = DEF_SCAN_BUFSIZ,
+	.njobs = 1
 };
 
 /*
@@ -175,10 +193,20 @@ static void *files;
 static void *files_by_ino;
 
 /*
- * Temporary buffers for reading file contents
+ * Temporary buffers for reading file contents, every thread has its own
+ * buffers
  */
-static char *buf_a = NULL;
-static char *buf_b = NULL;
+struct hdl_buffers {
+	char *a;
+	char *b;
+};
+
+/*
+ * Locks for --jobs; the files are compared in parallel, but linking is
+ * serialized
+ */
+static pthread_mutex_t link_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
 
 /*
  * last_signal
@@ -201,10 +229,12 @@ static void jlog(enum log_level level, const char *format, ...)
 	if (quiet || level > (unsigned int)opts.verbosity)
 		return;
 
+	flockfile(stdout);
 	va_start(args, format);
 	vfprintf(stdout, format, args);
 	va_end(args);
 	fputc('\n', stdout);
+	funlockfile(stdout);
 }
 
 /**
@@ -328,6 +358,8 @@ static void print_stats(void)
 #endif
 	jlog(JLOG_SUMMARY, _("%-15s %zu files"), _("Compared:"),
 	     stats.comparisons);
+	jlog(JLOG_SUMMARY, _("%-15s %zu files"), _("Digests:"),
+	     stats.digests);
 
 	ssz = size_to_human_string(SIZE_SUFFIX_3LETTER |
 				   SIZE_SUFFIX_SPACE |
@@ -473,7 +505,9 @@ static int file_xattrs_equal(const struct file *a, const struct file *b)
 	jlog(JLOG_VERBOSE1, _("Comparing xattrs of %s to %s"), a->links->path,
 	     b->links->path);
 
+	pthread_mutex_lock(&stats_lock);
 	stats.xattr_comparisons++;
+	pthread_mutex_unlock(&stats_lock);
 
 	len_a = llistxattr_or_die(a->links->path, NULL, 0);
 	len_b = llistxattr_or_die(b->links->path, NULL, 0);
@@ -557,15 +591,22 @@ static int file_xattrs_equal(const struct file *a, const struct file *b)
  * file_contents_equal - Compare contents of two files for equality
  * @a: The first file
  * @b: The second file
+ * @buf: The buffers for reading the files
  *
- * Compare the contents of the files for equality
+ * Compare the contents of the files for equality. If the digests are stored
+ * to the persistent cache (see --cache-file), the digest of the whole file is
+ * computed from the data read for the comparison.
  */
-static int file_contents_equal(const struct file *a, const struct file *b)
+static int file_contents_equal(struct file *a, struct file *b,
+			       struct hdl_buffers *buf)
 {
 	FILE *fa = NULL;
 	FILE *fb = NULL;
 	int cmp = 0;		/* zero => equal */
 	off_t off = 0;		/* current offset */
+	UL_SHA1_CTX ctx;
+	int hash = opts.cache_file && a->has_head && b->has_head
+		   && !(a->has_digest && b->has_digest);
 
 	assert(a->links != NULL);
 	assert(b->links != NULL);
@@ -573,12 +614,16 @@ static int file_contents_equal(const struct file *a, const struct file *b)
 	jlog(JLOG_VERBOSE1, _("Comparing %s to %s"), a->links->path,
 	     b->links->path);
 
+	pthread_mutex_lock(&stats_lock);
 	stats.comparisons++;
+	pthread_mutex_unlock(&stats_lock);
 
 	if ((fa = fopen(a->links->path, "rb")) == NULL)
 		goto err;
 	if ((fb = fopen(b->links->path, "rb")) == NULL)
 		goto err;
+	if (hash)
+		ul_SHA1Init(&ctx);
 
 #if defined(POSIX_FADV_SEQUENTIAL) && defined(HAVE_POSIX_FADVISE)
 	ignore_result( posix_fadvise(fileno(fa), 0, 0, POSIX_FADV_SEQUENTIAL) );
@@ -589,12 +634,12 @@ static int file_contents_equal(const struct file *a, const struct file *b)
 		size_t ca;
 		size_t cb;
 
-		ca = fread(buf_a, 1, opts.bufsiz, fa);
-		if (ca < sizeof(buf_a) && ferror(fa))
+		ca = fread(buf->a, 1, opts.bufsiz, fa);
+		if (ca < opts.bufsiz && ferror(fa))
 			goto err;
 
-		cb = fread(buf_b, 1, opts.bufsiz, fb);
-		if (cb < sizeof(buf_b) && ferror(fb))
+		cb = fread(buf->b, 1, opts.bufsiz, fb);
+		if (cb < opts.bufsiz && ferror(fb))
 			goto err;
 
 		off += ca;
@@ -603,7 +648,15 @@ static int file_contents_equal(const struct file *a, const struct file *b)
 			cmp = CMP(ca, cb);
 			break;
 		}
-		cmp = memcmp(buf_a, buf_b, ca);
+		cmp = memcmp(buf->a, buf->b, ca);
+		if (hash && cmp == 0)
+			ul_SHA1Update(&ctx, (unsigned char *) buf->a, ca);
+	}
+
+	if (hash && cmp == 0 && off == a->st.st_size) {
+		ul_SHA1Final(a->digest, &ctx);
+		memcpy(b->digest, a->digest, sizeof(b->digest));
+		a->has_digest = b->has_digest = 1;
 	}
  out:
 	if (fa != NULL)
@@ -621,16 +674,391 @@ static int file_contents_equal(const struct file *a, const struct file *b)
 	goto out;
 }
 
+/*
+ * Digests
+ *
+ * The files are compared by digests before the contents are compared byte by
+ * byte. The first stage is a digest of the first and the last block of the
+ * file; the second stage is a digest of the whole file. The digests are
+ * computed only once for every file. Files with different digests are never
+ * compared; files with the same digests are always compared byte by byte.
+ */
+#define DIGEST_BLOCKSIZ	4096
+
+/**
+ * struct hdl_digest - Digest cache entry
+ * @dev: Device
+ * @ino: Inode number
+ * @size: File size
+ * @mtime: Modification time
+ * @head: Digest of the first and the last block
+ * @digest: Digest of the whole file
+ * @seen: The file has been visited in this run
+ */
+struct hdl_digest {
+	dev_t dev;
+	ino_t ino;
+	off_t size;
+	struct timespec mtime;
+	unsigned char head[UL_SHA1LENGTH];
+	unsigned char digest[UL_SHA1LENGTH];
+	unsigned int seen:1;
+};
+
+/*
+ * The persistent digest cache (see --cache-file), read-only when files are
+ * compared
+ */
+static void *digests;
+
+static int compare_digests(const void *_a, const void *_b)
+{
+	const struct hdl_digest *a = _a;
+	const struct hdl_digest *b = _b;
+	int diff = CMP(a->dev, b->dev);
+
+	if (diff == 0)
+		diff = CMP(a->ino, b->ino);
+	return diff;
+}
+
+/**
+ * file_lookup_digest - Get digests from the persistent cache
+ * @f: The file
+ */
+static void file_lookup_digest(struct file *f)
+{
+	struct hdl_digest key, **x, *d;
+
+	f->digest_cached = 1;
+	if (!digests)
+		return;
+
+	key.dev = f->st.st_dev;
+	key.ino = f->st.st_ino;
+
+	x = tfind(&key, &digests, compare_digests);
+	if (!x)
+		return;
+	d = *x;
+	d->seen = 1;
+
+	if (d->size != f->st.st_size
+	    || d->mtime.tv_sec != f->st.st_mtim.tv_sec
+	    || d->mtime.tv_nsec != f->st.st_mtim.tv_nsec)
+		return;		/* modified file */
+
+	memcpy(f->head, d->head, sizeof(f->head));
+	memcpy(f->digest, d->digest, sizeof(f->digest));
+	f->has_head = f->has_digest = 1;
+}
+
+static int hex_to_bin(const char *hex, unsigned char *bin, size_t sz)
+{
+	size_t i;
+
+	if (strlen(hex) != sz * 2)
+		return -1;
+	for (i = 0; i < sz; i++) {
+		unsigned int x;
+
+		if (!isxdigit(hex[2 * i]) || !isxdigit(hex[2 * i + 1])
+		    || sscanf(hex + 2 * i, "%2x", &x) != 1)
+			return -1;
+		bin[i] = x;
+	}
+	return 0;
+}
+
+static int read_block(int fd, char *buf, size_t sz, off_t off)
+{
+	while (sz) {
+		ssize_t n = pread(fd, buf, sz, off);
+
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return -1;
+		buf += n;
+		sz -= n;
+		off += n;
+	}
+	return 0;
+}
+
+/**
+ * file_get_digest - Compute digest of the file
+ * @f: The file
+ * @full: Digest of the whole file, otherwise only of the first and last blocks
+ * @buf: The buffers for reading the file
+ *
+ * Returns: %TRUE if the requested digest is available.
+ */
+static int file_get_digest(struct file *f, int full, struct hdl_buffers *buf)
+{
+	UL_SHA1_CTX ctx;
+	off_t size = f->st.st_size;
+	int fd;
+
+	if (!f->digest_cached)
+		file_lookup_digest(f);
+	if (full ? f->has_digest : f->has_head)
+		return TRUE;
+
+	fd = open(f->links->path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return FALSE;
+
+	if (!f->has_head) {
+		size_t sz = min((off_t) DIGEST_BLOCKSIZ, size);
+
+		ul_SHA1Init(&ctx);
+		if (read_block(fd, buf->a, sz, 0) != 0)
+			goto err;
+		ul_SHA1Update(&ctx, (unsigned char *) buf->a, sz);
+
+		if (size > DIGEST_BLOCKSIZ) {
+			off_t off = max((off_t) DIGEST_BLOCKSIZ, size - DIGEST_BLOCKSIZ);
+
+			sz = size - off;
+			if (read_block(fd, buf->a, sz, off) != 0)
+				goto err;
+			ul_SHA1Update(&ctx, (unsigned char *) buf->a, sz);
+		}
+		ul_SHA1Final(f->head, &ctx);
+		f->has_head = 1;
+
+		/* the whole file has been read */
+		if (size <= 2 * DIGEST_BLOCKSIZ) {
+			memcpy(f->digest, f->head, sizeof(f->digest));
+			f->has_digest = 1;
+		}
+	}
+
+	if (full && !f->has_digest) {
+		off_t off = 0;
+
+		jlog(JLOG_VERBOSE2, _("Reading %s"), f->links->path);
+#if defined(POSIX_FADV_SEQUENTIAL) && defined(HAVE_POSIX_FADVISE)
+		ignore_result( posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL) );
+#endif
+		ul_SHA1Init(&ctx);
+		while (off < size) {
+			size_t sz = min((off_t) opts.bufsiz, size - off);
+
+			if (handle_interrupt() || read_block(fd, buf->a, sz, off) != 0)
+				goto err;
+			ul_SHA1Update(&ctx, (unsigned char *) buf->a, sz);
+			off += sz;
+		}
+		ul_SHA1Final(f->digest, &ctx);
+		f->has_digest = 1;
+
+		pthread_mutex_lock(&stats_lock);
+		stats.digests++;
+		pthread_mutex_unlock(&stats_lock);
+	}
+
+	close(fd);
+	return TRUE;
+err:
+	close(fd);
+	return FALSE;
+}
+
+/**
+ * file_digests_equal - Compare digests of two files
+ * @a: The first file
+ * @b: The second file
+ * @full: Compare digests of the whole files
+ * @buf: The buffers for reading the files
+ *
+ * Returns: %FALSE if the files are different; %TRUE if the files have to be
+ * compared byte by byte.
+ */
+static int file_digests_equal(struct file *a, struct file *b, int full,
+			      struct hdl_buffers *buf)
+{
+	if (!a->digest_cached)
+		file_lookup_digest(a);
+	if (!b->digest_cached)
+		file_lookup_digest(b);
+
+	if (a->has_digest && b->has_digest)
+		return memcmp(a->digest, b->digest, sizeof(a->digest)) == 0;
+
+	/* on error let file_contents_equal() report the problem */
+	if (!file_get_digest(a, FALSE, buf) || !file_get_digest(b, FALSE, buf))
+		return TRUE;
+	if (memcmp(a->head, b->head, sizeof(a->head)) != 0)
+		return FALSE;
+	if (!full)
+		return TRUE;
+
+	if (!file_get_digest(a, TRUE, buf) || !file_get_digest(b, TRUE, buf))
+		return TRUE;
+	return memcmp(a->digest, b->digest, sizeof(a->digest)) == 0;
+}
+
+/**
+ * read_digests - Read the persistent digest cache
+ * @filename: The cache file
+ *
+ * The file contains one line for every file:
+ * "<dev> <ino> <size> <mtime-sec>.<mtime-nsec> <head> <digest>"
+ */
+static void read_digests(const char *filename)
+{
+	FILE *f = fopen(filename, "r" UL_CLOEXECSTR);
+	char line[256];
+	size_t n = 0;
+
+	if (!f) {
+		if (errno != ENOENT)
+			warn(_("cannot open %s"), filename);
+		return;
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		struct hdl_digest *d, **x;
+		char head[2 * UL_SHA1LENGTH + 1], digest[2 * UL_SHA1LENGTH + 1];
+		uintmax_t dev, ino;
+		intmax_t size, sec;
+		long nsec;
+
+		if (*line == '#')
+			continue;
+		if (sscanf(line, "%ju %ju %jd %jd.%ld %40s %40s",
+			   &dev, &ino, &size, &sec, &nsec, head, digest) != 7)
+			continue;
+
+		d = xcalloc(1, sizeof(*d));
+		d->dev = dev;
+		d->ino = ino;
+		d->size = size;
+		d->mtime.tv_sec = sec;
+		d->mtime.tv_nsec = nsec;
+
+		if (hex_to_bin(head, d->head, sizeof(d->head)) != 0
+		    || hex_to_bin(digest, d->digest, sizeof(d->digest)) != 0) {
+			free(d);
+			continue;
+		}
+
+		x = tsearch(d, &digests, compare_digests);
+		if (!x)
+			err(EXIT_FAILURE, _("failed to allocate digest cache"));
+		if (*x != d)
+			free(d);	/* duplicate */
+		else
+			n++;
+	}
+	fclose(f);
+
+	jlog(JLOG_VERBOSE1, _("Read %zu digests from %s"), n, filename);
+}
+
+static void write_digest(FILE *f, dev_t dev, ino_t ino, off_t size,
+			 const struct timespec *mtime,
+			 const unsigned char *head, const unsigned char *digest)
+{
+	size_t i;
+
+	fprintf(f, "%ju %ju %jd %jd.%09ld ", (uintmax_t) dev, (uintmax_t) ino,
+		(intmax_t) size, (intmax_t) mtime->tv_sec, (long) mtime->tv_nsec);
+	for (i = 0; i < UL_SHA1LENGTH; i++)
+		fprintf(f, "%02x", head[i]);
+	fputc(' ', f);
+	for (i = 0; i < UL_SHA1LENGTH; i++)
+		fprintf(f, "%02x", digest[i]);
+	fputc('\n', f);
+}
+
+/* the output stream for twalk() callbacks */
+static FILE *digests_out;
+
+static void digest_file_writer(const void *nodep, const VISIT which, const int depth)
+{
+	struct file *f = *(struct file **)nodep;
+
+	(void)depth;
+
+	if (which != leaf && which != endorder)
+		return;
+
+	for (; f != NULL; f = f->next) {
+		/* linked files are moved to the master, except for --dry-run */
+		if ((f->links || opts.dry_run) && f->has_digest)
+			write_digest(digests_out, f->st.st_dev, f->st.st_ino,
+				     f->st.st_size, &f->st.st_mtim,
+				     f->head, f->digest);
+	}
+}
+
+static void digest_cache_writer(const void *nodep, const VISIT which, const int depth)
+{
+	struct hdl_digest *d = *(struct hdl_digest **)nodep;
+
+	(void)depth;
+
+	if (which != leaf && which != endorder)
+		return;
+
+	/* unchanged entries for files not visited in this run */
+	if (!d->seen)
+		write_digest(digests_out, d->dev, d->ino, d->size, &d->mtime,
+			     d->head, d->digest);
+}
+
+/**
+ * write_digests - Write the persistent digest cache
+ * @filename: The cache file
+ *
+ * The file is replaced atomically by rename().
+ */
+static void write_digests(const char *filename)
+{
+	char *tmp = NULL;
+	int fd;
+
+	xasprintf(&tmp, "%s.XXXXXX", filename);
+	fd = mkstemp_cloexec(tmp);
+	if (fd < 0 || !(digests_out = fdopen(fd, "w"))) {
+		warn(_("cannot create %s"), tmp);
+		if (fd >= 0) {
+			close(fd);
+			unlink(tmp);
+		}
+		free(tmp);
+		return;
+	}
+
+	fputs("# hardlink digest cache\n", digests_out);
+	twalk(files, digest_file_writer);
+	if (digests)
+		twalk(digests, digest_cache_writer);
+
+	if (close_stream(digests_out) != 0 || rename(tmp, filename) != 0) {
+		warn(_("cannot write %s"), filename);
+		unlink(tmp);
+	}
+	digests_out = NULL;
+	free(tmp);
+}
+
 /**
  * file_may_link_to - Check whether a file may replace another one
  * @a: The first file
  * @b: The second file
+ * @full: Compare digests of the whole files (see file_digests_equal())
+ * @buf: The buffers for reading the files
  *
  * Check whether the two fies are considered equal and can be linked
  * together. If the two files are identical, the result will be FALSE,
  * as replacing a link with an identical one is stupid.
  */
-static int file_may_link_to(const struct file *a, const struct file *b)
+static int file_may_link_to(struct file *a, struct file *b, int full,
+			    struct hdl_buffers *buf)
 {
 	return (a->st.st_size != 0 &&
 		a->st.st_size == b->st.st_size &&
@@ -645,7 +1073,8 @@ static int file_may_link_to(const struct file *a, const struct file *b)
 		 || strcmp(a->links->path + a->links->basename,
 			   b->links->path + b->links->basename) == 0) &&
 		(!opts.respect_xattrs || file_xattrs_equal(a, b)) &&
-		file_contents_equal(a, b));
+		file_digests_equal(a, b, full, buf) &&
+		file_contents_equal(a, b, buf));
 }
 
 /**
@@ -684,6 +1113,8 @@ static int file_compare(const struct file *a, const struct file *b)
  * Link the file, replacing @b with the current one. The file is first
  * linked to a temporary name, and then renamed to the name of @b, making
  * the replace atomic (@b will always exist).
+ *
+ * The caller is responsible for locking (see link_lock).
  */
 static int file_link(struct file *a, struct file *b)
 {
@@ -725,6 +1156,7 @@ static int file_link(struct file *a, struct file *b)
 	}
 
 	/* Update statistics */
+	pthread_mutex_lock(&stats_lock);
 	stats.linked++;
 
 	/* Increase the link count of this file, and set stat() of other file */
@@ -733,6 +1165,7 @@ static int file_link(struct file *a, struct file *b)
 
 	if (b->st.st_nlink == 0)
 		stats.saved += a->st.st_size;
+	pthread_mutex_unlock(&stats_lock);
 
 	/* Move the link from file b to a */
 	{
@@ -853,6 +1286,83 @@ static int inserter(const char *fpath, const struct stat *sb,
 	return 0;
 }
 
+/**
+ * link_bucket - Link equal files with the same size
+ * @master: The first #struct file in the list of files with the same size
+ * @buf: The buffers for reading the files
+ *
+ * Returns: %FALSE if interrupted; otherwise %TRUE.
+ */
+static int link_bucket(struct file *master, struct hdl_buffers *buf)
+{
+	struct file *other;
+	size_t n = 0;
+	int full;
+
+	/* digests of the whole files make sense for more than one comparison;
+	 * for two files the cached digests are used if available (see
+	 * file_digests_equal()) and new digests are computed by the byte
+	 * compare (see file_contents_equal()) */
+	for (other = master; other != NULL && n < 3; other = other->next)
+		n++;
+	full = n > 2;
+
+	for (; master != NULL; master = master->next) {
+		if (handle_interrupt())
+			return FALSE;
+		if (master->links == NULL)
+			continue;
+
+		for (other = master->next; other != NULL; other = other->next) {
+			int rc, errsv;
+
+			if (handle_interrupt())
+				return FALSE;
+
+			assert(other != other->next);
+			assert(other->st.st_size == master->st.st_size);
+
+			if (other->links == NULL
+			    || !file_may_link_to(master, other, full, buf))
+				continue;
+
+			pthread_mutex_lock(&link_lock);
+			rc = file_link(master, other);
+			errsv = errno;
+			pthread_mutex_unlock(&link_lock);
+
+			if (!rc && errsv == EMLINK)
+				master = other;
+		}
+	}
+	return TRUE;
+}
+
+static struct hdl_buffers *new_buffers(size_t bufsiz)
+{
+	struct hdl_buffers *buf = xmalloc(sizeof(*buf));
+
+	/* the buffer is also used to read DIGEST_BLOCKSIZ blocks */
+	bufsiz = max(bufsiz, (size_t) DIGEST_BLOCKSIZ);
+	buf->a = xmalloc(bufsiz);
+	buf->b = xmalloc(bufsiz);
+	return buf;
+}
+
+static void free_buffers(struct hdl_buffers *buf)
+{
+	if (!buf)
+		return;
+	free(buf->a);
+	free(buf->b);
+	free(buf);
+}
+
+/*
+ * Buffers for the main thread
+ */
+static struct hdl_buffers *buffers;
+
 /**
  * visitor - Callback for twalk()
  * @nodep: Pointer to a pointer to a #struct file
@@ -866,34 +1376,120 @@ static int inserter(const char *fpath, const struct stat *sb,
 static void visitor(const void *nodep, const VISIT which, const int depth)
 {
 	struct file *master = *(struct file **)nodep;
-	struct file *other;
 
 	(void)depth;
 
 	if (which != leaf && which != endorder)
 		return;
 
-	for (; master != NULL; master = master->next) {
-		if (handle_interrupt())
-			exit(EXIT_FAILURE);
-		if (master->links == NULL)
-			continue;
+	if (!link_bucket(master, buffers))
+		exit(EXIT_FAILURE);
+}
 
-		for (other = master->next; other != NULL; other = other->next) {
-			if (handle_interrupt())
-				exit(EXIT_FAILURE);
+/**
+ * struct hdl_pool - Size buckets for worker threads
+ * @buckets: The lists of files with the same size
+ * @nbuckets: The number of buckets
+ * @next: The next bucket to be processed
+ * @interrupted: Set if a worker has been interrupted
+ * @lock: Protects @next
+ */
+static struct hdl_pool {
+	struct file **buckets;
+	size_t nbuckets;
+	size_t next;
+	int interrupted;
+	pthread_mutex_t lock;
+} pool = {
+	.lock = PTHREAD_MUTEX_INITIALIZER
+};
 
-			assert(other != other->next);
-			assert(other->st.st_size == master->st.st_size);
+/**
+ * collector - Callback for twalk() to collect buckets for worker threads
+ *
+ * Buckets with only one file are ignored.
+ */
+static void collector(const void *nodep, const VISIT which, const int depth)
+{
+	struct file *master = *(struct file **)nodep;
 
-			if (other->links == NULL
-			    || !file_may_link_to(master, other))
-				continue;
+	(void)depth;
 
-			if (!file_link(master, other) && errno == EMLINK)
-				master = other;
+	if (which != leaf && which != endorder)
+		return;
+	if (master->next == NULL)
+		return;
+
+	if ((pool.nbuckets % 1024) == 0)
+		pool.buckets = xrealloc(pool.buckets,
+				(pool.nbuckets + 1024) * sizeof(struct file *));
+	pool.buckets[pool.nbuckets++] = master;
+}
+
+/**
+ * worker - Thread function, links files in the buckets from the pool
+ *
+ * The files with the same size are always processed by one thread, so the
+ * threads never share files.
+ */
+static void *worker(void *data __attribute__((__unused__)))
+{
+	struct hdl_buffers *buf = new_buffers(opts.bufsiz);
+
+	while (1) {
+		struct file *master = NULL;
+
+		pthread_mutex_lock(&pool.lock);
+		if (!pool.interrupted && pool.next < pool.nbuckets)
+			master = pool.buckets[pool.next++];
+		pthread_mutex_unlock(&pool.lock);
+
+		if (!master)
+			break;
+		if (!link_bucket(master, buf)) {
+			pthread_mutex_lock(&pool.lock);
+			pool.interrupted = 1;
+			pthread_mutex_unlock(&pool.lock);
+			break;
 		}
 	}
+
+	free_buffers(buf);
+	return NULL;
+}
+
+/**
+ * link_files_parallel - Link files by opts.njobs threads
+ */
+static void link_files_parallel(void)
+{
+	pthread_t *threads;
+	size_t i, nthreads = 0;
+
+	twalk(files, collector);
+
+	threads = xcalloc(opts.njobs, sizeof(pthread_t));
+
+	for (i = 0; i < opts.njobs && i < pool.nbuckets; i++) {
+		if (pthread_create(&threads[nthreads], NULL, worker, NULL) != 0) {
+			warn(_("cannot create thread"));
+			break;
+		}
+		nthreads++;
+	}
+
+	if (nthreads == 0 && pool.nbuckets)
+		/* fallback, use the main thread */
+		worker(NULL);
+
+	for (i = 0; i < nthreads; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+
+	free(pool.buckets);
+
+	if (pool.interrupted)
+		exit(EXIT_FAILURE);
 }
 
 /**
@@ -931,6 +1527,8 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(_(" -s, --minimum-size <size>  minimum size for files.\n"), out);
 	fputs(_(" -S, --buffer-size <size>   buffer size for file reading (speedup, using more RAM)\n"), out);
 	fputs(_(" -c, --content              compare only file contents, same as -pot\n"), out);
+	fputs(_(" -j, --jobs <num>           compare files by <num> threads\n"), out);
+	fputs(_("     --cache-file <file>    use persistent cache for file digests\n"), out);
 
 	fputs(USAGE_SEPARATOR, out);
 	printf(USAGE_HELP_OPTIONS(28));
@@ -939,19 +1537,6 @@ static void __attribute__((__noreturn__)) usage(void)
 	exit(EXIT_SUCCESS);
 }
 
-
-static void init_buffers(size_t bufsiz)
-{
-	buf_a = xmalloc(bufsiz);
-	buf_b = xmalloc(bufsiz);
-}
-
-static void deinit_buffers(void)
-{
-	free(buf_a);
-	free(buf_b);
-}
-
 /**
  * parse_options - Parse the command line options
  * @argc: Number of options
@@ -959,7 +1544,10 @@ static void deinit_buffers(void)
  */
 static int parse_options(int argc, char *argv[])
 {
-	static const char optstr[] = "VhvnfpotXcmMOx:i:s:S:q";
+	enum {
+		OPT_CACHE_FILE = CHAR_MAX + 1
+	};
+	static const char optstr[] = "VhvnfpotXcmMOx:i:j:s:S:q";
 	static const struct option long_options[] = {
 		{"version", no_argument, NULL, 'V'},
 		{"help", no_argument, NULL, 'h'},
@@ -975,6 +1563,8 @@ static int parse_options(int argc, char *argv[])
 		{"keep-oldest", no_argument, NULL, 'O'},
 		{"exclude", required_argument, NULL, 'x'},
 		{"include", required_argument, NULL, 'i'},
+		{"jobs", required_argument, NULL, 'j'},
+		{"cache-file", required_argument, NULL, OPT_CACHE_FILE},
 		{"minimum-size", required_argument, NULL, 's'},
 		{"buffer-size", required_argument, NULL, 'S'},
 		{"content", no_argument, NULL, 'c'},
@@ -1039,6 +1629,14 @@ static int parse_options(int argc, char *argv[])
 		case 'i':
 			register_regex(&opts.include, optarg);
 			break;
+		case 'j':
+			opts.njobs = strtou32_or_err(optarg, _("invalid jobs argument"));
+			if (opts.njobs == 0)
+				errx(EXIT_FAILURE, _("invalid jobs argument"));
+			break;
+		case OPT_CACHE_FILE:
+			opts.cache_file = optarg;
+			break;
 		case 's':
 			opts.min_size = strtosize_or_err(optarg, _("failed to parse size"));
 			break;
@@ -1102,7 +1700,10 @@ int main(int argc, char *argv[])
 
 	gettime_monotonic(&stats.start_time);
 
-	init_buffers(opts.bufsiz);
+	buffers = new_buffers(opts.bufsiz);
+
+	if (opts.cache_file)
+		read_digests(opts.cache_file);
 
 	stats.started = TRUE;
 
@@ -1111,9 +1712,15 @@ int main(int argc, char *argv[])
 			warn(_("cannot process %s"), argv[optind]);
 	}
 
-	twalk(files, visitor);
+	if (opts.njobs > 1)
+		link_files_parallel();
+	else
+		twalk(files, visitor);
+
+	if (opts.cache_file)
+		write_digests(opts.cache_file);
 
-	deinit_buffers();
+	free_buffers(buffers);
 
 	return 0;
 }
@@ -36,15 +36,21 @@ void lsfd_counter_free(struct lsfd_counter *counter)
 	free(counter);
 }
 
-bool lsfd_counter_accumulate(struct lsfd_counter *counter, struct libscols_line *ln)
+bool lsfd_counter_accumulate(struct lsfd_counter *counter, struct libscols_line *ln,
+			     const void *row)
 {
-	if (lsfd_filter_apply(counter->filter, ln)) {
+	if (lsfd_filter_apply(counter->filter, ln, row)) {
 		counter->value++;
 		return true;
 	}
 	return false;
 }
 
+bool lsfd_counter_uses_column(struct lsfd_counter *counter, int col_id)
+{
+	return lsfd_filter_uses_column(counter->filter, col_id);
+}
+
 const char *lsfd_counter_name(struct lsfd_counter *counter)
 {
 	return counter->name;
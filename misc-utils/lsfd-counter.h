@@ -22,7 +22,9 @@ struct lsfd_counter;
 struct lsfd_counter *lsfd_counter_new(const char *const name, struct lsfd_filter *filter);
 void lsfd_counter_free(struct lsfd_counter *counter);
 
-bool lsfd_counter_accumulate(struct lsfd_counter *counter, struct libscols_line *ln);
+bool lsfd_counter_accumulate(struct lsfd_counter *counter, struct libscols_line *ln,
+			     const void *row);
+bool lsfd_counter_uses_column(struct lsfd_counter *counter, int col_id);
 
 const char *lsfd_counter_name(struct lsfd_counter *counter);
 size_t lsfd_counter_value(struct lsfd_counter *counter);
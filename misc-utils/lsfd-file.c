@@ -350,6 +350,89 @@ static bool file_fill_column(struct proc *proc,
 	return true;
 }
 
+/*
+ * The columns are not overwritten by the subclasses, keep it in sync with
+ * file_fill_column(). The values are converted in the same way as the
+ * strings are parsed by the filter.
+ */
+bool file_has_num_column(int column_id)
+{
+	switch (column_id) {
+	case COL_FD:
+	case COL_INODE:
+	case COL_PID:
+	case COL_TID:
+	case COL_UID:
+	case COL_FUID:
+	case COL_SIZE:
+	case COL_NLINK:
+	case COL_DELETED:
+	case COL_KTHREAD:
+	case COL_MNT_ID:
+	case COL_POS:
+	case COL_MAPLEN:
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool file_get_num_column(int column_id, const void *data, unsigned long long *num)
+{
+	const struct file *file = data;
+	const struct proc *proc = file->proc;
+
+	switch (column_id) {
+	case COL_FD:
+		if (file->association < 0)
+			return false;
+		*num = file->association;
+		break;
+	case COL_INODE:
+		*num = file->stat.st_ino;
+		break;
+	case COL_PID:
+		*num = (int) proc->leader->pid;
+		break;
+	case COL_TID:
+		*num = (int) proc->pid;
+		break;
+	case COL_UID:
+		*num = (int) proc->uid;
+		break;
+	case COL_FUID:
+		*num = (int) file->stat.st_uid;
+		break;
+	case COL_SIZE:
+		*num = (uintmax_t) file->stat.st_size;
+		break;
+	case COL_NLINK:
+		*num = file->stat.st_nlink;
+		break;
+	case COL_DELETED:
+		*num = file->stat.st_nlink == 0;
+		break;
+	case COL_KTHREAD:
+		*num = proc->kthread;
+		break;
+	case COL_MNT_ID:
+		*num = file->association < 0 ? 0 : (int) file->mnt_id;
+		break;
+	case COL_POS:
+		*num = does_file_has_fdinfo_alike(file) ? file->pos : 0;
+		break;
+	case COL_MAPLEN:
+		if (file->association != -ASSOC_SHM
+		    && file->association != -ASSOC_MEM)
+			return false;
+		*num = get_map_length((struct file *) file);
+		break;
+	default:
+		return false;
+	}
+	return true;
+}
+
 static int file_handle_fdinfo(struct file *file, const char *key, const char* value)
 {
 	if (strcmp(key, "pos") == 0) {
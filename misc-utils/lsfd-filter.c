@@ -78,6 +78,7 @@ struct token_class {
 
 struct parameter {
 	struct libscols_column *cl;
+	bool typed;		/* the value is read by lsfd_filter->get_num() */
 	bool has_value;
 	union {
 		const char *str;
@@ -114,16 +115,12 @@ struct node {
 
 struct op1_class {
 	const char *name;
-	/* Return true if acceptable. */
-	bool (*is_acceptable)(struct node *, struct parameter *, struct libscols_line *);
 	/* Return true if o.k. */
 	bool (*check_type)(struct parser *, struct op1_class *, struct node *);
 };
 
 struct op2_class {
 	const char *name;
-	/* Return true if acceptable. */
-	bool (*is_acceptable)(struct node *, struct node *, struct parameter *, struct libscols_line *);
 	/* Return true if o.k. */
 	bool (*check_type)(struct parser *, struct op2_class *, struct node *, struct node *);
 };
@@ -159,11 +156,46 @@ struct node_class {
 	void (*dump)(struct node *, struct parameter*, int, FILE *);
 };
 
+/*
+ * The AST is compiled to a flat program for a simple stack machine of
+ * boolean values. The operands of comparisons are the leaf nodes of the
+ * AST, so the values of the parameters are read only once for a line.
+ */
+enum insn_type {
+	INSN_BOOL,		/* push the value of @left */
+	INSN_CMP,		/* push the result of @op applied to @left and @right */
+	INSN_NOT,		/* negate the value on the top */
+	INSN_EQ,		/* pop two values and push the result of comparison */
+	INSN_NE,
+	INSN_AND,		/* jump to @jump if the top is false, pop otherwise */
+	INSN_OR,		/* jump to @jump if the top is true, pop otherwise */
+};
+
+struct insn {
+	enum insn_type type;
+	enum op2_type op;
+	struct node *left;
+	struct node *right;
+	size_t jump;
+};
+
+struct program {
+	struct insn *insns;
+	size_t ninsns;
+	size_t depth;		/* the current stack depth while compiling */
+	size_t max_depth;
+};
+
 struct lsfd_filter {
 	struct libscols_table *table;
 	struct node  *node;
 	struct parameter *parameters;
 	int nparams;
+	int *used;		/* indexes of the referenced parameters */
+	int nused;
+	struct program prog;
+	bool *stack;
+	bool (*get_num)(int, const void *, unsigned long long *);
 	char errmsg[ERRMSG_LEN];
 };
 
@@ -172,7 +204,6 @@ struct lsfd_filter {
  */
 static struct node *node_val_new(enum node_type, int pindex);
 static void node_free (struct node *);
-static bool node_apply(struct node *, struct parameter *, struct libscols_line *);
 static void node_dump (struct node *, struct parameter *, int, FILE *);
 
 static struct token *token_new (void);
@@ -188,20 +219,8 @@ static void token_dump_num(struct token *, FILE *);
 static void token_dump_op1(struct token *, FILE *);
 static void token_dump_op2(struct token *, FILE *);
 
-static bool op1_not(struct node *, struct parameter*, struct libscols_line *);
 static bool op1_check_type_bool_or_op(struct parser *, struct op1_class *, struct node *);
 
-static bool op2_eq (struct node *, struct node *, struct parameter*, struct libscols_line *);
-static bool op2_ne (struct node *, struct node *, struct parameter*, struct libscols_line *);
-static bool op2_and(struct node *, struct node *, struct parameter*, struct libscols_line *);
-static bool op2_or (struct node *, struct node *, struct parameter*, struct libscols_line *);
-static bool op2_lt (struct node *, struct node *, struct parameter*, struct libscols_line *);
-static bool op2_le (struct node *, struct node *, struct parameter*, struct libscols_line *);
-static bool op2_gt (struct node *, struct node *, struct parameter*, struct libscols_line *);
-static bool op2_ge (struct node *, struct node *, struct parameter*, struct libscols_line *);
-static bool op2_re_match (struct node *, struct node *, struct parameter*, struct libscols_line *);
-static bool op2_re_unmatch (struct node *, struct node *, struct parameter*, struct libscols_line *);
-
 static bool op2_check_type_eq_or_bool_or_op(struct parser *, struct op2_class *, struct node *, struct node *);
 static bool op2_check_type_boolean_or_op   (struct parser *, struct op2_class *, struct node *, struct node *);
 static bool op2_check_type_num             (struct parser *, struct op2_class *, struct node *, struct node *);
@@ -269,7 +288,6 @@ static struct token_class token_classes [] = {
 static struct op1_class op1_classes [] = {
 	[OP1_NOT] = {
 		.name = "!",
-		.is_acceptable = op1_not,
 		.check_type = op1_check_type_bool_or_op,
 	},
 };
@@ -278,52 +296,42 @@ static struct op1_class op1_classes [] = {
 static struct op2_class op2_classes [] = {
 	[OP2_EQ] = {
 		.name = "==",
-		.is_acceptable = op2_eq,
 		.check_type = op2_check_type_eq_or_bool_or_op
 	},
 	[OP2_NE] = {
 		.name = "!=",
-		.is_acceptable = op2_ne,
 		.check_type = op2_check_type_eq_or_bool_or_op,
 	},
 	[OP2_AND] = {
 		.name = "&&",
-		.is_acceptable = op2_and,
 		.check_type = op2_check_type_boolean_or_op,
 	},
 	[OP2_OR] = {
 		.name = "||",
-		.is_acceptable = op2_or,
 		.check_type = op2_check_type_boolean_or_op,
 	},
 	[OP2_LT] = {
 		.name = "<",
-		.is_acceptable = op2_lt,
 		.check_type = op2_check_type_num,
 	},
 	[OP2_LE] = {
 		.name = "<=",
-		.is_acceptable = op2_le,
 		.check_type = op2_check_type_num,
 	},
 	[OP2_GT] = {
 		.name = ">",
-		.is_acceptable = op2_gt,
 		.check_type = op2_check_type_num,
 	},
 	[OP2_GE] = {
 		.name = ">=",
-		.is_acceptable = op2_ge,
 		.check_type = op2_check_type_num,
 	},
 	[OP2_RE_MATCH] = {
 		.name = "=~",
-		.is_acceptable = op2_re_match,
 		.check_type = op2_check_type_re,
 	},
 	[OP2_RE_UNMATCH] = {
 		.name = "!~",
-		.is_acceptable = op2_re_unmatch,
 		.check_type = op2_check_type_re,
 	},
 };
@@ -940,40 +948,6 @@ static void node_free(struct node *node)
 	free(node);
 }
 
-static bool node_apply(struct node *node, struct parameter *params, struct libscols_line *ln)
-{
-	if (!node)
-		return true;
-
-	switch (node->type) {
-	case NODE_OP1: {
-		struct node_op1 *node_op1 = (struct node_op1*)node;
-		return node_op1->opclass->is_acceptable(node_op1->arg, params, ln);
-	}
-	case NODE_OP2: {
-		struct node_op2 *node_op2 = (struct node_op2*)node;
-		return node_op2->opclass->is_acceptable(node_op2->args[0], node_op2->args[1], params, ln);
-	}
-	case NODE_BOOL:
-		if (PINDEX(node) < 0)
-			return VAL(node,boolean);
-
-		if (!params[PINDEX(node)].has_value) {
-			const char *data = scols_line_get_column_data(ln, params[PINDEX(node)].cl);
-			if (data == NULL)
-				return false;
-			params[PINDEX(node)].val.boolean = !*data ? false :
-				*data == '0' ? false :
-				*data == 'N' || *data == 'n' ? false : true;
-			params[PINDEX(node)].has_value = true;
-		}
-		return params[PINDEX(node)].val.boolean;
-	default:
-		warnx(_("unexpected type in filter application: %s"), NODE_CLASS(node)->name);
-		return false;
-	}
-}
-
 static void node_dump(struct node *node, struct parameter *param, int depth, FILE *stream)
 {
 	int i;
@@ -1060,11 +1034,6 @@ static void node_op2_free(struct node *node)
 		node_free(((struct node_op2 *)node)->args[i]);
 }
 
-static bool op1_not(struct node *node, struct parameter* params, struct libscols_line * ln)
-{
-	return !node_apply(node, params, ln);
-}
-
 static bool op1_check_type_bool_or_op(struct parser* parser, struct op1_class *op1_class,
 				      struct node *node)
 {
@@ -1078,114 +1047,6 @@ static bool op1_check_type_bool_or_op(struct parser* parser, struct op1_class *o
 	return true;
 }
 
-#define OP2_GET_STR(NODE,DEST) do {					\
-	int pindex = PINDEX(NODE);					\
-	if (pindex < 0)							\
-		DEST = VAL(NODE,str);					\
-	else {								\
-		struct parameter *p = params + pindex;			\
-		if (!p->has_value) {					\
-			p->val.str = scols_line_get_column_data(ln, p->cl); \
-			if (p->val.str == NULL) return false;		\
-			p->has_value = true;				\
-		}							\
-		DEST = p->val.str;					\
-	}								\
-} while(0)
-
-#define OP2_GET_NUM(NODE,DEST) do {					\
-	int pindex = PINDEX(NODE);					\
-	if (pindex < 0)							\
-		DEST = VAL(NODE,num);					\
-	else {								\
-		struct parameter *p = params + pindex;			\
-		if (!p->has_value) {					\
-			const char *tmp = scols_line_get_column_data(ln, p->cl); \
-			if (tmp == NULL) return false;			\
-			p->val.num = strtoull(tmp, NULL, 10);		\
-			p->has_value = true;				\
-		}							\
-		DEST = p->val.num;					\
-	}								\
-} while(0)
-
-#define OP2_EQ_BODY(OP,ELSEVAL) do {					\
-	if (left->type == NODE_STR) {					\
-		const char *lv, *rv;					\
-		OP2_GET_STR(left,lv);					\
-		OP2_GET_STR(right,rv);					\
-		return strcmp(lv, rv) OP 0;				\
-	} else if (left->type == NODE_NUM) {				\
-		unsigned long long lv, rv;				\
-		OP2_GET_NUM(left,lv);					\
-		OP2_GET_NUM(right,rv);					\
-		return lv OP rv;					\
-	} else {							\
-		return node_apply(left, params, ln) OP node_apply(right, params, ln); \
-	}								\
-} while(0)
-
-#define OP2_CMP_BODY(OP) do {		\
-	unsigned long long lv, rv;	\
-	OP2_GET_NUM(left,lv);		\
-	OP2_GET_NUM(right,rv);		\
-	return (lv OP rv);		\
-} while(0)
-static bool op2_eq(struct node *left, struct node *right, struct parameter *params, struct libscols_line *ln)
-{
-	OP2_EQ_BODY(==, false);
-}
-
-static bool op2_ne(struct node *left, struct node *right, struct parameter *params, struct libscols_line *ln)
-{
-	OP2_EQ_BODY(!=, true);
-}
-
-static bool op2_and(struct node *left, struct node *right, struct parameter *params, struct libscols_line *ln)
-{
-	return node_apply(left, params, ln) && node_apply(right, params, ln);
-}
-
-static bool op2_or(struct node *left, struct node *right, struct parameter *params, struct libscols_line *ln)
-{
-	return node_apply(left, params, ln) || node_apply(right, params, ln);
-}
-
-static bool op2_lt(struct node *left, struct node *right, struct parameter *params, struct libscols_line *ln)
-{
-	OP2_CMP_BODY(<);
-}
-
-static bool op2_le(struct node *left, struct node *right, struct parameter *params, struct libscols_line *ln)
-{
-	OP2_CMP_BODY(<=);
-}
-
-static bool op2_gt(struct node *left, struct node *right, struct parameter *params, struct libscols_line *ln)
-{
-	OP2_CMP_BODY(>);
-}
-
-static bool op2_ge(struct node *left, struct node *right, struct parameter *params, struct libscols_line *ln)
-{
-	OP2_CMP_BODY(>=);
-}
-
-static bool op2_re_match(struct node *left, struct node *right,
-			 struct parameter *params, struct libscols_line *ln)
-{
-	const char *str;
-	OP2_GET_STR(left, str);
-
-	return (regexec(&VAL(right,re), str, 0, NULL, 0) == 0);
-}
-
-static bool op2_re_unmatch(struct node *left, struct node *right,
-			 struct parameter *params, struct libscols_line *ln)
-{
-	return !op2_re_match(left, right, params, ln);
-}
-
 static bool op2_check_type_boolean_or_op(struct parser* parser, struct op2_class *op2_class,
 					 struct node *left, struct node *right)
 {
@@ -1289,6 +1150,327 @@ static bool op2_check_type_re(struct parser* parser, struct op2_class *op2_class
 	return true;
 }
 
+/*
+ * Compiler
+ */
+#define NODE_OP2_TYPE(NODE) ((enum op2_type)(((struct node_op2 *)(NODE))->opclass - op2_classes))
+
+/* An estimation of the evaluation costs; the cheaper operand of && and ||
+ * is evaluated first. */
+static int node_cost(struct node *node, struct parameter *params)
+{
+	struct node_op2 *op2;
+	int cost;
+
+	switch (node->type) {
+	case NODE_STR:
+	case NODE_NUM:
+	case NODE_BOOL:
+		if (PINDEX(node) < 0)
+			return 0;
+		return params[PINDEX(node)].typed ? 1 : 2;
+	case NODE_RE:
+		return 8;
+	case NODE_OP1:
+		return node_cost(((struct node_op1 *)node)->arg, params) + 1;
+	case NODE_OP2:
+		op2 = (struct node_op2 *)node;
+		cost = node_cost(op2->args[0], params) + node_cost(op2->args[1], params);
+		/* string comparison */
+		if (op2->args[0]->type == NODE_STR)
+			cost += 2;
+		return cost + 1;
+	}
+	return 0;
+}
+
+static size_t program_emit(struct program *prog, enum insn_type type,
+			   struct node *left, struct node *right)
+{
+	struct insn *insn;
+
+	prog->insns = xrealloc(prog->insns, (prog->ninsns + 1) * sizeof(struct insn));
+	insn = prog->insns + prog->ninsns;
+
+	insn->type = type;
+	insn->op = OP2_EQ;
+	insn->left = left;
+	insn->right = right;
+	insn->jump = 0;
+
+	switch (type) {
+	case INSN_BOOL:
+	case INSN_CMP:
+		prog->depth++;
+		if (prog->depth > prog->max_depth)
+			prog->max_depth = prog->depth;
+		break;
+	case INSN_EQ:
+	case INSN_NE:
+	case INSN_AND:	/* the right side replaces the left one */
+	case INSN_OR:
+		prog->depth--;
+		break;
+	case INSN_NOT:
+		break;
+	}
+	return prog->ninsns++;
+}
+
+static void program_compile(struct program *prog, struct node *node,
+			    struct parameter *params)
+{
+	struct node_op2 *op2;
+	struct node *first, *second;
+	enum op2_type op;
+	size_t i;
+
+	switch (node->type) {
+	case NODE_BOOL:
+		program_emit(prog, INSN_BOOL, node, NULL);
+		return;
+	case NODE_OP1:
+		program_compile(prog, ((struct node_op1 *)node)->arg, params);
+		program_emit(prog, INSN_NOT, NULL, NULL);
+		return;
+	case NODE_OP2:
+		break;
+	default:
+		/* rejected by the parser */
+		return;
+	}
+
+	op2 = (struct node_op2 *)node;
+	op = NODE_OP2_TYPE(node);
+
+	switch (op) {
+	case OP2_AND:
+	case OP2_OR:
+		/* There are no side effects, so the operands may be swapped. */
+		first = op2->args[0];
+		second = op2->args[1];
+		if (node_cost(second, params) < node_cost(first, params)) {
+			first = op2->args[1];
+			second = op2->args[0];
+		}
+		program_compile(prog, first, params);
+		i = program_emit(prog, op == OP2_AND ? INSN_AND : INSN_OR, NULL, NULL);
+		program_compile(prog, second, params);
+		prog->insns[i].jump = prog->ninsns;
+		return;
+	case OP2_EQ:
+	case OP2_NE:
+		if (op2->args[0]->type != NODE_STR && op2->args[0]->type != NODE_NUM) {
+			program_compile(prog, op2->args[0], params);
+			program_compile(prog, op2->args[1], params);
+			program_emit(prog, op == OP2_EQ ? INSN_EQ : INSN_NE, NULL, NULL);
+			return;
+		}
+		/* FALLTHROUGH */
+	default:
+		i = program_emit(prog, INSN_CMP, op2->args[0], op2->args[1]);
+		prog->insns[i].op = op;
+		return;
+	}
+}
+
+static void program_free(struct program *prog)
+{
+	free(prog->insns);
+	memset(prog, 0, sizeof(*prog));
+}
+
+/*
+ * Evaluation
+ */
+static bool filter_get_str(struct lsfd_filter *filter, struct node *node,
+			   struct libscols_line *ln, const char **str)
+{
+	struct parameter *p;
+
+	if (PINDEX(node) < 0) {
+		*str = VAL(node,str);
+		return true;
+	}
+
+	p = filter->parameters + PINDEX(node);
+	if (!p->has_value) {
+		p->val.str = scols_line_get_column_data(ln, p->cl);
+		if (p->val.str == NULL)
+			return false;
+		p->has_value = true;
+	}
+	*str = p->val.str;
+	return true;
+}
+
+static bool filter_get_num(struct lsfd_filter *filter, struct node *node,
+			   struct libscols_line *ln, const void *row,
+			   unsigned long long *num)
+{
+	struct parameter *p;
+
+	if (PINDEX(node) < 0) {
+		*num = VAL(node,num);
+		return true;
+	}
+
+	p = filter->parameters + PINDEX(node);
+	if (!p->has_value) {
+		if (p->typed && row) {
+			if (!filter->get_num(PINDEX(node), row, &p->val.num))
+				return false;
+		} else {
+			const char *tmp = scols_line_get_column_data(ln, p->cl);
+			if (tmp == NULL)
+				return false;
+			p->val.num = strtoull(tmp, NULL, 10);
+		}
+		p->has_value = true;
+	}
+	*num = p->val.num;
+	return true;
+}
+
+static bool filter_get_bool(struct lsfd_filter *filter, struct node *node,
+			    struct libscols_line *ln, const void *row)
+{
+	struct parameter *p;
+
+	if (PINDEX(node) < 0)
+		return VAL(node,boolean);
+
+	p = filter->parameters + PINDEX(node);
+	if (!p->has_value) {
+		if (p->typed && row) {
+			unsigned long long num;
+
+			if (!filter->get_num(PINDEX(node), row, &num))
+				return false;
+			p->val.boolean = num != 0;
+		} else {
+			const char *data = scols_line_get_column_data(ln, p->cl);
+			if (data == NULL)
+				return false;
+			p->val.boolean = !*data ? false :
+				*data == '0' ? false :
+				*data == 'N' || *data == 'n' ? false : true;
+		}
+		p->has_value = true;
+	}
+	return p->val.boolean;
+}
+
+static bool filter_cmp(struct lsfd_filter *filter, struct insn *insn,
+		       struct libscols_line *ln, const void *row)
+{
+	unsigned long long lnum, rnum;
+	const char *lstr, *rstr;
+
+	switch (insn->op) {
+	case OP2_RE_MATCH:
+	case OP2_RE_UNMATCH:
+		if (!filter_get_str(filter, insn->left, ln, &lstr))
+			return insn->op == OP2_RE_UNMATCH;
+		return (regexec(&VAL(insn->right,re), lstr, 0, NULL, 0) == 0)
+			== (insn->op == OP2_RE_MATCH);
+	case OP2_EQ:
+	case OP2_NE:
+		if (insn->left->type == NODE_STR) {
+			if (!filter_get_str(filter, insn->left, ln, &lstr)
+			    || !filter_get_str(filter, insn->right, ln, &rstr))
+				return false;
+			return (strcmp(lstr, rstr) == 0) == (insn->op == OP2_EQ);
+		}
+		/* FALLTHROUGH */
+	default:
+		break;
+	}
+
+	if (!filter_get_num(filter, insn->left, ln, row, &lnum)
+	    || !filter_get_num(filter, insn->right, ln, row, &rnum))
+		return false;
+
+	switch (insn->op) {
+	case OP2_EQ:
+		return lnum == rnum;
+	case OP2_NE:
+		return lnum != rnum;
+	case OP2_LT:
+		return lnum < rnum;
+	case OP2_LE:
+		return lnum <= rnum;
+	case OP2_GT:
+		return lnum > rnum;
+	case OP2_GE:
+		return lnum >= rnum;
+	default:
+		break;
+	}
+	return false;
+}
+
+static bool program_run(struct lsfd_filter *filter, struct libscols_line *ln,
+			const void *row)
+{
+	struct program *prog = &filter->prog;
+	bool *stack = filter->stack;
+	size_t pc = 0, sp = 0;
+
+	/* empty expression */
+	if (!prog->ninsns)
+		return true;
+
+	while (pc < prog->ninsns) {
+		struct insn *insn = prog->insns + pc++;
+
+		switch (insn->type) {
+		case INSN_BOOL:
+			stack[sp++] = filter_get_bool(filter, insn->left, ln, row);
+			break;
+		case INSN_CMP:
+			stack[sp++] = filter_cmp(filter, insn, ln, row);
+			break;
+		case INSN_NOT:
+			stack[sp - 1] = !stack[sp - 1];
+			break;
+		case INSN_EQ:
+			sp--;
+			stack[sp - 1] = stack[sp - 1] == stack[sp];
+			break;
+		case INSN_NE:
+			sp--;
+			stack[sp - 1] = stack[sp - 1] != stack[sp];
+			break;
+		case INSN_AND:
+			if (!stack[sp - 1])
+				pc = insn->jump;
+			else
+				sp--;
+			break;
+		case INSN_OR:
+			if (stack[sp - 1])
+				pc = insn->jump;
+			else
+				sp--;
+			break;
+		}
+	}
+
+	assert(sp == 1);
+	return stack[0];
+}
+
+static void filter_compile(struct lsfd_filter *filter)
+{
+	program_free(&filter->prog);
+	if (filter->node)
+		program_compile(&filter->prog, filter->node, filter->parameters);
+
+	free(filter->stack);
+	filter->stack = xcalloc(filter->prog.max_depth + 1, sizeof(bool));
+}
+
 struct lsfd_filter *lsfd_filter_new(const char *const expr, struct libscols_table *tb,
 				      int ncols,
 				      int (*column_name_to_id)(const char *, void *),
@@ -1307,7 +1489,7 @@ struct lsfd_filter *lsfd_filter_new(const char *const expr, struct libscols_tabl
 
 	node = dparser_compile(&parser);
 
-	filter = xmalloc(sizeof(struct lsfd_filter));
+	filter = xcalloc(1, sizeof(struct lsfd_filter));
 	filter->errmsg[0] = '\0';
 	if (GOT_ERROR(&parser)) {
 		strcpy(filter->errmsg, parser.errmsg);
@@ -1324,7 +1506,7 @@ struct lsfd_filter *lsfd_filter_new(const char *const expr, struct libscols_tabl
 			 _("error: garbage at the end of expression: %s"), parser.cursor);
 		return filter;
 	}
-	if (node->type == NODE_STR || node->type == NODE_NUM) {
+	if (node && (node->type == NODE_STR || node->type == NODE_NUM)) {
 		node_free(node);
 		snprintf(filter->errmsg, ERRMSG_LEN,
 			 _("error: bool expression is expected: %s"), expr);
@@ -1336,10 +1518,14 @@ struct lsfd_filter *lsfd_filter_new(const char *const expr, struct libscols_tabl
 	filter->node = node;
 	filter->parameters = parser.parameters;
 	filter->nparams = ncols;
+	filter->used = xcalloc(ncols, sizeof(int));
 	for (i = 0; i < filter->nparams; i++) {
-		if (filter->parameters[i].cl)
+		if (filter->parameters[i].cl) {
 			scols_ref_column(filter->parameters[i].cl);
+			filter->used[filter->nused++] = i;
+		}
 	}
+	filter_compile(filter);
 	return filter;
 }
 
@@ -1380,12 +1566,49 @@ void lsfd_filter_free(struct lsfd_filter *filter)
 		}
 		scols_unref_table(filter->table);
 		node_free(filter->node);
+		program_free(&filter->prog);
 	}
+	free(filter->stack);
+	free(filter->used);
 	free(filter->parameters);
 	free(filter);
 }
 
-bool lsfd_filter_apply(struct lsfd_filter *filter, struct libscols_line * ln)
+void lsfd_filter_set_num_getter(struct lsfd_filter *filter,
+				 bool (*has_num)(int),
+				 bool (*get_num)(int, const void *, unsigned long long *))
+{
+	int i;
+
+	if (!filter || GOT_ERROR(filter))
+		return;
+
+	filter->get_num = get_num;
+	for (i = 0; i < filter->nused; i++) {
+		struct parameter *p = filter->parameters + filter->used[i];
+		int jtype = scols_column_get_json_type(p->cl);
+
+		p->typed = get_num && has_num(filter->used[i])
+			&& (jtype == SCOLS_JSON_NUMBER || jtype == SCOLS_JSON_BOOLEAN);
+	}
+
+	/* the order of operands depends on the costs */
+	filter_compile(filter);
+}
+
+bool lsfd_filter_uses_column(struct lsfd_filter *filter, int col_id)
+{
+	if (!filter || GOT_ERROR(filter))
+		return false;
+	if (col_id < 0 || col_id >= filter->nparams)
+		return false;
+
+	return filter->parameters[col_id].cl != NULL
+		&& !filter->parameters[col_id].typed;
+}
+
+bool lsfd_filter_apply(struct lsfd_filter *filter, struct libscols_line *ln,
+		       const void *row)
 {
 	int i;
 
@@ -1395,8 +1618,8 @@ bool lsfd_filter_apply(struct lsfd_filter *filter, struct libscols_line * ln)
 	if (GOT_ERROR(filter))
 		return false;
 
-	for (i = 0; i < filter->nparams; i++)
-		filter->parameters[i].has_value = false;
+	for (i = 0; i < filter->nused; i++)
+		filter->parameters[filter->used[i]].has_value = false;
 
-	return node_apply(filter->node, filter->parameters, ln);
+	return program_run(filter, ln, row);
 }
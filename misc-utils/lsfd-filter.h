@@ -35,7 +35,31 @@ struct lsfd_filter *lsfd_filter_new(const char *const expr, struct libscols_tabl
  * lsfd_filter_new() is successful. */
 const char *lsfd_filter_get_errmsg(struct lsfd_filter *filter);
 void lsfd_filter_free(struct lsfd_filter *filter);
-bool lsfd_filter_apply(struct lsfd_filter *filter, struct libscols_line *ln);
+
+/*
+ * @row: data for the getter set by lsfd_filter_set_num_getter(), or NULL.
+ *
+ * If @row is NULL, all the values are read from @ln.
+ */
+bool lsfd_filter_apply(struct lsfd_filter *filter, struct libscols_line *ln,
+		       const void *row);
+
+/*
+ * @has_num: returns true if the value of the column can be read by @get_num.
+ * @get_num: reads the value of a number or boolean column from the row
+ *           passed to lsfd_filter_apply(); returns false if the row has
+ *           no value for the column.
+ *
+ * The values are read without converting them to and from strings.
+ */
+void lsfd_filter_set_num_getter(struct lsfd_filter *filter,
+				 bool (*has_num)(int col_id),
+				 bool (*get_num)(int col_id, const void *row, unsigned long long *num));
+
+/* Return true if the column @col_id is referenced in the expression and its
+ * value is read from the line. Only these columns have to be filled in
+ * before lsfd_filter_apply() is called with non-NULL row. */
+bool lsfd_filter_uses_column(struct lsfd_filter *filter, int col_id);
 
 /* Dumping AST. */
 void lsfd_filter_dump(struct lsfd_filter *filter, FILE *stream);
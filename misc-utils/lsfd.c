@@ -30,6 +30,7 @@
 #include <unistd.h>
 #include <getopt.h>
 #include <ctype.h>
+#include <pthread.h>		/* --jobs */
 
 #include <linux/sched.h>
 #include <sys/syscall.h>
@@ -75,6 +76,10 @@ struct nodev_table {
 	struct list_head tables[NODEV_TABLE_SIZE];
 } nodev_table;
 
+/* Protects nodev_table and mnt_namespaces when processes are read by
+ * more threads (--jobs). */
+static pthread_mutex_t nodev_lock = PTHREAD_MUTEX_INITIALIZER;
+
 struct name_manager {
 	struct idcache *cache;
 	unsigned long next_id;
@@ -279,6 +284,8 @@ struct lsfd_control {
 			threads : 1,
 			summary: 2;
 
+	unsigned int njobs;			/* number of threads to read /proc */
+
 	struct lsfd_filter *filter;
 	struct lsfd_counter **counters;		/* NULL terminated array. */
 };
@@ -818,20 +825,53 @@ static void fill_column(struct proc *proc,
 	}
 }
 
+/*
+ * The columns are filled in stages, so the work for the files rejected by
+ * the filter does not depend on the number of the output columns.
+ */
+enum {
+	FILL_FILTER,		/* columns referenced by the filter */
+	FILL_COUNTERS,		/* columns referenced by the counters */
+	FILL_OUTPUT,		/* the rest, needed only for the output */
+};
+
+static int column_fill_stage(struct lsfd_control *ctl, int column_id)
+{
+	struct lsfd_counter **counter;
+
+	if (lsfd_filter_uses_column(ctl->filter, column_id))
+		return FILL_FILTER;
+	if (ctl->counters) {
+		for (counter = ctl->counters; *counter; counter++)
+			if (lsfd_counter_uses_column(*counter, column_id))
+				return FILL_COUNTERS;
+	}
+	return FILL_OUTPUT;
+}
+
 static void convert_file(struct proc *proc,
 		     struct file *file,
-		     struct libscols_line *ln)
+		     struct libscols_line *ln,
+		     const int stages[],
+		     int stage)
 
 {
 	size_t i;
 
-	for (i = 0; i < ncolumns; i++)
-		fill_column(proc, file, ln, get_column_id(i), i);
+	for (i = 0; i < ncolumns; i++) {
+		if (stages[i] == stage)
+			fill_column(proc, file, ln, get_column_id(i), i);
+	}
 }
 
 static void convert(struct list_head *procs, struct lsfd_control *ctl)
 {
 	struct list_head *p;
+	int *stages = xcalloc(ncolumns ? ncolumns : 1, sizeof(int));
+	size_t i;
+
+	for (i = 0; i < ncolumns; i++)
+		stages[i] = column_fill_stage(ctl, get_column_id(i));
 
 	list_for_each (p, procs) {
 		struct proc *proc = list_entry(p, struct proc, procs);
@@ -845,20 +885,30 @@ static void convert(struct list_head *procs, struct lsfd_control *ctl)
 			if (!ln)
 				err(EXIT_FAILURE, _("failed to allocate output line"));
 
-			convert_file(proc, file, ln);
+			convert_file(proc, file, ln, stages, FILL_FILTER);
 
-			if (!lsfd_filter_apply(ctl->filter, ln)) {
+			if (!lsfd_filter_apply(ctl->filter, ln, file)) {
 				scols_table_remove_line(ctl->tb, ln);
 				continue;
 			}
 
-			if (!ctl->counters)
-				continue;
+			if (ctl->counters) {
+				convert_file(proc, file, ln, stages, FILL_COUNTERS);
+				for (counter = ctl->counters; *counter; counter++)
+					lsfd_counter_accumulate(*counter, ln, file);
+			}
+
+			/* the table is not printed for --summary=only */
+			if (!(ctl->summary & SUMMARY_ONLY))
+				convert_file(proc, file, ln, stages, FILL_OUTPUT);
 
-			for (counter = ctl->counters; *counter; counter++)
-				lsfd_counter_accumulate(*counter, ln);
+			if (scols_table_is_streaming(ctl->tb)
+			    && scols_table_stream_line(ctl->tb, ln) != 0)
+				err(EXIT_FAILURE, _("failed to print output line"));
 		}
 	}
+
+	free(stages);
 }
 
 static void delete(struct list_head *procs, struct lsfd_control *ctl)
@@ -877,7 +927,10 @@ static void delete(struct list_head *procs, struct lsfd_control *ctl)
 
 static void emit(struct lsfd_control *ctl)
 {
-	scols_print_table(ctl->tb);
+	if (scols_table_is_streaming(ctl->tb))
+		scols_table_stream_end(ctl->tb);
+	else
+		scols_print_table(ctl->tb);
 }
 
 
@@ -963,8 +1016,14 @@ unsigned long add_name(struct name_manager *nm, const char *name)
 	return e->id;
 }
 
+/*
+ * Reads the process @pid (and its threads if requested) and adds it to the
+ * @procs list. The only shared data modified here are the nodev table and
+ * the mnt namespaces set, so the function may be called from more threads,
+ * each with its own @pc.
+ */
 static void read_process(struct lsfd_control *ctl, struct path_cxt *pc,
-			 pid_t pid, struct proc *leader)
+			 pid_t pid, struct proc *leader, struct list_head *procs)
 {
 	char buf[BUFSIZ];
 	struct proc *proc;
@@ -1004,6 +1063,7 @@ static void read_process(struct lsfd_control *ctl, struct path_cxt *pc,
 
 	collect_namespace_files(pc, proc);
 
+	pthread_mutex_lock(&nodev_lock);
 	if (proc->ns_mnt == 0 || !has_mnt_ns(proc->ns_mnt)) {
 		FILE *mnt = ul_path_fopen(pc, "r", "mountinfo");
 		if (mnt) {
@@ -1013,6 +1073,7 @@ static void read_process(struct lsfd_control *ctl, struct path_cxt *pc,
 			fclose(mnt);
 		}
 	}
+	pthread_mutex_unlock(&nodev_lock);
 
 	/* If kcmp is not available,
 	 * there is no way to no whether threads share resources.
@@ -1027,7 +1088,7 @@ static void read_process(struct lsfd_control *ctl, struct path_cxt *pc,
 	    || kcmp(proc->leader->pid, proc->pid, KCMP_FILES, 0, 0) != 0)
 		collect_fd_files(pc, proc);
 
-	list_add_tail(&proc->procs, &ctl->procs);
+	list_add_tail(&proc->procs, procs);
 
 	/* The tasks collecting overwrites @pc by /proc/<task-pid>/. Keep it as
 	 * the last path based operation in read_process()
@@ -1039,7 +1100,7 @@ static void read_process(struct lsfd_control *ctl, struct path_cxt *pc,
 		while (procfs_process_next_tid(pc, &sub, &tid) == 0) {
 			if (tid == pid)
 				continue;
-			read_process(ctl, pc, tid, proc);
+			read_process(ctl, pc, tid, proc, procs);
 		}
 	}
 
@@ -1098,15 +1159,99 @@ static bool member_pids(const pid_t pid, const pid_t pids[], const int count)
 	return bsearch(&pid, pids, count, sizeof(pid_t), pidcmp)? true: false;
 }
 
+/*
+ * The processes for worker threads (--jobs). Every thread reads processes
+ * into the per-PID lists, the lists are joined in the /proc order when all
+ * threads are done, so the output is the same as for the serial read.
+ */
+struct proc_pool {
+	struct lsfd_control *ctl;
+	pid_t *pids;			/* PIDs in /proc order */
+	struct list_head *procs;	/* per-PID lists of the processes */
+	size_t npids;
+	size_t next;			/* the next PID to be read */
+	pthread_mutex_t lock;		/* protects @next */
+};
+
+static void *proc_worker(void *data)
+{
+	struct proc_pool *pool = data;
+	struct path_cxt *pc;
+
+	pc = ul_new_path(NULL);
+	if (!pc)
+		err(EXIT_FAILURE, _("failed to alloc procfs handler"));
+
+	while (1) {
+		size_t i;
+
+		pthread_mutex_lock(&pool->lock);
+		i = pool->next++;
+		pthread_mutex_unlock(&pool->lock);
+
+		if (i >= pool->npids)
+			break;
+		read_process(pool->ctl, pc, pool->pids[i], NULL, &pool->procs[i]);
+	}
+
+	ul_unref_path(pc);
+	return NULL;
+}
+
+static void collect_processes_parallel(struct lsfd_control *ctl,
+				       pid_t *pids, size_t npids)
+{
+	struct proc_pool pool = {
+		.ctl = ctl,
+		.pids = pids,
+		.npids = npids,
+		.lock = PTHREAD_MUTEX_INITIALIZER
+	};
+	pthread_t *threads;
+	size_t i, nthreads = 0;
+
+	pool.procs = xcalloc(npids ? npids : 1, sizeof(struct list_head));
+	for (i = 0; i < npids; i++)
+		INIT_LIST_HEAD(&pool.procs[i]);
+
+	threads = xcalloc(ctl->njobs, sizeof(pthread_t));
+
+	for (i = 0; i < ctl->njobs && i < npids; i++) {
+		if (pthread_create(&threads[nthreads], NULL, proc_worker, &pool) != 0) {
+			warn(_("cannot create thread"));
+			break;
+		}
+		nthreads++;
+	}
+
+	if (nthreads == 0)
+		/* fallback, use the main thread */
+		proc_worker(&pool);
+
+	for (i = 0; i < nthreads; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+
+	/* join the lists in the /proc order */
+	for (i = 0; i < npids; i++)
+		list_splice(&pool.procs[i], ctl->procs.prev);
+
+	free(pool.procs);
+}
+
 static void collect_processes(struct lsfd_control *ctl, const pid_t pids[], int n_pids)
 {
 	DIR *dir;
 	struct dirent *d;
 	struct path_cxt *pc = NULL;
+	pid_t *found = NULL;
+	size_t nfound = 0;
 
-	pc = ul_new_path(NULL);
-	if (!pc)
-		err(EXIT_FAILURE, _("failed to alloc procfs handler"));
+	if (ctl->njobs <= 1) {
+		pc = ul_new_path(NULL);
+		if (!pc)
+			err(EXIT_FAILURE, _("failed to alloc procfs handler"));
+	}
 
 	dir = opendir(_PATH_PROC);
 	if (!dir)
@@ -1117,12 +1262,24 @@ static void collect_processes(struct lsfd_control *ctl, const pid_t pids[], int
 
 		if (procfs_dirent_get_pid(d, &pid) != 0)
 			continue;
-		if (n_pids == 0 || member_pids(pid, pids, n_pids))
-			read_process(ctl, pc, pid, 0);
+		if (n_pids != 0 && !member_pids(pid, pids, n_pids))
+			continue;
+		if (pc) {
+			read_process(ctl, pc, pid, 0, &ctl->procs);
+			continue;
+		}
+		if ((nfound % 1024) == 0)
+			found = xrealloc(found, (nfound + 1024) * sizeof(pid_t));
+		found[nfound++] = pid;
 	}
 
 	closedir(dir);
-	ul_unref_path(pc);
+
+	if (pc)
+		ul_unref_path(pc);
+	else
+		collect_processes_parallel(ctl, found, nfound);
+	free(found);
 }
 
 static void __attribute__((__noreturn__)) usage(void)
@@ -1141,6 +1298,7 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(_(" -r, --raw             use raw output format\n"), out);
 	fputs(_(" -u, --notruncate      don't truncate text in columns\n"), out);
 	fputs(_(" -p, --pid  <pid(s)>   collect information only specified processes\n"), out);
+	fputs(_(" -j, --jobs <num>      number of threads to read /proc\n"), out);
 	fputs(_(" -Q, --filter <expr>   apply display filter\n"), out);
 	fputs(_("     --debug-filter    dump the innternal data structure of filter and exit\n"), out);
 	fputs(_(" -C, --counter <name>:<expr>\n"
@@ -1210,6 +1368,7 @@ static struct lsfd_filter *new_filter(const char *expr, bool debug, const char *
 	errmsg = lsfd_filter_get_errmsg(filter);
 	if (errmsg)
 		errx(EXIT_FAILURE, "%s%s", err_prefix, errmsg);
+	lsfd_filter_set_num_getter(filter, file_has_num_column, file_get_num_column);
 	if (debug) {
 		lsfd_filter_dump(filter, stdout);
 		exit(EXIT_SUCCESS);
@@ -1418,6 +1577,7 @@ int main(int argc, char *argv[])
 		{ "threads",    no_argument, NULL, 'l' },
 		{ "notruncate", no_argument, NULL, 'u' },
 		{ "pid",        required_argument, NULL, 'p' },
+		{ "jobs",       required_argument, NULL, 'j' },
 		{ "filter",     required_argument, NULL, 'Q' },
 		{ "debug-filter",no_argument, NULL, OPT_DEBUG_FILTER },
 		{ "summary",    optional_argument, NULL,  OPT_SUMMARY },
@@ -1431,7 +1591,7 @@ int main(int argc, char *argv[])
 	textdomain(PACKAGE);
 	close_stdout_atexit();
 
-	while ((c = getopt_long(argc, argv, "no:JrVhluQ:p:C:s", longopts, NULL)) != -1) {
+	while ((c = getopt_long(argc, argv, "no:JrVhluQ:p:j:C:s", longopts, NULL)) != -1) {
 		switch (c) {
 		case 'n':
 			ctl.noheadings = 1;
@@ -1454,6 +1614,9 @@ int main(int argc, char *argv[])
 		case 'p':
 			parse_pids(optarg, &pids, &n_pids);
 			break;
+		case 'j':
+			ctl.njobs = strtou32_or_err(optarg, _("invalid jobs argument"));
+			break;
 		case 'Q':
 			append_filter_expr(&filter_expr, optarg, true);
 			break;
@@ -1519,6 +1682,12 @@ int main(int argc, char *argv[])
 	if (ctl.json)
 		scols_table_set_name(ctl.tb, "lsfd");
 
+	/* the column widths are not used for raw and JSON output, so the lines
+	 * are printed as soon as they are converted */
+	if ((ctl.raw || ctl.json) && !(ctl.summary & SUMMARY_ONLY))
+		scols_table_enable_streaming(ctl.tb, 1);
+	scols_table_set_jobs(ctl.tb, ctl.njobs);
+
 	/* create output columns */
 	for (i = 0; i < ncolumns; i++) {
 		const struct colinfo *col = get_column_info(i);
@@ -140,6 +140,13 @@ struct file_class {
 
 extern const struct file_class file_class, cdev_class, bdev_class, sock_class, unkn_class, fifo_class;
 
+/*
+ * Values of the number and boolean columns for the filter, the same as
+ * printed by file_class.
+ */
+bool file_has_num_column(int column_id);
+bool file_get_num_column(int column_id, const void *file, unsigned long long *num);
+
 /*
  * Name managing
  */
@@ -40,7 +40,9 @@
 #include <string.h>
 #include <getopt.h>
 #include <sys/signalfd.h>
+#include <sys/mman.h>
 #include <poll.h>
+#include <time.h>
 
 #include "uuid.h"
 #include "uuidd.h"
@@ -71,6 +73,9 @@ enum {
 struct uuidd_cxt_t {
 	const char	*cleanup_pidfile;
 	const char	*cleanup_socket;
+	char		*cleanup_lease;
+	struct uuidd_lease_ring *lease;	/* shared-memory ring of time UUID leases */
+	uuidd_prot_num_t lease_size;	/* number of UUIDs in one lease */
 	uint32_t	timeout;
 	unsigned int	debug: 1,
 			quiet: 1,
@@ -99,6 +104,7 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(_(" -p, --pid <path>        path to pid file\n"), out);
 	fputs(_(" -s, --socket <path>     path to socket\n"), out);
 	fputs(_(" -T, --timeout <sec>     specify inactivity timeout\n"), out);
+	fputs(_(" -L, --lease <num>       lease time UUIDs to clients by shared memory\n"), out);
 	fputs(_(" -k, --kill              kill running daemon\n"), out);
 	fputs(_(" -r, --random            test random-based generation\n"), out);
 	fputs(_(" -t, --time              test time-based generation\n"), out);
@@ -301,12 +307,112 @@ static int create_socket(struct uuidd_cxt_t *uuidd_cxt,
 	return s;
 }
 
+/*
+ * Create the shared-memory ring of leases at @socket_path with
+ * UUIDD_LEASE_SUFFIX. The file is writable for the daemon group only, other
+ * clients use the socket.
+ */
+static void create_lease_ring(struct uuidd_cxt_t *uuidd_cxt, const char *socket_path)
+{
+	struct uuidd_lease_ring *r;
+	mode_t save_umask;
+	char *path;
+	int fd;
+
+	if (asprintf(&path, "%s%s", socket_path, UUIDD_LEASE_SUFFIX) < 0)
+		err(EXIT_FAILURE, _("cannot allocate memory"));
+
+	/* tell clients of the previous daemon that the old ring is dead */
+	fd = open(path, O_RDWR | O_CLOEXEC);
+	if (fd >= 0) {
+		r = mmap(NULL, sizeof(*r), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (r != MAP_FAILED) {
+			__atomic_store_n(&r->magic, 0, __ATOMIC_RELEASE);
+			munmap(r, sizeof(*r));
+		}
+		close(fd);
+	}
+	unlink(path);
+
+	save_umask = umask(0);
+	fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0660);
+	umask(save_umask);
+	if (fd < 0 || ftruncate(fd, sizeof(*r)) != 0) {
+		if (!uuidd_cxt->quiet)
+			warn(_("cannot create %s"), path);
+		exit(EXIT_FAILURE);
+	}
+	r = mmap(NULL, sizeof(*r), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (r == MAP_FAILED) {
+		if (!uuidd_cxt->quiet)
+			warn(_("cannot map %s"), path);
+		exit(EXIT_FAILURE);
+	}
+	close(fd);
+
+	r->nslots = UUIDD_LEASE_NSLOTS;
+	__atomic_store_n(&r->magic, UUIDD_LEASE_MAGIC, __ATOMIC_RELEASE);
+
+	uuidd_cxt->lease = r;
+	uuidd_cxt->cleanup_lease = path;
+}
+
+/*
+ * Reserve new leases for the empty, expired and reclaimed slots of the ring.
+ * A BUSY slot is reclaimed if the owner does not exist anymore (killed while
+ * reading the slot).
+ */
+static void refill_lease_ring(const struct uuidd_cxt_t *uuidd_cxt)
+{
+	struct uuidd_lease_ring *r = uuidd_cxt->lease;
+	uint32_t busy = UUIDD_LEASE_BUSY_BY(getpid());
+	time_t now = time(NULL);
+	size_t i, n = 0, nstale = 0;
+
+	for (i = 0; i < UUIDD_LEASE_NSLOTS; i++) {
+		struct uuidd_lease *l = &r->slots[i];
+		uint32_t state = __atomic_load_n(&l->state, __ATOMIC_ACQUIRE);
+		uuidd_prot_num_t num = uuidd_cxt->lease_size;
+
+		switch (UUIDD_LEASE_STATE(state)) {
+		case UUIDD_LEASE_BUSY:
+			if (kill(UUIDD_LEASE_OWNER(state), 0) == 0 || errno != ESRCH)
+				continue;	/* the client is reading the slot */
+			nstale++;
+			break;
+		case UUIDD_LEASE_READY:
+			if (l->created + UUIDD_LEASE_EXPIRE >= now)
+				continue;
+			break;
+		}
+		if (!__atomic_compare_exchange_n(&l->state, &state, busy,
+					0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			continue;
+
+		__uuid_generate_time(l->uuid, &num);
+		l->num = num;
+		l->created = now;
+		__atomic_store_n(&l->state, UUIDD_LEASE_READY, __ATOMIC_RELEASE);
+		n++;
+	}
+
+	if (nstale && uuidd_cxt->debug)
+		fprintf(stderr, P_("Reclaimed %zu stale slot\n", "Reclaimed %zu stale slots\n", nstale), nstale);
+	if (n && uuidd_cxt->debug)
+		fprintf(stderr, P_("Leased %zu slot\n", "Leased %zu slots\n", n), n);
+}
+
 static void __attribute__((__noreturn__)) all_done(const struct uuidd_cxt_t *uuidd_cxt, int ret)
 {
 	if (uuidd_cxt->cleanup_pidfile)
 		unlink(uuidd_cxt->cleanup_pidfile);
 	if (uuidd_cxt->cleanup_socket)
 		unlink(uuidd_cxt->cleanup_socket);
+	if (uuidd_cxt->cleanup_lease) {
+		/* the unused leases are lost, the time is already reserved */
+		__atomic_store_n(&uuidd_cxt->lease->magic, 0, __ATOMIC_RELEASE);
+		unlink(uuidd_cxt->cleanup_lease);
+	}
 	exit(ret);
 }
 
@@ -438,7 +544,15 @@ static void server_loop(const char *socket_path, const char *pidfile_path,
 	pfd[POLLFD_SOCKET].fd = s;
 	pfd[POLLFD_SIGNAL].events = pfd[POLLFD_SOCKET].events = POLLIN | POLLERR | POLLHUP;
 
+	if (uuidd_cxt->lease_size > 0)
+		create_lease_ring(uuidd_cxt, socket_path);
+
 	while (1) {
+		/* clients connect when the ring is empty, so refilling
+		 * after every request is enough */
+		if (uuidd_cxt->lease)
+			refill_lease_ring(uuidd_cxt);
+
 		ret = poll(pfd, ARRAY_SIZE(pfd),
 				uuidd_cxt->timeout ?
 					(int) uuidd_cxt->timeout * 1000 : -1);
@@ -571,6 +685,7 @@ static void parse_options(int argc, char **argv, struct uuidd_cxt_t *uuidd_cxt,
 		{"pid", required_argument, NULL, 'p'},
 		{"socket", required_argument, NULL, 's'},
 		{"timeout", required_argument, NULL, 'T'},
+		{"lease", required_argument, NULL, 'L'},
 		{"kill", no_argument, NULL, 'k'},
 		{"random", no_argument, NULL, 'r'},
 		{"time", no_argument, NULL, 't'},
@@ -593,7 +708,7 @@ static void parse_options(int argc, char **argv, struct uuidd_cxt_t *uuidd_cxt,
 	int excl_st[ARRAY_SIZE(excl)] = UL_EXCL_STATUS_INIT;
 	int c;
 
-	while ((c = getopt_long(argc, argv, "p:s:T:krtn:PFSdqVh", longopts, NULL)) != -1) {
+	while ((c = getopt_long(argc, argv, "p:s:T:L:krtn:PFSdqVh", longopts, NULL)) != -1) {
 		err_exclusive_options(c, longopts, excl, excl_st);
 		switch (c) {
 		case 'd':
@@ -642,6 +757,10 @@ static void parse_options(int argc, char **argv, struct uuidd_cxt_t *uuidd_cxt,
 			uuidd_cxt->timeout = strtou32_or_err(optarg,
 						_("failed to parse --timeout"));
 			break;
+		case 'L':
+			uuidd_cxt->lease_size = (uuidd_prot_num_t) strtou16_or_err(optarg,
+						_("failed to parse --lease"));
+			break;
 
 		case 'V':
 			print_version(EXIT_SUCCESS);
@@ -17,6 +17,11 @@
 #include "nls.h"
 #include "c.h"
 #include "closestream.h"
+#include "strutils.h"
+#include "xalloc.h"
+
+/* number of UUIDs generated and printed at once */
+#define UUIDGEN_BATCH	4096
 
 static void __attribute__((__noreturn__)) usage(void)
 {
@@ -37,6 +42,7 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(_(" -m, --md5           generate md5 hash\n"), out);
 	fputs(_(" -s, --sha1          generate sha1 hash\n"), out);
 	fputs(_(" -x, --hex           interpret name as hex string\n"), out);
+	fputs(_(" -C, --count num     generate more uuids in loop\n"), out);
 	fputs(USAGE_SEPARATOR, out);
 	printf(USAGE_HELP_OPTIONS(21));
 	printf(USAGE_MAN_TAIL("uuidgen(1)"));
@@ -79,15 +85,37 @@ badstring:
 	return value2;
 }
 
+static void generate_uuid(int do_type, uuid_t uu, const uuid_t ns,
+			  const char *name, size_t namelen)
+{
+	switch (do_type) {
+	case UUID_TYPE_DCE_TIME:
+		uuid_generate_time(uu);
+		break;
+	case UUID_TYPE_DCE_RANDOM:
+		uuid_generate_random(uu);
+		break;
+	case UUID_TYPE_DCE_MD5:
+		uuid_generate_md5(uu, ns, name, namelen);
+		break;
+	case UUID_TYPE_DCE_SHA1:
+		uuid_generate_sha1(uu, ns, name, namelen);
+		break;
+	default:
+		uuid_generate(uu);
+		break;
+	}
+}
+
 int
 main (int argc, char *argv[])
 {
 	int    c;
 	int    do_type = 0, is_hex = 0;
-	char   str[UUID_STR_LEN];
-	char   *namespace = NULL, *name = NULL;
-	size_t namelen = 0;
-	uuid_t ns, uu;
+	char   *namespace = NULL, *name = NULL, *buf;
+	size_t namelen = 0, n, i;
+	uint64_t count = 1;
+	uuid_t ns, *uus;
 
 	static const struct option longopts[] = {
 		{"random", no_argument, NULL, 'r'},
@@ -99,6 +127,7 @@ main (int argc, char *argv[])
 		{"md5", no_argument, NULL, 'm'},
 		{"sha1", no_argument, NULL, 's'},
 		{"hex", no_argument, NULL, 'x'},
+		{"count", required_argument, NULL, 'C'},
 		{NULL, 0, NULL, 0}
 	};
 
@@ -107,7 +136,7 @@ main (int argc, char *argv[])
 	textdomain(PACKAGE);
 	close_stdout_atexit();
 
-	while ((c = getopt_long(argc, argv, "rtVhn:N:msx", longopts, NULL)) != -1)
+	while ((c = getopt_long(argc, argv, "C:rtVhn:N:msx", longopts, NULL)) != -1)
 		switch (c) {
 		case 't':
 			do_type = UUID_TYPE_DCE_TIME;
@@ -130,6 +159,9 @@ main (int argc, char *argv[])
 		case 'x':
 			is_hex = 1;
 			break;
+		case 'C':
+			count = strtou64_or_err(optarg, _("invalid count argument"));
+			break;
 
 		case 'h':
 			usage();
@@ -165,15 +197,7 @@ main (int argc, char *argv[])
 			name = unhex(name, &namelen);
 	}
 
-	switch (do_type) {
-	case UUID_TYPE_DCE_TIME:
-		uuid_generate_time(uu);
-		break;
-	case UUID_TYPE_DCE_RANDOM:
-		uuid_generate_random(uu);
-		break;
-	case UUID_TYPE_DCE_MD5:
-	case UUID_TYPE_DCE_SHA1:
+	if (namespace) {
 		if (namespace[0] == '@' && namespace[1] != '\0') {
 			const uuid_t *uuidptr;
 
@@ -189,19 +213,30 @@ main (int argc, char *argv[])
 				errtryhelp(EXIT_FAILURE);
 			}
 		}
-		if (do_type == UUID_TYPE_DCE_MD5)
-			uuid_generate_md5(uu, ns, name, namelen);
-		else
-			uuid_generate_sha1(uu, ns, name, namelen);
-		break;
-	default:
-		uuid_generate(uu);
-		break;
 	}
 
-	uuid_unparse(uu, str);
+	n = count < UUIDGEN_BATCH ? count : UUIDGEN_BATCH;
+	uus = xmalloc(n * sizeof(uuid_t));
+	buf = xmalloc(n * UUID_STR_LEN);
+
+	while (count > 0) {
+		n = count < UUIDGEN_BATCH ? count : UUIDGEN_BATCH;
+
+		if (do_type == UUID_TYPE_DCE_RANDOM)
+			uuid_generate_random_many(uus, n);
+		else {
+			for (i = 0; i < n; i++)
+				generate_uuid(do_type, uus[i], ns, name, namelen);
+		}
+
+		uuid_unparse_many((const uuid_t *) uus, n, buf, '\n');
+		if (fwrite(buf, UUID_STR_LEN, n, stdout) != n)
+			err(EXIT_FAILURE, _("write failed"));
+		count -= n;
+	}
 
-	printf("%s\n", str);
+	free(uus);
+	free(buf);
 
 	if (is_hex)
 		free(name);
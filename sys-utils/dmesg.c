@@ -20,6 +20,7 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <poll.h>
 
 #include "c.h"
 #include "colors.h"
@@ -146,7 +147,8 @@ static const struct dmesg_name facility_names[] =
 enum {
 	DMESG_METHOD_KMSG,	/* read messages from /dev/kmsg (default) */
 	DMESG_METHOD_SYSLOG,	/* klogctl() buffer */
-	DMESG_METHOD_MMAP	/* mmap file with records (see --file) */
+	DMESG_METHOD_MMAP,	/* mmap file with records (see --file) */
+	DMESG_METHOD_ARCHIVE	/* binary archive (see --file and --write-archive) */
 };
 
 enum {
@@ -161,6 +163,74 @@ enum {
 };
 #define is_timefmt(c, f) ((c)->time_fmt == (DMESG_TIMEFTM_ ##f))
 
+/*
+ * Binary archive (see --write-archive)
+ *
+ * The archive is a header, blocks of records, an index with one entry for
+ * each block and a trailer at the end of the file. The index is written
+ * after the blocks, so it's possible to write the archive to a pipe. The
+ * reader uses the index to skip the blocks without any record accepted by
+ * --since, --until, --level and --facility. All numbers are little-endian.
+ */
+#define DMESG_ARCHIVE_MAGIC		"DMESGARC"
+#define DMESG_ARCHIVE_VERSION		1
+
+#define DMESG_ARCHIVE_BLOCK_RECORDS	256
+#define DMESG_ARCHIVE_BLOCK_SIZE	(64 * 1024)
+#define DMESG_ARCHIVE_NOVALUE		0xff	/* unknown level or facility */
+
+struct dmesg_archive_header {
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	reserved;
+	uint64_t	boot_usec;	/* boot time (usec since epoch) */
+} __attribute__((packed));
+
+/* followed by the message and terminating zero */
+struct dmesg_archive_record {
+	uint64_t	usec;		/* time since boot */
+	uint32_t	seqnum;		/* relative to the first record in the block */
+	uint8_t		level;
+	uint8_t		facility;
+	uint32_t	size;		/* message size without the zero */
+} __attribute__((packed));
+
+/* index entry */
+struct dmesg_archive_block {
+	uint64_t	offset;		/* offset of the first record */
+	uint32_t	size;		/* size of all records */
+	uint32_t	nrecords;
+	uint64_t	min_usec;	/* time range */
+	uint64_t	max_usec;
+	uint64_t	first_seqnum;
+	uint64_t	last_seqnum;
+	uint32_t	levels;		/* bitmap of levels in the block */
+	uint32_t	facilities;	/* bitmap of facilities in the block */
+} __attribute__((packed));
+
+struct dmesg_archive_trailer {
+	uint64_t	index_offset;
+	uint64_t	nrecords;
+	uint32_t	nblocks;
+	uint32_t	reserved;
+	char		magic[8];
+} __attribute__((packed));
+
+struct dmesg_archive {
+	FILE		*out;
+	const char	*filename;
+	uint64_t	offset;		/* already written bytes */
+	uint64_t	nrecords;
+
+	char		*blk;		/* records of the current block */
+	size_t		blksz;
+	size_t		blkalloc;
+	struct dmesg_archive_block cur;	/* the current block (host byte order) */
+
+	struct dmesg_archive_block *idx;	/* written blocks (host byte order) */
+	size_t		nblocks;
+};
+
 struct dmesg_control {
 	/* bit arrays -- see include/bitops.h */
 	char levels[ARRAY_SIZE(level_names) / NBBY + 1];
@@ -179,6 +249,14 @@ struct dmesg_control {
 	int		kmsg;		/* /dev/kmsg file descriptor */
 	ssize_t		kmsg_first_read;/* initial read() return code */
 	char		kmsg_buf[BUFSIZ];/* buffer to read kmsg data */
+	uint64_t	kmsg_seqnum;	/* expected sequence number of the next record */
+
+	/* per-second cache for time conversions, see record_localtime() */
+	time_t		cache_time;
+	struct tm	cache_tm;
+	time_t		cache_str_time;
+	char		cache_str[64];	/* record_ctime() or iso_8601_time() string */
+	char		*cache_usec;	/* microseconds in the ISO string */
 
 	time_t		since;		/* filter records by time */
 	time_t		until;		/* filter records by time */
@@ -191,6 +269,8 @@ struct dmesg_control {
 	char		*filename;
 	char		*mmap_buff;
 	size_t		pagesize;
+
+	struct dmesg_archive *archive;	/* --write-archive */
 	unsigned int	time_fmt;	/* time format */
 
 	unsigned int	follow:1,	/* wait for new messages */
@@ -202,8 +282,11 @@ struct dmesg_control {
 			decode:1,	/* use "facility: level: " prefix */
 			pager:1,	/* pipe output into a pager */
 			color:1,	/* colorize messages */
-			force_prefix:1;	/* force timestamp and decode prefix
+			force_prefix:1,	/* force timestamp and decode prefix
 					   on each line */
+			kmsg_seqnum_valid:1,	/* kmsg_seqnum is set */
+			cache_time_valid:1,	/* cache_time and cache_tm are set */
+			cache_str_valid:1;	/* cache_str_time and cache_str are set */
 	int		indent;		/* due to timestamps if newline */
 };
 
@@ -214,6 +297,7 @@ struct dmesg_record {
 	int		level;
 	int		facility;
 	struct timeval  tv;
+	uint64_t	seqnum;		/* kmsg sequence number */
 
 	const char	*next;		/* buffer with next unparsed record */
 	size_t		next_size;	/* size of the next buffer */
@@ -226,9 +310,11 @@ struct dmesg_record {
 		(_r)->level = -1; \
 		(_r)->tv.tv_sec = 0; \
 		(_r)->tv.tv_usec = 0; \
+		(_r)->seqnum = 0; \
 	} while (0)
 
 static int read_kmsg(struct dmesg_control *ctl);
+static int read_archive(struct dmesg_control *ctl);
 
 static int set_level_color(int log_level, const char *mesg, size_t mesgsz)
 {
@@ -308,6 +394,7 @@ static void __attribute__((__noreturn__)) usage(void)
 		"Suspending/resume will make ctime and iso timestamps inaccurate.\n"), out);
 	fputs(_("     --since <time>          display the lines since the specified time\n"), out);
 	fputs(_("     --until <time>          display the lines until the specified time\n"), out);
+	fputs(_("     --write-archive <file>  write the messages to a binary archive\n"), out);
 
 	fputs(USAGE_SEPARATOR, out);
 	printf(USAGE_HELP_OPTIONS(29));
@@ -600,6 +687,9 @@ static ssize_t read_buffer(struct dmesg_control *ctl, char **buf)
 		 */
 		n = read_kmsg(ctl);
 		break;
+	case DMESG_METHOD_ARCHIVE:
+		n = read_archive(ctl);
+		break;
 	default:
 		abort();	/* impossible method -> drop core */
 	}
@@ -622,6 +712,11 @@ static int fwrite_hex(const char *buf, size_t size, FILE *out)
 /*
  * Prints to 'out' and non-printable chars are replaced with \x<hex> sequences.
  */
+static inline int is_plain_char(const char *p)
+{
+	return *p >= 0x20 && *p <= 0x7e;
+}
+
 static void safe_fwrite(struct dmesg_control *ctl, const char *buf, size_t size, int indent, FILE *out)
 {
 	size_t i;
@@ -635,6 +730,16 @@ static void safe_fwrite(struct dmesg_control *ctl, const char *buf, size_t size,
 		int rc, hex = 0;
 		size_t len = 1;
 
+		/* printable ASCII does not need any conversion, write all
+		 * the chars at once */
+		if (is_plain_char(p)) {
+			while (i + len < size && is_plain_char(p + len))
+				len++;
+			i += len - 1;
+			rc = fwrite(p, 1, len, out) != len;
+			goto done;
+		}
+
 		if (!ctl->noesc) {
 			if (*p == '\0') {
 				hex = 1;
@@ -673,7 +778,7 @@ doprint:
 				rc |= 1;
 		} else
 			rc = fwrite(p, 1, len, out) != len;
-
+done:
 		if (rc != 0) {
 			if (errno != EPIPE)
 				err(EXIT_FAILURE, _("write failed"));
@@ -742,7 +847,8 @@ static int get_next_syslog_record(struct dmesg_control *ctl,
 			continue;	/* error or empty line? */
 
 		if (*begin == '<') {
-			if (ctl->fltr_lev || ctl->fltr_fac || ctl->decode || ctl->color)
+			if (ctl->fltr_lev || ctl->fltr_fac || ctl->decode ||
+			    ctl->color || ctl->archive)
 				begin = parse_faclev(begin + 1, &rec->facility,
 						     &rec->level);
 			else
@@ -752,7 +858,7 @@ static int get_next_syslog_record(struct dmesg_control *ctl,
 		if (*begin == '[' && (*(begin + 1) == ' ' ||
 				      isdigit(*(begin + 1)))) {
 
-			if (!is_timefmt(ctl, NONE))
+			if (!is_timefmt(ctl, NONE) || ctl->archive)
 				begin = parse_syslog_timestamp(begin + 1, &rec->tv);
 			else
 				begin = skip_item(begin, end, "]");
@@ -833,12 +939,24 @@ static void raw_print(struct dmesg_control *ctl, const char *buf, size_t size)
 		putchar('\n');
 }
 
+/*
+ * The records are usually in the same second as the previous record, so the
+ * last localtime_r() result is cached.
+ */
 static struct tm *record_localtime(struct dmesg_control *ctl,
 				   struct dmesg_record *rec,
 				   struct tm *tm)
 {
 	time_t t = record_time(ctl, rec);
-	return localtime_r(&t, tm);
+
+	if (!ctl->cache_time_valid || ctl->cache_time != t) {
+		if (!localtime_r(&t, &ctl->cache_tm))
+			return NULL;
+		ctl->cache_time = t;
+		ctl->cache_time_valid = 1;
+	}
+	*tm = ctl->cache_tm;
+	return tm;
 }
 
 static char *record_ctime(struct dmesg_control *ctl,
@@ -846,6 +964,12 @@ static char *record_ctime(struct dmesg_control *ctl,
 			  char *buf, size_t bufsiz)
 {
 	struct tm tm;
+	time_t t = record_time(ctl, rec);
+
+	if (ctl->cache_str_valid && ctl->cache_str_time == t) {
+		xstrncpy(buf, ctl->cache_str, bufsiz);
+		return buf;
+	}
 
 	record_localtime(ctl, rec, &tm);
 
@@ -855,6 +979,10 @@ static char *record_ctime(struct dmesg_control *ctl,
 	   proper month/day order here */
 	if (strftime(buf, bufsiz, _("%a %b %e %H:%M:%S %Y"), &tm) == 0)
 		*buf = '\0';
+
+	xstrncpy(ctl->cache_str, buf, sizeof(ctl->cache_str));
+	ctl->cache_str_time = t;
+	ctl->cache_str_valid = 1;
 	return buf;
 }
 
@@ -868,6 +996,10 @@ static char *short_ctime(struct tm *tm, char *buf, size_t bufsiz)
 	return buf;
 }
 
+/*
+ * The string is cached for the last second, only the microseconds are
+ * updated for the next records in the same second.
+ */
 static char *iso_8601_time(struct dmesg_control *ctl, struct dmesg_record *rec,
 			   char *buf, size_t bufsz)
 {
@@ -876,9 +1008,29 @@ static char *iso_8601_time(struct dmesg_control *ctl, struct dmesg_record *rec,
 		.tv_usec = rec->tv.tv_usec
 	};
 
+	if (ctl->cache_str_valid && ctl->cache_str_time == tv.tv_sec
+	    && ctl->cache_usec) {
+		char usec[7];
+
+		snprintf(usec, sizeof(usec), "%06ld", (long) tv.tv_usec);
+		memcpy(ctl->cache_usec, usec, 6);
+		xstrncpy(buf, ctl->cache_str, bufsz);
+		return buf;
+	}
+
 	if (strtimeval_iso(&tv,	ISO_TIMESTAMP_COMMA_T, buf, bufsz) != 0)
 		return NULL;
 
+	xstrncpy(ctl->cache_str, buf, sizeof(ctl->cache_str));
+	ctl->cache_str_time = tv.tv_sec;
+	ctl->cache_str_valid = 1;
+
+	/* the time is followed by ",<usec>" */
+	ctl->cache_usec = strchr(ctl->cache_str, ',');
+	if (ctl->cache_usec && strlen(ctl->cache_usec) > 6)
+		ctl->cache_usec++;
+	else
+		ctl->cache_usec = NULL;
 	return buf;
 }
 
@@ -913,6 +1065,157 @@ static const char *get_subsys_delimiter(const char *mesg, size_t mesg_size)
 	return NULL;
 }
 
+static void archive_write(struct dmesg_archive *ar, const void *buf, size_t sz)
+{
+	if (fwrite(buf, 1, sz, ar->out) != sz)
+		err(EXIT_FAILURE, _("write failed: %s"), ar->filename);
+	ar->offset += sz;
+}
+
+static void archive_open(struct dmesg_control *ctl, const char *filename)
+{
+	struct dmesg_archive *ar = xcalloc(1, sizeof(*ar));
+
+	if (strcmp(filename, "-") == 0)
+		ar->out = stdout;
+	else {
+		ar->out = fopen(filename, "w" UL_CLOEXECSTR);
+		if (!ar->out)
+			err(EXIT_FAILURE, _("cannot open %s"), filename);
+	}
+	ar->filename = filename;
+	ctl->archive = ar;
+}
+
+/* the header is written with the first record, the boot time may be read
+ * from the source archive */
+static void archive_write_header(struct dmesg_control *ctl)
+{
+	struct dmesg_archive_header hdr = {
+		.version = htole32(DMESG_ARCHIVE_VERSION),
+		.boot_usec = htole64((uint64_t) (ctl->boot_time.tv_sec
+						 + ctl->suspended_time) * 1000000
+				     + ctl->boot_time.tv_usec)
+	};
+
+	memcpy(hdr.magic, DMESG_ARCHIVE_MAGIC, sizeof(hdr.magic));
+	archive_write(ctl->archive, &hdr, sizeof(hdr));
+}
+
+static void archive_flush_block(struct dmesg_archive *ar)
+{
+	if (!ar->cur.nrecords)
+		return;
+
+	ar->cur.offset = ar->offset;
+	ar->cur.size = ar->blksz;
+	archive_write(ar, ar->blk, ar->blksz);
+
+	if (ar->nblocks % 64 == 0)
+		ar->idx = xrealloc(ar->idx, (ar->nblocks + 64) * sizeof(*ar->idx));
+	ar->idx[ar->nblocks++] = ar->cur;
+
+	memset(&ar->cur, 0, sizeof(ar->cur));
+	ar->blksz = 0;
+}
+
+static void archive_add_record(struct dmesg_control *ctl, struct dmesg_record *rec)
+{
+	struct dmesg_archive *ar = ctl->archive;
+	struct dmesg_archive_block *b = &ar->cur;
+	struct dmesg_archive_record r = { .size = 0 };
+	uint64_t usec = (uint64_t) rec->tv.tv_sec * 1000000 + rec->tv.tv_usec;
+	uint64_t seqnum = rec->seqnum;
+	size_t sz = sizeof(r) + rec->mesg_size + 1;
+
+	if (!ar->offset)
+		archive_write_header(ctl);
+
+	/* only kmsg records have sequence numbers */
+	if (ctl->method != DMESG_METHOD_KMSG && ctl->method != DMESG_METHOD_ARCHIVE)
+		seqnum = ar->nrecords;
+
+	/* the relative sequence number has to fit into the record */
+	if (b->nrecords && (seqnum < b->first_seqnum
+			    || seqnum - b->first_seqnum > UINT32_MAX))
+		archive_flush_block(ar);
+
+	if (!b->nrecords || usec < b->min_usec)
+		b->min_usec = usec;
+	if (!b->nrecords || usec > b->max_usec)
+		b->max_usec = usec;
+	if (!b->nrecords)
+		b->first_seqnum = seqnum;
+	b->last_seqnum = seqnum;
+	if (rec->level >= 0 && rec->level < 32)
+		b->levels |= 1U << rec->level;
+	if (rec->facility >= 0 && rec->facility < 32)
+		b->facilities |= 1U << rec->facility;
+	b->nrecords++;
+
+	r.usec = htole64(usec);
+	r.seqnum = htole32(seqnum - b->first_seqnum);
+	r.level = rec->level >= 0 ? rec->level : DMESG_ARCHIVE_NOVALUE;
+	r.facility = rec->facility >= 0 ? rec->facility : DMESG_ARCHIVE_NOVALUE;
+	r.size = htole32(rec->mesg_size);
+
+	if (ar->blksz + sz > ar->blkalloc) {
+		ar->blkalloc = max(ar->blksz + sz, (size_t) DMESG_ARCHIVE_BLOCK_SIZE * 2);
+		ar->blk = xrealloc(ar->blk, ar->blkalloc);
+	}
+	memcpy(ar->blk + ar->blksz, &r, sizeof(r));
+	if (rec->mesg_size)
+		memcpy(ar->blk + ar->blksz + sizeof(r), rec->mesg, rec->mesg_size);
+	ar->blk[ar->blksz + sz - 1] = '\0';
+	ar->blksz += sz;
+	ar->nrecords++;
+
+	if (b->nrecords >= DMESG_ARCHIVE_BLOCK_RECORDS
+	    || ar->blksz >= DMESG_ARCHIVE_BLOCK_SIZE)
+		archive_flush_block(ar);
+}
+
+static void archive_close(struct dmesg_control *ctl)
+{
+	struct dmesg_archive *ar = ctl->archive;
+	struct dmesg_archive_trailer tr = { .reserved = 0 };
+	size_t i;
+
+	if (!ar->offset)
+		archive_write_header(ctl);
+	archive_flush_block(ar);
+
+	tr.index_offset = htole64(ar->offset);
+	tr.nrecords = htole64(ar->nrecords);
+	tr.nblocks = htole32(ar->nblocks);
+	memcpy(tr.magic, DMESG_ARCHIVE_MAGIC, sizeof(tr.magic));
+
+	for (i = 0; i < ar->nblocks; i++) {
+		struct dmesg_archive_block *b = &ar->idx[i];
+
+		b->offset = htole64(b->offset);
+		b->size = htole32(b->size);
+		b->nrecords = htole32(b->nrecords);
+		b->min_usec = htole64(b->min_usec);
+		b->max_usec = htole64(b->max_usec);
+		b->first_seqnum = htole64(b->first_seqnum);
+		b->last_seqnum = htole64(b->last_seqnum);
+		b->levels = htole32(b->levels);
+		b->facilities = htole32(b->facilities);
+	}
+	if (ar->nblocks)
+		archive_write(ar, ar->idx, ar->nblocks * sizeof(*ar->idx));
+	archive_write(ar, &tr, sizeof(tr));
+
+	if (ar->out != stdout && close_stream(ar->out) != 0)
+		err(EXIT_FAILURE, _("write failed: %s"), ar->filename);
+
+	free(ar->blk);
+	free(ar->idx);
+	free(ar);
+	ctl->archive = NULL;
+}
+
 static void print_record(struct dmesg_control *ctl,
 			 struct dmesg_record *rec)
 {
@@ -927,6 +1230,11 @@ static void print_record(struct dmesg_control *ctl,
 	if (!accept_record(ctl, rec))
 		return;
 
+	if (ctl->archive) {
+		archive_add_record(ctl, rec);
+		return;
+	}
+
 	if (!rec->mesg_size) {
 		putchar('\n');
 		return;
@@ -937,9 +1245,12 @@ static void print_record(struct dmesg_control *ctl,
 	 * backward compatibility with syslog(2) buffers only
 	 */
 	if (ctl->raw) {
+		/* rec->facility is not shifted, see parse_faclev() */
+		int pri = rec->facility < 0 || rec->level < 0 ? -1 :
+				(rec->facility << 3) | rec->level;
+
 		ctl->indent = snprintf(tsbuf, sizeof(tsbuf),
-				       "<%d>[%5ld.%06ld] ",
-				       LOG_MAKEPRI(rec->facility, rec->level),
+				       "<%d>[%5ld.%06ld] ", pri,
 				       (long) rec->tv.tv_sec,
 				       (long) rec->tv.tv_usec);
 		goto full_output;
@@ -1117,27 +1428,33 @@ static void print_buffer(struct dmesg_control *ctl,
 		print_record(ctl, &rec);
 }
 
+/*
+ * Returns size of the record or -errno.
+ */
 static ssize_t read_kmsg_one(struct dmesg_control *ctl)
 {
 	ssize_t size;
 
-	/* kmsg returns EPIPE if record was modified while reading */
+	/* kmsg returns EPIPE if the record was overwritten before we read
+	 * it; the next read() returns the oldest available record and the
+	 * lost records are reported by the sequence numbers gap */
 	do {
 		size = read(ctl->kmsg, ctl->kmsg_buf,
 			    sizeof(ctl->kmsg_buf) - 1);
-	} while (size < 0 && errno == EPIPE);
+	} while (size < 0 && (errno == EPIPE || errno == EINTR));
 
-	return size;
+	return size < 0 ? -errno : size;
 }
 
+/*
+ * The file descriptor is always non-blocking. In follow mode the stdout is
+ * flushed and poll() is used to wait when all available records are
+ * processed, so the output is written in large chunks when the kernel
+ * produces many messages.
+ */
 static int init_kmsg(struct dmesg_control *ctl)
 {
-	int mode = O_RDONLY;
-
-	if (!ctl->follow)
-		mode |= O_NONBLOCK;
-	else
-		setlinebuf(stdout);
+	int mode = O_RDONLY | O_NONBLOCK;
 
 	ctl->kmsg = open("/dev/kmsg", mode);
 	if (ctl->kmsg < 0)
@@ -1159,7 +1476,8 @@ static int init_kmsg(struct dmesg_control *ctl)
 	 * read_kmsg().
 	 */
 	ctl->kmsg_first_read = read_kmsg_one(ctl);
-	if (ctl->kmsg_first_read < 0) {
+	if (ctl->kmsg_first_read < 0
+	    && !(ctl->follow && ctl->kmsg_first_read == -EAGAIN)) {
 		close(ctl->kmsg);
 		ctl->kmsg = -1;
 		return -1;
@@ -1199,7 +1517,7 @@ static int parse_kmsg_record(struct dmesg_control *ctl,
 
 	/* A) priority and facility */
 	if (ctl->fltr_lev || ctl->fltr_fac || ctl->decode ||
-	    ctl->raw || ctl->color)
+	    ctl->raw || ctl->color || ctl->archive)
 		p = parse_faclev(p, &rec->facility, &rec->level);
 	else
 		p = skip_item(p, end, ",");
@@ -1207,12 +1525,13 @@ static int parse_kmsg_record(struct dmesg_control *ctl,
 		goto mesg;
 
 	/* B) sequence number */
+	rec->seqnum = strtoumax(p, NULL, 10);
 	p = skip_item(p, end, ",;");
 	if (LAST_KMSG_FIELD(p))
 		goto mesg;
 
 	/* C) timestamp */
-	if (is_timefmt(ctl, NONE))
+	if (is_timefmt(ctl, NONE) && !ctl->archive)
 		p = skip_item(p, end, ",;");
 	else
 		p = parse_kmsg_timestamp(p, &rec->tv);
@@ -1255,6 +1574,22 @@ mesg:
 	return 0;
 }
 
+/*
+ * Reports records overwritten in the kernel ring buffer before we read them.
+ */
+static void check_kmsg_seqnum(struct dmesg_control *ctl, struct dmesg_record *rec)
+{
+	if (ctl->kmsg_seqnum_valid && rec->seqnum > ctl->kmsg_seqnum) {
+		fflush(stdout);		/* keep the order with stdout */
+		warnx(_("%ju kernel messages lost (sequence numbers %ju-%ju)"),
+			(uintmax_t) (rec->seqnum - ctl->kmsg_seqnum),
+			(uintmax_t) ctl->kmsg_seqnum,
+			(uintmax_t) rec->seqnum - 1);
+	}
+	ctl->kmsg_seqnum = rec->seqnum + 1;
+	ctl->kmsg_seqnum_valid = 1;
+}
+
 /*
  * Note that each read() call for /dev/kmsg returns always one record. It means
  * that we don't have to read whole message buffer before the records parsing.
@@ -1279,12 +1614,32 @@ static int read_kmsg(struct dmesg_control *ctl)
 	 */
 	sz = ctl->kmsg_first_read;
 
-	while (sz > 0) {
-		*(ctl->kmsg_buf + sz) = '\0';	/* for debug messages */
+	while (1) {
+		struct pollfd fds = { .fd = ctl->kmsg, .events = POLLIN };
 
-		if (parse_kmsg_record(ctl, &rec,
-				      ctl->kmsg_buf, (size_t) sz) == 0)
-			print_record(ctl, &rec);
+		while (sz > 0) {
+			*(ctl->kmsg_buf + sz) = '\0';	/* for debug messages */
+
+			if (parse_kmsg_record(ctl, &rec,
+					      ctl->kmsg_buf, (size_t) sz) == 0) {
+				check_kmsg_seqnum(ctl, &rec);
+				print_record(ctl, &rec);
+			}
+
+			sz = read_kmsg_one(ctl);
+		}
+
+		if (!ctl->follow || sz != -EAGAIN)
+			break;
+
+		/* all available records processed, wait for more */
+		if (fflush(stdout) != 0) {
+			if (errno != EPIPE)
+				err(EXIT_FAILURE, _("write failed"));
+			exit(EXIT_SUCCESS);
+		}
+		if (poll(&fds, 1, -1) < 0 && errno != EINTR)
+			break;
 
 		sz = read_kmsg_one(ctl);
 	}
@@ -1292,6 +1647,172 @@ static int read_kmsg(struct dmesg_control *ctl)
 	return 0;
 }
 
+static int is_archive_file(const char *filename)
+{
+	char magic[sizeof(DMESG_ARCHIVE_MAGIC) - 1];
+	int fd, rc = 0;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return 0;
+	if (read_all(fd, magic, sizeof(magic)) == sizeof(magic)
+	    && memcmp(magic, DMESG_ARCHIVE_MAGIC, sizeof(magic)) == 0)
+		rc = 1;
+	close(fd);
+	return rc;
+}
+
+static uint32_t bitarray_to_mask(const char *ary, size_t nbits)
+{
+	uint32_t mask = 0;
+	size_t i;
+
+	for (i = 0; i < nbits && i < 32; i++) {
+		if (isset(ary, i))
+			mask |= 1U << i;
+	}
+	return mask;
+}
+
+/*
+ * Returns 1 if the block may contain a record accepted by accept_record().
+ */
+static int archive_block_accepted(struct dmesg_control *ctl,
+				  struct dmesg_archive_block *b,
+				  uint32_t levels, uint32_t facilities)
+{
+	time_t boot = ctl->boot_time.tv_sec + ctl->suspended_time;
+
+	if (ctl->fltr_lev && !(b->levels & levels))
+		return 0;
+	if (ctl->fltr_fac && !(b->facilities & facilities))
+		return 0;
+	if (ctl->since && ctl->since >= boot + (time_t) (b->max_usec / 1000000))
+		return 0;
+	if (ctl->until && ctl->until <= boot + (time_t) (b->min_usec / 1000000))
+		return 0;
+	return 1;
+}
+
+/*
+ * Reads records from the binary archive. The file is mapped and only the
+ * blocks accepted by the index are accessed.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+static int read_archive(struct dmesg_control *ctl)
+{
+	struct dmesg_archive_header hdr;
+	struct dmesg_archive_trailer tr;
+	struct stat st;
+	const char *map, *idx;
+	uint64_t idxoff, boot;
+	uint32_t levels, facilities;
+	size_t i, nblocks;
+	int fd;
+
+	if (ctl->method != DMESG_METHOD_ARCHIVE || !ctl->filename)
+		return -1;
+
+	fd = open(ctl->filename, O_RDONLY);
+	if (fd < 0)
+		err(EXIT_FAILURE, _("cannot open %s"), ctl->filename);
+	if (fstat(fd, &st))
+		err(EXIT_FAILURE, _("stat of %s failed"), ctl->filename);
+	if ((size_t) st.st_size < sizeof(hdr) + sizeof(tr))
+		goto corrupted;
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED)
+		err(EXIT_FAILURE, _("cannot mmap: %s"), ctl->filename);
+	close(fd);
+
+	memcpy(&hdr, map, sizeof(hdr));
+	memcpy(&tr, map + st.st_size - sizeof(tr), sizeof(tr));
+
+	if (memcmp(tr.magic, DMESG_ARCHIVE_MAGIC, sizeof(tr.magic)) != 0)
+		goto corrupted;
+	if (le32toh(hdr.version) != DMESG_ARCHIVE_VERSION)
+		errx(EXIT_FAILURE, _("%s: unsupported archive version"), ctl->filename);
+
+	idxoff = le64toh(tr.index_offset);
+	nblocks = le32toh(tr.nblocks);
+	if (idxoff < sizeof(hdr) || idxoff > st.st_size - sizeof(tr)
+	    || nblocks > (st.st_size - sizeof(tr) - idxoff) / sizeof(struct dmesg_archive_block))
+		goto corrupted;
+
+	/* the timestamps are relative to the boot of the archived system */
+	boot = le64toh(hdr.boot_usec);
+	ctl->boot_time.tv_sec = boot / 1000000;
+	ctl->boot_time.tv_usec = boot % 1000000;
+	ctl->suspended_time = 0;
+
+	levels = bitarray_to_mask(ctl->levels, ARRAY_SIZE(level_names));
+	facilities = bitarray_to_mask(ctl->facilities, ARRAY_SIZE(facility_names));
+
+	idx = map + idxoff;
+	for (i = 0; i < nblocks; i++) {
+		struct dmesg_archive_block b;
+		const char *p, *end;
+		size_t n;
+
+		memcpy(&b, idx + i * sizeof(b), sizeof(b));
+		b.offset = le64toh(b.offset);
+		b.size = le32toh(b.size);
+		b.nrecords = le32toh(b.nrecords);
+		b.min_usec = le64toh(b.min_usec);
+		b.max_usec = le64toh(b.max_usec);
+		b.first_seqnum = le64toh(b.first_seqnum);
+		b.levels = le32toh(b.levels);
+		b.facilities = le32toh(b.facilities);
+
+		if (!archive_block_accepted(ctl, &b, levels, facilities))
+			continue;
+		if (b.offset < sizeof(hdr) || b.offset > idxoff
+		    || b.size > idxoff - b.offset)
+			goto corrupted;
+
+		p = map + b.offset;
+		end = p + b.size;
+
+		for (n = 0; n < b.nrecords; n++) {
+			struct dmesg_archive_record r;
+			struct dmesg_record rec;
+			uint64_t usec;
+			size_t sz;
+
+			if ((size_t) (end - p) < sizeof(r))
+				goto corrupted;
+			memcpy(&r, p, sizeof(r));
+			p += sizeof(r);
+
+			sz = le32toh(r.size);
+			if ((size_t) (end - p) <= sz || p[sz] != '\0')
+				goto corrupted;
+
+			INIT_DMESG_RECORD(&rec);
+			usec = le64toh(r.usec);
+			rec.tv.tv_sec = usec / 1000000;
+			rec.tv.tv_usec = usec % 1000000;
+			rec.seqnum = b.first_seqnum + le32toh(r.seqnum);
+			if (r.level != DMESG_ARCHIVE_NOVALUE)
+				rec.level = r.level;
+			if (r.facility != DMESG_ARCHIVE_NOVALUE)
+				rec.facility = r.facility;
+			rec.mesg = p;
+			rec.mesg_size = sz;
+
+			print_record(ctl, &rec);
+			p += sz + 1;
+		}
+	}
+
+	munmap((void *) map, st.st_size);
+	return 0;
+corrupted:
+	errx(EXIT_FAILURE, _("%s: corrupted archive"), ctl->filename);
+}
+
 static int which_time_format(const char *s)
 {
 	if (!strcmp(s, "notime"))
@@ -1340,6 +1861,7 @@ int main(int argc, char *argv[])
 	int  console_level = 0;
 	int  klog_rc = 0;
 	int  delta = 0;
+	const char *archive = NULL;
 	ssize_t n;
 	static struct dmesg_control ctl = {
 		.filename = NULL,
@@ -1354,7 +1876,8 @@ int main(int argc, char *argv[])
 		OPT_TIME_FORMAT = CHAR_MAX + 1,
 		OPT_NOESC,
 		OPT_SINCE,
-		OPT_UNTIL
+		OPT_UNTIL,
+		OPT_WRITE_ARCHIVE
 	};
 
 	static const struct option longopts[] = {
@@ -1388,6 +1911,7 @@ int main(int argc, char *argv[])
 		{ "version",       no_argument,	      NULL, 'V' },
 		{ "time-format",   required_argument, NULL, OPT_TIME_FORMAT },
 		{ "force-prefix",  no_argument,       NULL, 'p' },
+		{ "write-archive", required_argument, NULL, OPT_WRITE_ARCHIVE },
 		{ NULL,	           0, NULL, 0 }
 	};
 
@@ -1397,10 +1921,13 @@ int main(int argc, char *argv[])
 		{ 'L','r' },			/* color, raw */
 		{ 'S','w' },			/* syslog,follow */
 		{ 'T','r' },			/* ctime, raw */
+		{ 'W', OPT_WRITE_ARCHIVE },	/* follow-new, write-archive */
 		{ 'd','r' },			/* delta, raw */
 		{ 'e','r' },			/* reltime, raw */
 		{ 'r','x' },			/* raw, decode */
 		{ 'r','t' },			/* notime, raw */
+		{ 'r', OPT_WRITE_ARCHIVE },	/* raw, write-archive */
+		{ 'w', OPT_WRITE_ARCHIVE },	/* follow, write-archive */
 		{ 0 }
 	};
 	int excl_st[ARRAY_SIZE(excl)] = UL_EXCL_STATUS_INIT;
@@ -1530,6 +2057,9 @@ int main(int argc, char *argv[])
 			ctl.until = (time_t) (p / 1000000);
 			break;
 		}
+		case OPT_WRITE_ARCHIVE:
+			archive = optarg;
+			break;
 		case 'h':
 			usage();
 		case 'V':
@@ -1544,9 +2074,14 @@ int main(int argc, char *argv[])
 		errtryhelp(EXIT_FAILURE);
 	}
 
-	if ((is_timefmt(&ctl, RELTIME) ||
+	if (ctl.method == DMESG_METHOD_MMAP && is_archive_file(ctl.filename))
+		ctl.method = DMESG_METHOD_ARCHIVE;
+
+	/* the archive contains the boot time, see read_archive() */
+	if (ctl.method != DMESG_METHOD_ARCHIVE &&
+	    (is_timefmt(&ctl, RELTIME) ||
 	     is_timefmt(&ctl, CTIME)   ||
-	     is_timefmt(&ctl, ISO8601))) {
+	     is_timefmt(&ctl, ISO8601) || archive)) {
 		if (dmesg_get_boot_time(&ctl.boot_time) != 0)
 			ctl.time_fmt = DMESG_TIMEFTM_NONE;
 		else
@@ -1569,6 +2104,12 @@ int main(int argc, char *argv[])
 		}
 
 
+	if (archive) {
+		archive_open(&ctl, archive);
+		colormode = UL_COLORMODE_NEVER;
+		nopager = 1;
+	}
+
 	ctl.color = colors_init(colormode, "dmesg") ? 1 : 0;
 	if (ctl.follow)
 		nopager = 1;
@@ -1584,12 +2125,14 @@ int main(int argc, char *argv[])
 
 		if (ctl.raw
 		    && ctl.method != DMESG_METHOD_KMSG
+		    && ctl.method != DMESG_METHOD_ARCHIVE
 		    && (ctl.fltr_lev || ctl.fltr_fac))
 			    errx(EXIT_FAILURE, _("--raw can be used together with --level or "
 				 "--facility only when reading messages from /dev/kmsg"));
 
 		/* only kmsg supports multi-line messages */
-		if (ctl.force_prefix && ctl.method != DMESG_METHOD_KMSG)
+		if (ctl.force_prefix && ctl.method != DMESG_METHOD_KMSG
+		    && ctl.method != DMESG_METHOD_ARCHIVE)
 			ctl.force_prefix = 0;
 
 		if (ctl.pager)
@@ -1597,6 +2140,8 @@ int main(int argc, char *argv[])
 		n = read_buffer(&ctl, &buf);
 		if (n > 0)
 			print_buffer(&ctl, buf, n);
+		if (ctl.archive && n >= 0)
+			archive_close(&ctl);
 		if (!ctl.mmap_buff)
 			free(buf);
 		if (ctl.kmsg >= 0)
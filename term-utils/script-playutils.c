@@ -54,11 +54,25 @@ struct replay_step {
 	struct replay_log *data;
 };
 
+/* entry from the index file written by script --log-index */
+struct replay_index {
+	struct timeval	time;		/* session time */
+	off_t		timing_off;	/* position in the timing file */
+	int		timing_line;	/* number of the already read entries */
+	off_t		in_off;		/* position in the input log or -1 */
+	off_t		out_off;	/* position in the output log or -1 */
+};
+
 struct replay_setup {
 	struct replay_log	*logs;
 	size_t			nlogs;
 
 	struct replay_step	step;	/* current step */
+	struct timeval		time;	/* session time of the current step */
+	struct timeval		end;	/* stop after this time (if set) */
+
+	struct replay_index	*index;
+	size_t			nindex;
 
 	FILE			*timing_fp;
 	const char		*timing_filename;
@@ -71,6 +85,8 @@ struct replay_setup {
 
 	char			default_type;	/* type for REPLAY_TIMING_SIMPLE */
 	int			crmode;
+
+	unsigned int		step_pending : 1;	/* step already read by replay_seek_time() */
 };
 
 void replay_init_debug(void)
@@ -111,6 +127,7 @@ void replay_free_setup(struct replay_setup *stp)
 		return;
 
 	free(stp->logs);
+	free(stp->index);
 	free(stp->step.name);
 	free(stp->step.value);
 	free(stp);
@@ -378,6 +395,53 @@ static int replay_seek_log(struct replay_log *log, size_t move)
 	return fseek(log->fp, move, SEEK_CUR) == (off_t) -1 ? -errno : 0;
 }
 
+/* reads the next entry from the timing file to stp->step
+ *
+ * returns: 0 = success, <0 = error, 1 = done (EOF)
+ */
+static int replay_read_step(struct replay_setup *stp)
+{
+	struct replay_step *step = &stp->step;
+	int rc = 1;	/* done */
+
+	if (feof(stp->timing_fp))
+		return rc;
+
+	DBG(TIMING, ul_debug("reading next step"));
+
+	replay_reset_step(step);
+	stp->timing_line++;
+
+	switch (stp->timing_format) {
+	case REPLAY_TIMING_SIMPLE:
+		/* old format is the same as new format, but without <type> prefix */
+		rc = read_multistream_step(step, stp->timing_fp, stp->default_type);
+		if (rc == 0)
+			step->type = stp->default_type;
+		break;
+	case REPLAY_TIMING_MULTI:
+		rc = fscanf(stp->timing_fp, "%c ", &step->type);
+		if (rc != 1)
+			rc = -EINVAL;
+		else
+			rc = read_multistream_step(step,
+					stp->timing_fp,
+					step->type);
+		break;
+	}
+
+	if (rc) {
+		if (rc < 0 && feof(stp->timing_fp))
+			rc = 1;
+		return rc;		/* error or EOF */
+	}
+
+	timerinc(&stp->time, &step->delay);
+
+	DBG(TIMING, ul_debug(" step entry is '%c'", step->type));
+	return 0;
+}
+
 /* returns next step with pointer to the right log file for specified streams (e.g.
  * "IOS" for in/out/signals) or all streams if stream is NULL.
  *
@@ -401,41 +465,21 @@ int replay_get_next_step(struct replay_setup *stp, char *streams, struct replay_
 	do {
 		struct replay_log *log = NULL;
 
-		rc = 1;	/* done */
-		if (feof(stp->timing_fp))
-			break;
-
-		DBG(TIMING, ul_debug("reading next step"));
-
-		replay_reset_step(step);
-		stp->timing_line++;
-
-		switch (stp->timing_format) {
-		case REPLAY_TIMING_SIMPLE:
-			/* old format is the same as new format, but without <type> prefix */
-			rc = read_multistream_step(step, stp->timing_fp, stp->default_type);
-			if (rc == 0)
-				step->type = stp->default_type;
-			break;
-		case REPLAY_TIMING_MULTI:
-			rc = fscanf(stp->timing_fp, "%c ", &step->type);
-			if (rc != 1)
-				rc = -EINVAL;
-			else
-				rc = read_multistream_step(step,
-						stp->timing_fp,
-						step->type);
-			break;
+		if (stp->step_pending) {
+			stp->step_pending = 0;
+			rc = 0;
+		} else {
+			rc = replay_read_step(stp);
+			if (rc)
+				break;
 		}
 
-		if (rc) {
-			if (rc < 0 && feof(stp->timing_fp))
-				rc = 1;
-			break;		/* error or EOF */
+		if (timerisset(&stp->end) && timercmp(&stp->time, &stp->end, >)) {
+			DBG(TIMING, ul_debug(" end time reached"));
+			rc = 1;
+			break;
 		}
 
-		DBG(TIMING, ul_debug(" step entry is '%c'", step->type));
-
 		log = replay_get_stream_log(stp, step->type);
 		if (log) {
 			if (is_wanted_stream(step->type, streams)) {
@@ -491,6 +535,171 @@ done:
 	return rc;
 }
 
+/*
+ * Reads index file written by script --log-index, the format is:
+ *
+ *	<time> <timing offset> <timing entries> <stream>:<data offset> ...
+ */
+int replay_set_index_file(struct replay_setup *stp, const char *filename)
+{
+	char buf[BUFSIZ];
+	FILE *f;
+	int rc = 0;
+
+	assert(stp);
+	assert(filename);
+
+	f = fopen(filename, "r" UL_CLOEXECSTR);
+	if (!f)
+		return -errno;
+
+	while (fgets(buf, sizeof(buf), f)) {
+		struct replay_index *ix;
+		int64_t sec, usec;
+		intmax_t off;
+		int line, n = 0;
+		char *p, *save = NULL;
+
+		if (sscanf(buf, "%"SCNd64".%06"SCNd64" %jd %d%n",
+				&sec, &usec, &off, &line, &n) != 4) {
+			rc = -EINVAL;
+			break;
+		}
+
+		if (stp->nindex % 256 == 0)
+			stp->index = xrealloc(stp->index,
+				(stp->nindex + 256) * sizeof(struct replay_index));
+		ix = &stp->index[stp->nindex];
+		ix->time.tv_sec = (time_t) sec;
+		ix->time.tv_usec = (suseconds_t) usec;
+		ix->timing_off = (off_t) off;
+		ix->timing_line = line;
+		ix->in_off = ix->out_off = -1;
+
+		for (p = strtok_r(buf + n, " \n", &save); p;
+		     p = strtok_r(NULL, " \n", &save)) {
+			char type;
+
+			if (sscanf(p, "%c:%jd", &type, &off) != 2) {
+				rc = -EINVAL;
+				goto done;
+			}
+			if (type == 'I')
+				ix->in_off = (off_t) off;
+			else if (type == 'O')
+				ix->out_off = (off_t) off;
+		}
+
+		/* the entries have to be sorted by time */
+		if (stp->nindex &&
+		    timercmp(&ix->time, &stp->index[stp->nindex - 1].time, <)) {
+			rc = -EINVAL;
+			break;
+		}
+		stp->nindex++;
+	}
+	if (!rc && ferror(f))
+		rc = -errno;
+done:
+	fclose(f);
+	DBG(TIMING, ul_debug("index file '%s' [entries=%zu, rc=%d]",
+				filename, stp->nindex, rc));
+	return rc;
+}
+
+/* moves timing file and logs to the last index entry before @tv */
+static int replay_seek_index(struct replay_setup *stp, const struct timeval *tv)
+{
+	struct replay_index *ix;
+	size_t lo = 0, hi = stp->nindex, i;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (timercmp(&stp->index[mid].time, tv, >))
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	if (lo == 0)
+		return 0;
+	ix = &stp->index[lo - 1];
+
+	DBG(TIMING, ul_debug("seek to index entry %zu [time=%"PRId64".%06"PRId64"]",
+				lo - 1, (int64_t) ix->time.tv_sec,
+				(int64_t) ix->time.tv_usec));
+
+	for (i = 0; i < stp->nlogs; i++) {
+		struct replay_log *log = &stp->logs[i];
+		off_t off = strchr(log->streams, 'O') ? ix->out_off : ix->in_off;
+
+		if (log->noseek)
+			continue;
+		if (off < 0)
+			return -EINVAL;		/* the stream is not in the index */
+		if (fseeko(log->fp, off, SEEK_SET) != 0)
+			return -errno;
+	}
+
+	if (fseeko(stp->timing_fp, ix->timing_off, SEEK_SET) != 0)
+		return -errno;
+	stp->timing_line = ix->timing_line;
+	stp->time = ix->time;
+	return 0;
+}
+
+/*
+ * Skips all steps before the session time @tv. The index is used (if
+ * specified by replay_set_index_file()) to skip the most of the steps without
+ * reading. The delay of the first step after @tv is reduced to the rest of
+ * the time. It's supposed to be called before the first replay_get_next_step().
+ *
+ * returns: 0 = success, <0 = error
+ */
+int replay_seek_time(struct replay_setup *stp, const struct timeval *tv)
+{
+	struct replay_step *step;
+	int rc;
+
+	assert(stp);
+	assert(stp->timing_fp);
+	assert(tv);
+
+	step = &stp->step;
+
+	if (stp->nindex) {
+		rc = replay_seek_index(stp, tv);
+		if (rc)
+			return rc;
+	}
+
+	while ((rc = replay_read_step(stp)) == 0) {
+		struct replay_log *log;
+
+		if (!timercmp(&stp->time, tv, <)) {
+			timersub(&stp->time, tv, &step->delay);
+			stp->step_pending = 1;
+			break;
+		}
+		log = replay_get_stream_log(stp, step->type);
+		if (log) {
+			rc = replay_seek_log(log, step->size);
+			if (rc)
+				break;
+		}
+	}
+
+	DBG(TIMING, ul_debug("seek done [line=%d, rc=%d]", stp->timing_line, rc));
+	return rc < 0 ? rc : 0;
+}
+
+int replay_set_end_time(struct replay_setup *stp, const struct timeval *tv)
+{
+	stp->end.tv_sec = tv->tv_sec;
+	stp->end.tv_usec = tv->tv_usec;
+	return 0;
+}
+
 /* return: 0 = success, <0 = error, 1 = done (EOF) */
 int replay_emit_step_data(struct replay_setup *stp, struct replay_step *step, int fd)
 {
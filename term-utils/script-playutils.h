@@ -45,6 +45,10 @@ const char *replay_step_get_filename(struct replay_step *step);
 int replay_step_is_empty(struct replay_step *step);
 int replay_get_next_step(struct replay_setup *stp, char *streams, struct replay_step **xstep);
 
+int replay_set_index_file(struct replay_setup *stp, const char *filename);
+int replay_seek_time(struct replay_setup *stp, const struct timeval *tv);
+int replay_set_end_time(struct replay_setup *stp, const struct timeval *tv);
+
 int replay_emit_step_data(struct replay_setup *stp, struct replay_step *step, int fd);
 
 #endif /* UTIL_LINUX_SCRIPT_PLAYUTILS_H */
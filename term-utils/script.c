@@ -109,6 +109,7 @@ struct script_log {
 	char	*filename;		/* on command line specified name */
 	struct timeval oldtime;		/* previous entry log time (SCRIPT_FMT_TIMING_* only) */
 	struct timeval starttime;
+	size_t	nentries;		/* number of entries (SCRIPT_FMT_TIMING_* only) */
 
 	unsigned int	initialized : 1;
 };
@@ -128,6 +129,11 @@ struct script_control {
 
 	struct script_log	*siglog;	/* log for signal entries */
 	struct script_log	*infolog;	/* log for info entries */
+	struct script_log	*timinglog;	/* log referenced by index */
+
+	FILE		*indexfp;	/* --log-index */
+	const char	*indexname;
+	struct timeval	index_next;	/* time of the next index entry */
 
 	const char *ttyname;
 	const char *ttytype;
@@ -202,6 +208,7 @@ static void __attribute__((__noreturn__)) usage(void)
 	fputs(_(" -T, --log-timing <file>       log timing information to file\n"), out);
 	fputs(_(" -t[<file>], --timing[=<file>] deprecated alias to -T (default file is stderr)\n"), out);
 	fputs(_(" -m, --logging-format <name>   force to 'classic' or 'advanced' format\n"), out);
+	fputs(_("     --log-index <file>        log index of the timing file to file\n"), out);
 	fputs(USAGE_SEPARATOR, out);
 
 	fputs(_(" -a, --append                  append to the log file\n"), out);
@@ -270,6 +277,8 @@ static struct script_log *log_associate(struct script_control *ctl,
 		if (!ctl->infolog)
 			ctl->infolog = log;
 	}
+	if (format != SCRIPT_FMT_RAW && !ctl->timinglog)
+		ctl->timinglog = log;
 
 	return log;
 }
@@ -353,6 +362,8 @@ static void log_free(struct script_control *ctl, struct script_log *log)
 		ctl->siglog = NULL;
 	else if (ctl->infolog == log)
 		ctl->infolog = NULL;
+	if (ctl->timinglog == log)
+		ctl->timinglog = NULL;
 
 	for (i = 0; i < ctl->out.nlogs; i++) {
 		if (ctl->out.logs[i] == log)
@@ -438,6 +449,14 @@ static int logging_start(struct script_control *ctl)
 		if (rc)
 			return rc;
 	}
+
+	if (ctl->indexname) {
+		ctl->indexfp = fopen(ctl->indexname, "w" UL_CLOEXECSTR);
+		if (!ctl->indexfp) {
+			warn(_("cannot open %s"), ctl->indexname);
+			return -errno;
+		}
+	}
 	return 0;
 }
 
@@ -477,6 +496,7 @@ static ssize_t log_write(struct script_control *ctl,
 			return -errno;
 
 		log->oldtime = now;
+		log->nentries++;
 		break;
 
 	case SCRIPT_FMT_TIMING_MULTI:
@@ -491,6 +511,7 @@ static ssize_t log_write(struct script_control *ctl,
 			return -errno;
 
 		log->oldtime = now;
+		log->nentries++;
 		break;
 	default:
 		break;
@@ -501,6 +522,58 @@ static ssize_t log_write(struct script_control *ctl,
 	return ssz;
 }
 
+/*
+ * The index (--log-index) maps the session time to positions in the timing
+ * file and in the data logs. The entry is written once per
+ * SCRIPT_INDEX_INTERVAL seconds of the session, before the next step is
+ * logged, in format:
+ *
+ *	<time> <timing offset> <timing entries> <stream>:<data offset> ...
+ */
+#define SCRIPT_INDEX_INTERVAL	1
+
+static void log_index_stream(struct script_control *ctl, struct script_stream *stream)
+{
+	size_t i;
+
+	for (i = 0; i < stream->nlogs; i++) {
+		struct script_log *log = stream->logs[i];
+
+		if (log && log->fp && log->format == SCRIPT_FMT_RAW) {
+			fprintf(ctl->indexfp, " %c:%jd", stream->ident,
+					(intmax_t) ftello(log->fp));
+			break;
+		}
+	}
+}
+
+static int log_index(struct script_control *ctl)
+{
+	struct script_log *log = ctl->timinglog;
+	struct timeval elapsed;
+
+	if (!log || !log->fp)
+		return 0;
+
+	timersub(&log->oldtime, &log->starttime, &elapsed);
+	if (timercmp(&elapsed, &ctl->index_next, <))
+		return 0;
+
+	DBG(IO, ul_debug("  writing index entry"));
+
+	fprintf(ctl->indexfp, "%"PRId64".%06"PRId64" %jd %zu",
+			(int64_t)elapsed.tv_sec, (int64_t)elapsed.tv_usec,
+			(intmax_t) ftello(log->fp), log->nentries);
+	log_index_stream(ctl, &ctl->out);
+	log_index_stream(ctl, &ctl->in);
+	if (fputc('\n', ctl->indexfp) == EOF)
+		return -errno;
+
+	ctl->index_next.tv_sec = elapsed.tv_sec + SCRIPT_INDEX_INTERVAL;
+	ctl->index_next.tv_usec = 0;
+	return 0;
+}
+
 static ssize_t log_stream_activity(
 			struct script_control *ctl,
 			struct script_stream *stream,
@@ -509,6 +582,12 @@ static ssize_t log_stream_activity(
 	size_t i;
 	ssize_t outsz = 0;
 
+	if (ctl->indexfp) {
+		int rc = log_index(ctl);
+		if (rc)
+			return rc;
+	}
+
 	for (i = 0; i < stream->nlogs; i++) {
 		ssize_t ssz = log_write(ctl, stream, stream->logs[i], buf, bytes);
 
@@ -560,6 +639,7 @@ static ssize_t __attribute__ ((__format__ (__printf__, 3, 4)))
 			signum_to_signame(signum));
 
 	log->oldtime = now;
+	log->nentries++;
 	return sz;
 }
 
@@ -593,6 +673,7 @@ static ssize_t log_info(struct script_control *ctl, const char *name, const char
 	else
 		sz = fprintf(log->fp, "H %f %s\n", 0.0, name);
 
+	log->nentries++;
 	return sz;
 }
 
@@ -630,6 +711,10 @@ static void logging_done(struct script_control *ctl, const char *msg)
 	free(ctl->in.logs);
 	ctl->in.logs = NULL;
 	ctl->in.nlogs = 0;
+
+	if (ctl->indexfp && close_stream(ctl->indexfp) != 0)
+		warn(_("write failed: %s"), ctl->indexname);
+	ctl->indexfp = NULL;
 }
 
 static void callback_child_die(
@@ -758,7 +843,10 @@ int main(int argc, char **argv)
 	const char *outfile = NULL, *infile = NULL;
 	const char *timingfile = NULL, *shell = NULL, *command = NULL;
 
-	enum { FORCE_OPTION = CHAR_MAX + 1 };
+	enum {
+		FORCE_OPTION = CHAR_MAX + 1,
+		OPT_LOG_INDEX
+	};
 
 	static const struct option longopts[] = {
 		{"append", no_argument, NULL, 'a'},
@@ -771,6 +859,7 @@ int main(int argc, char **argv)
 		{"log-out", required_argument, NULL, 'O'},
 		{"log-io", required_argument, NULL, 'B'},
 		{"log-timing", required_argument, NULL, 'T'},
+		{"log-index", required_argument, NULL, OPT_LOG_INDEX},
 		{"logging-format", required_argument, NULL, 'm'},
 		{"output-limit", required_argument, NULL, 'o'},
 		{"quiet", no_argument, NULL, 'q'},
@@ -867,6 +956,9 @@ int main(int argc, char **argv)
 		case 'T' :
 			timingfile = optarg;
 			break;
+		case OPT_LOG_INDEX:
+			ctl.indexname = optarg;
+			break;
 		case 'V':
 			print_version(EXIT_SUCCESS);
 		case 'h':
@@ -891,6 +983,13 @@ int main(int argc, char **argv)
 		log_associate(&ctl, &ctl.out, outfile, SCRIPT_FMT_RAW);
 	}
 
+	if (ctl.indexname && !timingfile)
+		errx(EXIT_FAILURE, _("--log-index requires --log-timing"));
+	/* the timing log is always rewritten, the offsets in the data logs
+	 * would not match an index of the new session only */
+	if (ctl.indexname && ctl.append)
+		errx(EXIT_FAILURE, _("--log-index cannot be used with --append"));
+
 	if (timingfile) {
 		/* the old SCRIPT_FMT_TIMING_SIMPLE should be used when
 		 * recoding output only (just for backward compatibility),
@@ -1013,6 +1112,8 @@ int main(int argc, char **argv)
 		if (command)
 			log_info(&ctl, "COMMAND", "%s", command);
 		log_info(&ctl, "TIMING_LOG", "%s", timingfile);
+		if (ctl.indexname)
+			log_info(&ctl, "INDEX_LOG", "%s", ctl.indexname);
 		if (outfile)
 			log_info(&ctl, "OUTPUT_LOG", "%s", outfile);
 		if (infile)
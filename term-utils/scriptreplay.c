@@ -59,6 +59,7 @@ usage(void)
 	fputs(_(" -I, --log-in <file>     script stdin log file\n"), out);
 	fputs(_(" -O, --log-out <file>    script stdout log file (default)\n"), out);
 	fputs(_(" -B, --log-io <file>     script stdin and stdout log file\n"), out);
+	fputs(_("     --log-index <file>  script timing index file\n"), out);
 	fputs(USAGE_SEPARATOR, out);
 	fputs(_(" -s, --typescript <file> deprecated alias to -O\n"), out);
 
@@ -68,6 +69,8 @@ usage(void)
 	fputs(_(" -m, --maxdelay <num>    wait at most this many seconds between updates\n"), out);
 	fputs(_(" -x, --stream <name>     stream type (out, in, signal or info)\n"), out);
 	fputs(_(" -c, --cr-mode <type>    CR char mode (auto, never, always)\n"), out);
+	fputs(_("     --seek <time>       start replay at the session time\n"), out);
+	fputs(_("     --range <from>-<to> replay only the session time range\n"), out);
 	printf(USAGE_HELP_OPTIONS(25));
 
 	printf(USAGE_MAN_TAIL("scriptreplay(1)"));
@@ -86,6 +89,36 @@ getnum(const char *s)
 	return d;
 }
 
+/*
+ * Parses session time in format [[hh:]mm:]ss[.fraction]
+ */
+static void
+gettime(const char *s, struct timeval *tv)
+{
+	const char *p = strrchr(s, ':');
+	uint32_t num[2] = { 0, 0 };
+	size_t n = 0;
+
+	if (p) {
+		char *str = xstrndup(s, p - s), *tok, *save = NULL;
+
+		for (tok = strtok_r(str, ":", &save); tok;
+		     tok = strtok_r(NULL, ":", &save)) {
+			if (n == ARRAY_SIZE(num))
+				errx(EXIT_FAILURE, _("invalid time value \"%s\""), s);
+			num[n++] = strtou32_or_err(tok, _("failed to parse time"));
+		}
+		free(str);
+		s = p + 1;
+	}
+	strtotimeval_or_err(s, tv, _("failed to parse time"));
+
+	if (n == 2)
+		tv->tv_sec += num[0] * 3600 + num[1] * 60;
+	else if (n == 1)
+		tv->tv_sec += num[0] * 60;
+}
+
 static void
 delay_for(struct timeval *delay)
 {
@@ -142,7 +175,7 @@ int
 main(int argc, char *argv[])
 {
 	static const struct timeval mindelay = { .tv_sec = 0, .tv_usec = 100 };
-	struct timeval maxdelay;
+	struct timeval maxdelay, seek, end;
 
 	int isterm;
 	struct termios saved;
@@ -153,12 +186,16 @@ main(int argc, char *argv[])
 	const char *log_out = NULL,
 	           *log_in = NULL,
 		   *log_io = NULL,
-		   *log_tm = NULL;
+		   *log_tm = NULL,
+		   *log_idx = NULL;
 	double divi = 1;
 	int diviopt = FALSE, idx;
 	int ch, rc, crmode = REPLAY_CRMODE_AUTO, summary = 0;
 	enum {
-		OPT_SUMMARY = CHAR_MAX + 1
+		OPT_SUMMARY = CHAR_MAX + 1,
+		OPT_LOG_INDEX,
+		OPT_SEEK,
+		OPT_RANGE
 	};
 
 	static const struct option longopts[] = {
@@ -168,17 +205,21 @@ main(int argc, char *argv[])
 		{ "log-in",     required_argument,      0, 'I' },
 		{ "log-out",    required_argument,      0, 'O' },
 		{ "log-io",     required_argument,      0, 'B' },
+		{ "log-index",  required_argument,      0, OPT_LOG_INDEX },
 		{ "typescript",	required_argument,	0, 's' },
 		{ "divisor",	required_argument,	0, 'd' },
 		{ "maxdelay",	required_argument,	0, 'm' },
 		{ "stream",     required_argument,	0, 'x' },
 		{ "summary",    no_argument,            0, OPT_SUMMARY },
+		{ "seek",       required_argument,      0, OPT_SEEK },
+		{ "range",      required_argument,      0, OPT_RANGE },
 		{ "version",	no_argument,		0, 'V' },
 		{ "help",	no_argument,		0, 'h' },
 		{ NULL,		0, 0, 0 }
 	};
 	static const ul_excl_t excl[] = {       /* rows and cols in ASCII order */
 		{ 'O', 's' },
+		{ OPT_SEEK, OPT_RANGE },
 		{ 0 }
 	};
 	int excl_st[ARRAY_SIZE(excl)] = UL_EXCL_STATUS_INIT;
@@ -195,6 +236,8 @@ main(int argc, char *argv[])
 
 	replay_init_debug();
 	timerclear(&maxdelay);
+	timerclear(&seek);
+	timerclear(&end);
 
 	while ((ch = getopt_long(argc, argv, "B:c:I:O:T:t:s:d:m:x:Vh", longopts, NULL)) != -1) {
 
@@ -247,6 +290,25 @@ main(int argc, char *argv[])
 		case OPT_SUMMARY:
 			summary = 1;
 			break;
+		case OPT_LOG_INDEX:
+			log_idx = optarg;
+			break;
+		case OPT_SEEK:
+			gettime(optarg, &seek);
+			break;
+		case OPT_RANGE:
+		{
+			char *p = strchr(optarg, '-');
+
+			if (!p)
+				errx(EXIT_FAILURE, _("invalid range: %s"), optarg);
+			*p++ = '\0';
+			if (*optarg)
+				gettime(optarg, &seek);
+			if (*p)
+				gettime(p, &end);
+			break;
+		}
 		case 'V':
 			print_version(EXIT_SUCCESS);
 		case 'h':
@@ -289,6 +351,11 @@ main(int argc, char *argv[])
 	if (log_io && replay_associate_log(setup, "IO", log_io) != 0)
 		err(EXIT_FAILURE, _("cannot open %s"), log_io);
 
+	if (log_idx && (rc = replay_set_index_file(setup, log_idx)) != 0) {
+		errno = -rc;
+		err(EXIT_FAILURE, _("cannot read %s"), log_idx);
+	}
+
 	if (!*streams) {
 		/* output is preferred default */
 		if (log_out || log_io)
@@ -307,6 +374,13 @@ main(int argc, char *argv[])
 		replay_set_delay_max(setup, &maxdelay);
 	replay_set_delay_min(setup, &mindelay);
 
+	if (timerisset(&end))
+		replay_set_end_time(setup, &end);
+	if (timerisset(&seek) && (rc = replay_seek_time(setup, &seek)) != 0) {
+		errno = -rc;
+		err(EXIT_FAILURE, _("%s: failed to seek"), log_idx ? log_idx : log_tm);
+	}
+
 	isterm = setterm(&saved);
 
 	do {
@@ -0,0 +1,220 @@
+/*
+ * This file may be redistributed under the terms of the
+ * GNU Lesser General Public License.
+ *
+ * Test and benchmark for lib/crc32.c and lib/crc32c.c. The results are
+ * compared with a bitwise reference implementation, the speed is compared
+ * with a table-driven byte-at-a-time implementation:
+ *
+ *	test_crc32 crc32|crc32c < file	  # print checksum of the input
+ *	test_crc32 --check		  # compare all kernels with the reference
+ *	test_crc32 --bench <size> <count> # print speedup against the reference
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "c.h"
+#include "crc32.h"
+#include "crc32c.h"
+
+#define CRC32_POLY	0xedb88320
+#define CRC32C_POLY	0x82f63b78
+
+static uint32_t ref_crc(uint32_t poly, uint32_t crc, const unsigned char *p, size_t len)
+{
+	size_t i;
+	int k;
+
+	for (i = 0; i < len; i++) {
+		crc ^= p[i];
+		for (k = 0; k < 8; k++)
+			crc = (crc >> 1) ^ (crc & 1 ? poly : 0);
+	}
+	return crc;
+}
+
+static uint32_t ref_crc32_exclude_offset(uint32_t crc, const unsigned char *p, size_t len,
+					 size_t exclude_off, size_t exclude_len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		unsigned char x = p[i];
+
+		if (i >= exclude_off && i < exclude_off + exclude_len)
+			x = 0;
+		crc = ref_crc(CRC32_POLY, crc, &x, 1);
+	}
+	return crc;
+}
+
+static uint32_t lib_crc32c(uint32_t crc, const unsigned char *p, size_t len)
+{
+	return crc32c(crc, p, len);
+}
+
+static double time_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1E9;
+}
+
+static void fill_random(unsigned char *buf, size_t sz)
+{
+	size_t i;
+
+	for (i = 0; i < sz; i++)
+		buf[i] = random();
+}
+
+/* compare all kernels (not only the one used by the library) */
+static int check_kernels(const char *what, const struct ul_crc32_kernel *k,
+			 uint32_t poly, const unsigned char *buf, size_t off, size_t len)
+{
+	uint32_t ref = ref_crc(poly, ~0U, buf + off, len);
+	int rc = 0;
+
+	for ( ; k->name; k++) {
+		if (k->fn(~0U, buf + off, len) != ref) {
+			fprintf(stderr, "%s %s failed: off=%zu len=%zu\n",
+					what, k->name, off, len);
+			rc = 1;
+		}
+	}
+	return rc;
+}
+
+static int check(void)
+{
+	const struct ul_crc32_kernel *crc32_kernels = ul_crc32_get_kernels();
+	const struct ul_crc32_kernel *crc32c_kernels = crc32c_get_kernels();
+	unsigned char buf[1024];
+	int i, rc = 0;
+
+	srandom(42);
+	fill_random(buf, sizeof(buf));
+
+	/* all lengths and alignments */
+	for (i = 0; i < 2000; i++) {
+		size_t off = random() % 16;
+		size_t len = random() % (sizeof(buf) - off);
+		size_t xoff = random() % (len + 8);
+		size_t xlen = random() % 32;
+
+		if (ul_crc32(~0U, buf + off, len) != ref_crc(CRC32_POLY, ~0U, buf + off, len)) {
+			fprintf(stderr, "crc32 failed: off=%zu len=%zu\n", off, len);
+			rc = 1;
+		}
+		if (crc32c(~0U, buf + off, len) != ref_crc(CRC32C_POLY, ~0U, buf + off, len)) {
+			fprintf(stderr, "crc32c failed: off=%zu len=%zu\n", off, len);
+			rc = 1;
+		}
+		if (ul_crc32_exclude_offset(~0U, buf + off, len, xoff, xlen) !=
+		    ref_crc32_exclude_offset(~0U, buf + off, len, xoff, xlen)) {
+			fprintf(stderr, "crc32 exclude failed: off=%zu len=%zu exclude=%zu+%zu\n",
+					off, len, xoff, xlen);
+			rc = 1;
+		}
+		rc |= check_kernels("crc32", crc32_kernels, CRC32_POLY, buf, off, len);
+		rc |= check_kernels("crc32c", crc32c_kernels, CRC32C_POLY, buf, off, len);
+	}
+
+	printf("crc32: %s\n", rc ? "FAILED" : "OK");
+	return rc;
+}
+
+static double bench_one(uint32_t (*fn)(uint32_t, const unsigned char *, size_t),
+			const unsigned char *buf, size_t sz, size_t count, uint32_t *res)
+{
+	double start = time_now();
+	uint32_t crc = 0;
+	size_t i;
+
+	for (i = 0; i < count; i++)
+		crc ^= fn(~0U, buf, sz);
+	*res = crc;
+	return time_now() - start;
+}
+
+static uint32_t crc32_tab[256], crc32c_tab[256];
+
+static void init_table(uint32_t *tab, uint32_t poly)
+{
+	unsigned char i = 0;
+
+	do {
+		tab[i] = ref_crc(poly, 0, &i, 1);
+	} while (++i);
+}
+
+static uint32_t bytewise_crc32(uint32_t crc, const unsigned char *p, size_t len)
+{
+	while (len--)
+		crc = crc32_tab[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+	return crc;
+}
+
+static uint32_t bytewise_crc32c(uint32_t crc, const unsigned char *p, size_t len)
+{
+	while (len--)
+		crc = crc32c_tab[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+	return crc;
+}
+
+static int bench(size_t sz, size_t count)
+{
+	unsigned char *buf = malloc(sz);
+	double ref, lib;
+	uint32_t r1, r2;
+	int rc = 0;
+
+	if (!buf)
+		return 1;
+	fill_random(buf, sz);
+	init_table(crc32_tab, CRC32_POLY);
+	init_table(crc32c_tab, CRC32C_POLY);
+
+	ref = bench_one(bytewise_crc32, buf, sz, count, &r1);
+	lib = bench_one(ul_crc32, buf, sz, count, &r2);
+	printf("crc32:  bytewise %.3f s, ul_crc32 %.3f s, speedup %.1fx\n",
+			ref, lib, lib > 0 ? ref / lib : 0);
+	rc |= r1 != r2;
+
+	ref = bench_one(bytewise_crc32c, buf, sz, count, &r1);
+	lib = bench_one(lib_crc32c, buf, sz, count, &r2);
+	printf("crc32c: bytewise %.3f s, crc32c %.3f s, speedup %.1fx\n",
+			ref, lib, lib > 0 ? ref / lib : 0);
+	rc |= r1 != r2;
+
+	free(buf);
+	return rc;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned char buf[BUFSIZ];
+	uint32_t crc = ~0U;
+	size_t sz;
+	int c32c;
+
+	if (argc == 2 && strcmp(argv[1], "--check") == 0)
+		return check();
+	if (argc == 4 && strcmp(argv[1], "--bench") == 0)
+		return bench(strtoul(argv[2], NULL, 10), strtoul(argv[3], NULL, 10));
+	if (argc != 2 || (strcmp(argv[1], "crc32") && strcmp(argv[1], "crc32c"))) {
+		fprintf(stderr, "usage: %s crc32|crc32c|--check|--bench <size> <count>\n",
+				program_invocation_short_name);
+		return 1;
+	}
+
+	c32c = strcmp(argv[1], "crc32c") == 0;
+	while ((sz = fread(buf, 1, sizeof(buf), stdin)) > 0)
+		crc = c32c ? crc32c(crc, buf, sz) : ul_crc32(crc, buf, sz);
+
+	printf("%08x\n", crc ^ ~0U);
+	return 0;
+}